@@ -0,0 +1,176 @@
+#define _GNU_SOURCE
+#include "mjpeg_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int mjpeg_stream_init(MjpegStream *s, size_t capacity) {
+    memset(s, 0, sizeof(*s));
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    capacity = (capacity + page - 1) / page * page;
+
+    int fd = memfd_create("mjpeg_stream", MFD_CLOEXEC);
+    if (fd < 0) {
+        perror("memfd_create");
+        return -1;
+    }
+    if (ftruncate(fd, capacity) < 0) {
+        perror("ftruncate");
+        close(fd);
+        return -1;
+    }
+
+    // Réserve 2 * capacity puis y mappe deux fois les mêmes pages
+    uint8_t *base = mmap(NULL, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return -1;
+    }
+    if (mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        perror("mmap");
+        munmap(base, 2 * capacity);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    s->data = base;
+    s->capacity = capacity;
+    s->state = MJPEG_SEARCH_SOI;
+    return 0;
+}
+
+// Abandonne l'image en cours et recherche le prochain SOI à partir de pos
+static void resync(MjpegStream *s) {
+    s->state = MJPEG_SEARCH_SOI;
+    s->head = s->pos;
+}
+
+uint8_t *mjpeg_stream_write_ptr(MjpegStream *s, size_t *avail) {
+    if (s->tail - s->head == s->capacity) {
+        s->stats.dropped++;
+        s->pos = s->tail;
+        resync(s);
+    }
+    *avail = s->capacity - (s->tail - s->head);
+    return s->data + s->tail % s->capacity;
+}
+
+void mjpeg_stream_commit(MjpegStream *s, size_t n) {
+    s->tail += n;
+}
+
+int mjpeg_stream_next_frame(MjpegStream *s, const uint8_t **frame, size_t *len) {
+    while (s->pos < s->tail) {
+        // Grâce au miroir, les octets de pos à tail sont contigus
+        const uint8_t *p = s->data + s->pos % s->capacity;
+        size_t avail = s->tail - s->pos;
+
+        switch (s->state) {
+        case MJPEG_SEARCH_SOI: {
+            const uint8_t *ff = memchr(p, 0xFF, avail);
+            if (!ff) {
+                s->pos = s->head = s->tail;
+                return 0;
+            }
+            s->pos += ff - p;
+            s->head = s->pos;  // Octets hors image libérés
+            if (s->pos + 1 >= s->tail) return 0;
+            if (ff[1] == 0xD8) {
+                s->frame_start = s->pos;
+                s->pos += 2;
+                s->state = MJPEG_MARKER;
+            } else {
+                s->pos++;
+            }
+            break;
+        }
+
+        case MJPEG_MARKER:
+            if (p[0] != 0xFF) {  // Marqueur attendu : image tronquée
+                s->stats.resyncs++;
+                resync(s);
+                break;
+            }
+            if (avail < 2) return 0;
+            if (p[1] == 0xFF) {  // Octet de remplissage
+                s->pos++;
+                break;
+            }
+            s->marker = p[1];
+            if (s->marker == 0xD9) {  // Fin d'image (EOI)
+                s->pos += 2;
+                *frame = s->data + s->frame_start % s->capacity;
+                *len = s->pos - s->frame_start;
+                s->head = s->pos;
+                s->state = MJPEG_SEARCH_SOI;
+                s->stats.frames++;
+                return 1;
+            }
+            if (s->marker == 0xD8) {  // Nouveau SOI sans EOI : on repart de celui-ci
+                s->stats.resyncs++;
+                resync(s);
+                break;
+            }
+            s->pos += 2;
+            if (s->marker != 0x01 && (s->marker < 0xD0 || s->marker > 0xD7)) {  // Marqueurs sans longueur
+                s->state = MJPEG_LENGTH;
+            }
+            break;
+
+        case MJPEG_LENGTH:
+            if (avail < 2) return 0;
+            s->skip = ((size_t)p[0] << 8) | p[1];
+            if (s->skip < 2) {
+                s->stats.resyncs++;
+                resync(s);
+                break;
+            }
+            s->state = MJPEG_SKIP;
+            break;
+
+        case MJPEG_SKIP: {
+            size_t n = s->skip < avail ? s->skip : avail;
+            s->pos += n;
+            s->skip -= n;
+            if (s->skip == 0) {
+                s->state = s->marker == 0xDA ? MJPEG_ENTROPY : MJPEG_MARKER;
+            }
+            break;
+        }
+
+        case MJPEG_ENTROPY: {
+            // FF n'y apparaît que suivi de 00 (bourrage) ou d'un RST, sinon c'est un marqueur
+            const uint8_t *ff = memchr(p, 0xFF, avail);
+            if (!ff) {
+                s->pos = s->tail;
+                return 0;
+            }
+            s->pos += ff - p;
+            if (s->pos + 1 >= s->tail) return 0;
+            uint8_t next = ff[1];
+            if (next == 0x00 || (next >= 0xD0 && next <= 0xD7)) {
+                s->pos += 2;
+            } else {
+                s->state = MJPEG_MARKER;
+            }
+            break;
+        }
+        }
+    }
+    return 0;
+}
+
+void mjpeg_stream_print_stats(const MjpegStream *s) {
+    printf("Flux MJPEG : %lu images, %lu trop grandes, %lu tronquées\n",
+           s->stats.frames, s->stats.dropped, s->stats.resyncs);
+}
+
+void mjpeg_stream_close(MjpegStream *s) {
+    if (s->data) munmap(s->data, 2 * s->capacity);
+    s->data = NULL;
+}
@@ -0,0 +1,71 @@
+#ifndef MJPEG_STREAM_H
+#define MJPEG_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Découpage d'un flux MJPEG reçu par morceaux (TCP) en images JPEG complètes.
+//
+// Les octets sont lus directement dans un buffer circulaire mappé deux fois à la
+// suite en mémoire : toute zone de moins de capacity octets y est contiguë, une
+// image est donc rendue sans copie même quand elle fait le tour du buffer, et les
+// octets consommés ne sont jamais déplacés.
+//
+// Le découpage est incrémental : l'analyseur garde sa position et l'état du
+// segment JPEG en cours entre deux lectures. Les segments sont sautés grâce à leur
+// longueur et les données compressées parcourues une seule fois, chaque octet
+// reçu n'est examiné qu'une fois.
+
+#define MJPEG_STREAM_DEFAULT_SIZE (10 * 1024 * 1024)  // Taille maximale d'une image
+
+typedef enum {
+    MJPEG_SEARCH_SOI,  // Hors image, recherche de FF D8
+    MJPEG_MARKER,      // Marqueur attendu
+    MJPEG_LENGTH,      // Longueur du segment attendue
+    MJPEG_SKIP,        // Contenu du segment, sauté sans être lu
+    MJPEG_ENTROPY,     // Données compressées après SOS, jusqu'au prochain marqueur
+} MjpegParseState;
+
+typedef struct {
+    unsigned long frames;
+    unsigned long dropped;  // Images plus grandes que le buffer
+    unsigned long resyncs;  // Images tronquées ou corrompues, ignorées
+} MjpegStreamStats;
+
+typedef struct {
+    uint8_t *data;    // capacity octets, suivis de leur miroir
+    size_t capacity;
+
+    // Positions absolues dans le flux : [head, tail) est conservé dans le buffer
+    uint64_t head;
+    uint64_t tail;
+
+    // État de l'analyseur
+    MjpegParseState state;
+    uint64_t pos;          // Prochain octet à examiner
+    uint64_t frame_start;  // SOI de l'image en cours
+    size_t skip;           // Octets restant à sauter dans le segment
+    uint8_t marker;        // Marqueur du segment en cours
+
+    MjpegStreamStats stats;
+} MjpegStream;
+
+// capacity est arrondie au multiple de la taille de page supérieur
+int mjpeg_stream_init(MjpegStream *s, size_t capacity);
+
+// Zone libre où lire les prochains octets du flux (*avail octets contigus).
+// Si le buffer est plein, l'image en cours est trop grande : elle est abandonnée.
+uint8_t *mjpeg_stream_write_ptr(MjpegStream *s, size_t *avail);
+
+// Valide les n octets écrits dans la zone libre
+void mjpeg_stream_commit(MjpegStream *s, size_t n);
+
+// Retourne 1 et l'image suivante si elle est complète, 0 s'il faut lire la suite.
+// L'image reste valide jusqu'au prochain appel à mjpeg_stream_write_ptr().
+int mjpeg_stream_next_frame(MjpegStream *s, const uint8_t **frame, size_t *len);
+
+void mjpeg_stream_print_stats(const MjpegStream *s);
+
+void mjpeg_stream_close(MjpegStream *s);
+
+#endif // MJPEG_STREAM_H
@@ -6,36 +6,21 @@
 #include <sys/socket.h>
 #include <SDL2/SDL.h>
 
+#include "../src/ZBar_And_Video/jpeg_decode.h"
+#include "mjpeg_stream.h"
+
 #define PORT 8888
-#define BUFFER_SIZE 4096
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
-// Fonction pour trouver un JPEG complet dans le buffer
-int find_jpeg_frame(unsigned char *buf, int len, int *start, int *end) {
-    int i;
-    *start = -1;
-    *end = -1;
-    for (i = 0; i < len - 1; i++) {
-        if (*start == -1 && buf[i] == 0xFF && buf[i + 1] == 0xD8) {
-            *start = i;
-        }
-        if (*start != -1 && buf[i] == 0xFF && buf[i + 1] == 0xD9) {
-            *end = i + 1;
-            return 1;
-        }
-    }
-    return 0;
-}
 
 int main() {
     int server_fd, client_fd;
     struct sockaddr_in address;
     socklen_t addr_len = sizeof(address);
-    unsigned char buffer[BUFFER_SIZE];
-    unsigned char frame_buffer[10 * 1024 * 1024]; // 10MB max
-    int frame_buf_len = 0;
+    MjpegStream stream; // Buffer circulaire, 10MB max par image
+    DecodedImage img = {0}; // Buffer RGB réutilisé d'une frame à l'autre
+
+    if (mjpeg_stream_init(&stream, MJPEG_STREAM_DEFAULT_SIZE) < 0) {
+        return 1;
+    }
 
     // Initialisation SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -70,37 +55,27 @@ int main() {
     client_fd = accept(server_fd, (struct sockaddr *)&address, &addr_len);
     printf("Client connecté.\n");
 
-    int start = 0, end = 0;
+    const uint8_t *frame;
+    size_t frame_len;
 
     while (1) {
-        ssize_t bytes_read = read(client_fd, buffer, BUFFER_SIZE);
+        // Lecture directe dans le buffer circulaire, sans copie intermédiaire
+        size_t avail;
+        uint8_t *dst = mjpeg_stream_write_ptr(&stream, &avail);
+        ssize_t bytes_read = read(client_fd, dst, avail);
         if (bytes_read <= 0) break;
+        mjpeg_stream_commit(&stream, bytes_read);
 
-        if (frame_buf_len + bytes_read > sizeof(frame_buffer)) {
-            fprintf(stderr, "Dépassement de buffer\n");
-            break;
-        }
-
-        memcpy(frame_buffer + frame_buf_len, buffer, bytes_read);
-        frame_buf_len += bytes_read;
-
-        while (find_jpeg_frame(frame_buffer, frame_buf_len, &start, &end)) {
-            int frame_len = end - start + 1;
-
-            int w, h, comp;
-            unsigned char *img = stbi_load_from_memory(frame_buffer + start, frame_len, &w, &h, &comp, 3);
-            if (!img) {
+        while (mjpeg_stream_next_frame(&stream, &frame, &frame_len)) {
+            if (image_decode(&img, frame, frame_len, 3, 1) < 0) {
                 fprintf(stderr, "Erreur de décodage JPEG\n");
-                memmove(frame_buffer, frame_buffer + end + 1, frame_buf_len - (end + 1));
-                frame_buf_len -= (end + 1);
                 continue;
             }
 
-            SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(img, w, h, 24, w * 3,
+            SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(img.pixels, img.width, img.height, 24, img.width * 3,
                                                             0xFF0000, 0x00FF00, 0x0000FF, 0);
             if (!surface) {
                 fprintf(stderr, "Erreur SDL_CreateRGBSurfaceFrom: %s\n", SDL_GetError());
-                stbi_image_free(img);
                 break;
             }
 
@@ -112,16 +87,13 @@ int main() {
             SDL_RenderPresent(renderer);
 
             SDL_DestroyTexture(texture);
-            stbi_image_free(img);
-
-            // Retirer la frame traitée
-            memmove(frame_buffer, frame_buffer + end + 1, frame_buf_len - (end + 1));
-            frame_buf_len -= (end + 1);
 
             // Gestion d'événements SDL
             SDL_Event event;
             while (SDL_PollEvent(&event)) {
                 if (event.type == SDL_QUIT) {
+                    image_free(&img);
+                    mjpeg_stream_close(&stream);
                     close(client_fd);
                     close(server_fd);
                     SDL_DestroyRenderer(renderer);
@@ -133,7 +105,10 @@ int main() {
         }
     }
 
-    printf("Connexion fermée\n");
+    printf("Connexion fermée (décodeur JPEG : %s)\n", jpeg_decoder_name());
+    mjpeg_stream_print_stats(&stream);
+    mjpeg_stream_close(&stream);
+    image_free(&img);
     close(client_fd);
     close(server_fd);
     SDL_DestroyRenderer(renderer);
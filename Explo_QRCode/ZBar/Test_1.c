@@ -1,16 +1,15 @@
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <zbar.h>
+#include "batch_qr.h"
+#include "../src/ZBar_And_Video/jpeg_decode.h"
 
 int decode_qr(const char* image_path) {
-    int width, height, channels;
+    DecodedImage img = {0};
 
     // Charger l'image en niveaux de gris (1 canal)
-    unsigned char* image = stbi_load(image_path, &width, &height, &channels, 1);
-    if (!image) {
+    if (image_decode_file(&img, image_path, 1, 1) < 0) {
         fprintf(stderr, "Erreur : impossible de charger l'image %s\n", image_path);
         return 1;
     }
@@ -22,8 +21,8 @@ int decode_qr(const char* image_path) {
     // Créer une image ZBar
     zbar_image_t* zimg = zbar_image_create();
     zbar_image_set_format(zimg, zbar_fourcc('Y','8','0','0'));
-    zbar_image_set_size(zimg, width, height);
-    zbar_image_set_data(zimg, image, width * height, NULL);  // on gère nous-mêmes le free
+    zbar_image_set_size(zimg, img.width, img.height);
+    zbar_image_set_data(zimg, img.pixels, img.width * img.height, NULL);  // on gère nous-mêmes le free
 
     // Scanner
     int n = zbar_scan_image(scanner, zimg);
@@ -39,7 +38,7 @@ int decode_qr(const char* image_path) {
     // Nettoyage
     zbar_image_destroy(zimg);
     zbar_image_scanner_destroy(scanner);
-    stbi_image_free(image);
+    image_free(&img);
 
     return 0;
 }
@@ -47,8 +46,27 @@ int decode_qr(const char* image_path) {
 int main(int argc, char** argv) {
     if (argc < 2) {
         printf("Usage : %s <chemin_image>\n", argv[0]);
+        printf("        %s batch <dossier|flux.mjpeg|vidéo> [index=fichier] [threads=N] [scale=2|4|8] [fast]\n", argv[0]);
+        printf("        (décodeur JPEG : %s)\n", jpeg_decoder_name());
         return 1;
     }
 
+    // Mode batch : relecture d'un enregistrement complet, en parallèle
+    if (strcmp(argv[1], "batch") == 0 && argc >= 3) {
+        BatchOptions opt = {argv[2], NULL, 0, QR_SCAN_FULL, 1};
+        for (int i = 3; i < argc; i++) {
+            if (strncmp(argv[i], "index=", 6) == 0) {
+                opt.index_path = argv[i] + 6;
+            } else if (strncmp(argv[i], "threads=", 8) == 0) {
+                opt.threads = atoi(argv[i] + 8);
+            } else if (strncmp(argv[i], "scale=", 6) == 0) {
+                opt.scale = atoi(argv[i] + 6);
+            } else if (strcmp(argv[i], "fast") == 0) {
+                opt.mode = QR_SCAN_FAST;
+            }
+        }
+        return batch_qr_run(&opt) < 0 ? 1 : 0;
+    }
+
     return decode_qr(argv[1]);
 }
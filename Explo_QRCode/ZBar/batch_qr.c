@@ -0,0 +1,570 @@
+#include "batch_qr.h"
+#include "../src/ZBar_And_Video/jpeg_decode.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <zbar.h>
+
+#ifdef HAVE_GSTREAMER
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+#endif
+
+typedef enum {
+    BATCH_FILE,    // Fichier image, lu et décodé par le worker
+    BATCH_JPEG,    // JPEG dans le flux MJPEG mappé en mémoire
+    BATCH_SAMPLE,  // Frame GRAY8 déjà décodée par GStreamer
+} BatchJobKind;
+
+typedef struct {
+    BatchJobKind kind;
+    unsigned long index;  // Rang de l'image dans la source
+    const char* path;     // BATCH_FILE
+    const uint8_t* data;  // BATCH_JPEG
+    size_t size;
+    size_t offset;
+    void* sample;         // BATCH_SAMPLE (GstSample*)
+    uint64_t pts_ms;
+} BatchJob;
+
+typedef struct {
+    unsigned long index;
+    char position[64];
+    char* symbol;
+    int n_corners;
+    DetectionPoint corners[DETECTION_MAX_CORNERS];
+} BatchResult;
+
+typedef struct {
+    unsigned long images;
+    unsigned long failed;       // Images illisibles
+    unsigned long with_symbol;
+    unsigned long symbols;
+    double decode_ms;           // Temps cumulé (tous threads)
+    double scan_ms;
+    int scale;                  // Réduction appliquée par le décodeur JPEG
+} BatchStats;
+
+typedef struct {
+    QrScanMode mode;
+    int scale;
+
+    // File bornée : le lecteur attend quand elle est pleine, rien n'est perdu
+    BatchJob jobs[BATCH_QUEUE_DEPTH];
+    int head;
+    int count;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+
+    // Chemins des images d'un dossier, libérés une fois les workers arrêtés
+    char** paths;
+    size_t n_paths;
+
+    // Résultats et statistiques, protégés par results_lock
+    BatchResult* results;
+    size_t n_results;
+    size_t results_capacity;
+    BatchStats stats;
+    double start_ms;
+    pthread_mutex_t results_lock;
+} Batch;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void push_job(Batch* b, const BatchJob* job) {
+    pthread_mutex_lock(&b->lock);
+    while (b->count == BATCH_QUEUE_DEPTH) {
+        pthread_cond_wait(&b->not_full, &b->lock);
+    }
+    b->jobs[(b->head + b->count) % BATCH_QUEUE_DEPTH] = *job;
+    b->count++;
+    pthread_cond_signal(&b->not_empty);
+    pthread_mutex_unlock(&b->lock);
+}
+
+// Retourne 0 quand la source est épuisée
+static int pop_job(Batch* b, BatchJob* job) {
+    pthread_mutex_lock(&b->lock);
+    while (b->count == 0 && !b->closed) {
+        pthread_cond_wait(&b->not_empty, &b->lock);
+    }
+    int ok = b->count > 0;
+    if (ok) {
+        *job = b->jobs[b->head];
+        b->head = (b->head + 1) % BATCH_QUEUE_DEPTH;
+        b->count--;
+        pthread_cond_signal(&b->not_full);
+    }
+    pthread_mutex_unlock(&b->lock);
+    return ok;
+}
+
+static void job_position(const BatchJob* job, char* buf, size_t size) {
+    if (job->kind == BATCH_FILE) {
+        const char* name = strrchr(job->path, '/');
+        snprintf(buf, size, "%s", name ? name + 1 : job->path);
+    } else if (job->kind == BATCH_JPEG) {
+        snprintf(buf, size, "@%zu", job->offset);
+    } else {
+        snprintf(buf, size, "%llu ms", (unsigned long long)job->pts_ms);
+    }
+}
+
+// Ajoute les symboles du dernier scan aux résultats (verrou des résultats pris)
+static int collect_symbols(Batch* b, QrScanner* s, const BatchJob* job, int scale) {
+    int n = 0;
+    const zbar_symbol_t* symbol = zbar_image_first_symbol(s->image);
+    for (; symbol; symbol = zbar_symbol_next(symbol)) {
+        if (b->n_results == b->results_capacity) {
+            size_t capacity = b->results_capacity ? b->results_capacity * 2 : 256;
+            BatchResult* results = realloc(b->results, capacity * sizeof(BatchResult));
+            if (!results) break;
+            b->results = results;
+            b->results_capacity = capacity;
+        }
+        BatchResult* r = &b->results[b->n_results++];
+        r->index = job->index;
+        job_position(job, r->position, sizeof(r->position));
+        r->symbol = strdup(zbar_symbol_get_data(symbol));
+
+        // Coordonnées ramenées à la pleine résolution (scan ROI ou 1/2, réduction au décodage)
+        unsigned loc = zbar_symbol_get_loc_size(symbol);
+        r->n_corners = loc < DETECTION_MAX_CORNERS ? (int)loc : DETECTION_MAX_CORNERS;
+        for (int i = 0; i < r->n_corners; i++) {
+            r->corners[i].x = (int16_t)((s->loc_x + zbar_symbol_get_loc_x(symbol, i) * s->loc_scale) * scale);
+            r->corners[i].y = (int16_t)((s->loc_y + zbar_symbol_get_loc_y(symbol, i) * s->loc_scale) * scale);
+        }
+        n++;
+    }
+    return n;
+}
+
+// Décode et scanne une image
+static void process_job(Batch* b, QrScanner* s, DecodedImage* img, const BatchJob* job) {
+    double start = now_ms();
+    const uint8_t* gray = NULL;
+    int width = 0, height = 0, stride = 0, scale = 1;
+#ifdef HAVE_GSTREAMER
+    GstVideoFrame frame;
+    int mapped = 0;
+#endif
+
+    if (job->kind == BATCH_FILE || job->kind == BATCH_JPEG) {
+        int ret = job->kind == BATCH_FILE ? image_decode_file(img, job->path, 1, b->scale)
+                                          : image_decode(img, job->data, job->size, 1, b->scale);
+        if (ret == 0) {
+            gray = img->pixels;
+            width = stride = img->width;
+            height = img->height;
+            scale = img->scale;
+        }
+    } else {
+#ifdef HAVE_GSTREAMER
+        GstVideoInfo info;
+        GstSample* sample = (GstSample*)job->sample;
+        mapped = gst_video_info_from_caps(&info, gst_sample_get_caps(sample)) &&
+                 gst_video_frame_map(&frame, &info, gst_sample_get_buffer(sample), GST_MAP_READ);
+        if (mapped) {
+            gray = GST_VIDEO_FRAME_PLANE_DATA(&frame, 0);
+            stride = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0);
+            width = GST_VIDEO_FRAME_WIDTH(&frame);
+            height = GST_VIDEO_FRAME_HEIGHT(&frame);
+        }
+#endif
+    }
+    double decoded = now_ms();
+
+    // Les images d'un worker ne se suivent pas : la ROI de la précédente ne vaut rien pour celle-ci
+    s->roi.valid = 0;
+    int found = 0;
+    if (gray) found = qr_scanner_detect(s, gray, width, height, stride);
+    double scanned = now_ms();
+
+    pthread_mutex_lock(&b->results_lock);
+    b->stats.images++;
+    b->stats.decode_ms += decoded - start;
+    b->stats.scan_ms += scanned - decoded;
+    if (scale > b->stats.scale) b->stats.scale = scale;
+    if (!gray) {
+        b->stats.failed++;
+        char position[64];
+        job_position(job, position, sizeof(position));
+        fprintf(stderr, "Image %lu illisible (%s)\n", job->index, position);
+    } else if (found > 0) {
+        b->stats.with_symbol++;
+        b->stats.symbols += collect_symbols(b, s, job, scale);
+    }
+    if (b->stats.images % BATCH_PROGRESS_INTERVAL == 0) {
+        double elapsed = now_ms() - b->start_ms;
+        fprintf(stderr, "%lu images, %lu avec QR code, %.1f images/s\n",
+                b->stats.images, b->stats.with_symbol, b->stats.images * 1000.0 / elapsed);
+    }
+    pthread_mutex_unlock(&b->results_lock);
+
+#ifdef HAVE_GSTREAMER
+    if (mapped) gst_video_frame_unmap(&frame);
+    if (job->sample) gst_sample_unref((GstSample*)job->sample);
+#endif
+}
+
+static void* worker_thread(void* arg) {
+    Batch* b = (Batch*)arg;
+
+    // Un scanner par thread : ZBar n'est pas thread-safe sur un même scanner
+    QrScanner scanner;
+    if (qr_scanner_init(&scanner, b->mode, 0) < 0) return NULL;
+
+    // Buffer de décodage réutilisé d'une image à l'autre
+    DecodedImage img = {0};
+    BatchJob job;
+    while (pop_job(b, &job)) {
+        process_job(b, &scanner, &img, &job);
+    }
+    image_free(&img);
+    qr_scanner_close(&scanner);
+    return NULL;
+}
+
+/*------------------------------------------------------------------------------------------*/
+
+static int has_image_extension(const char* name) {
+    const char* ext = strrchr(name, '.');
+    if (!ext) return 0;
+    return strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0 || strcasecmp(ext, ".png") == 0 ||
+           strcasecmp(ext, ".bmp") == 0 || strcasecmp(ext, ".pgm") == 0;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Dossier d'images : les chemins sont triés pour suivre l'ordre des frames enregistrées
+static int read_directory(Batch* b, const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        perror("Erreur lors de l'ouverture du dossier");
+        return -1;
+    }
+
+    char** paths = NULL;
+    size_t n = 0, capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!has_image_extension(entry->d_name)) continue;
+        if (n == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            char** grown = realloc(paths, capacity * sizeof(char*));
+            if (!grown) break;
+            paths = grown;
+        }
+        size_t len = strlen(path) + strlen(entry->d_name) + 2;
+        paths[n] = malloc(len);
+        if (!paths[n]) break;
+        snprintf(paths[n], len, "%s/%s", path, entry->d_name);
+        n++;
+    }
+    closedir(dir);
+    qsort(paths, n, sizeof(char*), compare_names);
+    b->paths = paths;
+    b->n_paths = n;
+
+    for (size_t i = 0; i < n; i++) {
+        BatchJob job = {0};
+        job.kind = BATCH_FILE;
+        job.index = i;
+        job.path = paths[i];
+        push_job(b, &job);
+    }
+    return (int)n;
+}
+
+// Cherche la prochaine image JPEG complète à partir de pos, dans [*start, *end[.
+// Les segments sont sautés d'après leur longueur et les données compressées lues
+// jusqu'au marqueur suivant : un FF D9 d'une miniature EXIF ne coupe pas l'image.
+// Retourne 0 s'il n'y a plus d'image complète.
+static int next_jpeg(const uint8_t* data, size_t len, size_t pos, size_t* start, size_t* end) {
+    while (pos + 1 < len) {
+        // Début d'image (SOI)
+        const uint8_t* soi = memchr(data + pos, 0xFF, len - pos - 1);
+        if (!soi) return 0;
+        pos = soi - data;
+        if (data[pos + 1] != 0xD8) {
+            pos++;
+            continue;
+        }
+        *start = pos;
+        pos += 2;
+
+        int corrupt = 0;
+        while (pos + 1 < len && !corrupt) {
+            if (data[pos] != 0xFF) {
+                corrupt = 1;  // Marqueur attendu : image tronquée, on resynchronise sur le SOI suivant
+                break;
+            }
+            uint8_t marker = data[pos + 1];
+            if (marker == 0xFF) {  // Octet de remplissage
+                pos++;
+                continue;
+            }
+            if (marker == 0xD9) {  // Fin d'image (EOI)
+                *end = pos + 2;
+                return 1;
+            }
+            if (marker == 0xD8) {  // Nouveau SOI sans EOI : l'image précédente est tronquée
+                corrupt = 1;
+                break;
+            }
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {  // Marqueurs sans longueur
+                pos += 2;
+                continue;
+            }
+            if (pos + 4 > len) return 0;
+            size_t segment = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+            if (segment < 2) {
+                corrupt = 1;
+                break;
+            }
+            pos += 2 + segment;
+
+            // Après SOS, données compressées : FF n'y apparaît que suivi de 00 ou d'un RST
+            if (marker == 0xDA) {
+                while (pos + 1 < len) {
+                    const uint8_t* ff = memchr(data + pos, 0xFF, len - pos - 1);
+                    if (!ff) return 0;
+                    pos = ff - data;
+                    uint8_t next = data[pos + 1];
+                    if (next == 0x00 || (next >= 0xD0 && next <= 0xD7)) {
+                        pos += 2;
+                    } else {
+                        break;
+                    }
+                }
+            }
+        }
+        if (!corrupt) return 0;
+        pos = *start + 2;
+    }
+    return 0;
+}
+
+// Flux MJPEG enregistré : le fichier est mappé, les workers décodent directement dedans
+static int read_mjpeg(Batch* b, const uint8_t* data, size_t len) {
+    size_t pos = 0, start, end;
+    unsigned long n = 0;
+    while (next_jpeg(data, len, pos, &start, &end)) {
+        BatchJob job = {0};
+        job.kind = BATCH_JPEG;
+        job.index = n++;
+        job.data = data + start;
+        job.size = end - start;
+        job.offset = start;
+        push_job(b, &job);
+        pos = end;
+    }
+    return (int)n;
+}
+
+#ifdef HAVE_GSTREAMER
+// Vidéo : décodée par GStreamer en GRAY8, le lecteur ralentit au rythme des workers
+static int read_video(Batch* b, const char* path) {
+    GError* error = NULL;
+    GstElement* pipeline = gst_parse_launch(
+        "filesrc name=src ! decodebin ! videoconvert ! video/x-raw,format=GRAY8 ! "
+        "appsink name=sink sync=false max-buffers=4", &error);
+    if (!pipeline) {
+        fprintf(stderr, "Erreur lors de la création du pipeline : %s\n", error->message);
+        g_error_free(error);
+        return -1;
+    }
+    GstElement* src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    g_object_set(src, "location", path, NULL);
+    gst_object_unref(src);
+
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        fprintf(stderr, "Impossible de lire la vidéo %s\n", path);
+        gst_object_unref(sink);
+        gst_object_unref(pipeline);
+        return -1;
+    }
+
+    unsigned long n = 0;
+    GstSample* sample;
+    while ((sample = gst_app_sink_pull_sample(GST_APP_SINK(sink))) != NULL) {
+        GstBuffer* buffer = gst_sample_get_buffer(sample);
+        BatchJob job = {0};
+        job.kind = BATCH_SAMPLE;
+        job.index = n++;
+        job.sample = sample;  // Référence rendue par le worker
+        job.pts_ms = buffer && GST_BUFFER_PTS_IS_VALID(buffer) ? GST_BUFFER_PTS(buffer) / GST_MSECOND : 0;
+        push_job(b, &job);
+    }
+
+    // Fin de flux ou erreur de décodage
+    GstBus* bus = gst_element_get_bus(pipeline);
+    GstMessage* msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR);
+    if (msg) {
+        gst_message_parse_error(msg, &error, NULL);
+        fprintf(stderr, "Erreur de lecture de la vidéo : %s\n", error->message);
+        g_error_free(error);
+        gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+    return msg && n == 0 ? -1 : (int)n;
+}
+#endif
+
+/*------------------------------------------------------------------------------------------*/
+
+static int compare_results(const void* a, const void* b) {
+    const BatchResult* ra = a;
+    const BatchResult* rb = b;
+    return ra->index < rb->index ? -1 : ra->index > rb->index;
+}
+
+static int write_index(Batch* b, const char* path) {
+    FILE* out = path ? fopen(path, "w") : stdout;
+    if (!out) {
+        perror("Erreur lors de l'ouverture de l'index");
+        return -1;
+    }
+
+    // Les workers terminent dans le désordre : l'index suit l'ordre des images
+    qsort(b->results, b->n_results, sizeof(BatchResult), compare_results);
+    fprintf(out, "# image\tposition\tcontenu\tcoins\n");
+    for (size_t i = 0; i < b->n_results; i++) {
+        const BatchResult* r = &b->results[i];
+        fprintf(out, "%lu\t%s\t%s\t", r->index, r->position, r->symbol ? r->symbol : "");
+        for (int c = 0; c < r->n_corners; c++) {
+            fprintf(out, "%s%d,%d", c ? " " : "", r->corners[c].x, r->corners[c].y);
+        }
+        fputc('\n', out);
+    }
+
+    int ret = 0;
+    if (path && fclose(out) != 0) {
+        perror("Erreur lors de l'écriture de l'index");
+        ret = -1;
+    }
+    return ret;
+}
+
+int batch_qr_run(const BatchOptions* opt) {
+    struct stat st;
+    if (stat(opt->source, &st) < 0) {
+        perror("Source introuvable");
+        return -1;
+    }
+
+    Batch b;
+    memset(&b, 0, sizeof(b));
+    b.mode = opt->mode;
+    b.scale = opt->scale;
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.not_empty, NULL);
+    pthread_cond_init(&b.not_full, NULL);
+    pthread_mutex_init(&b.results_lock, NULL);
+
+    int n_threads = opt->threads > 0 ? opt->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1) n_threads = 1;
+    if (n_threads > BATCH_MAX_THREADS) n_threads = BATCH_MAX_THREADS;
+
+    // Une source MJPEG est mappée avant le démarrage des workers, qui lisent dedans
+    uint8_t* map = NULL;
+    size_t map_size = 0;
+    int is_mjpeg = 0;
+    if (S_ISREG(st.st_mode) && st.st_size >= 2) {
+        int fd = open(opt->source, O_RDONLY);
+        if (fd < 0) {
+            perror("Erreur lors de l'ouverture de la source");
+            return -1;
+        }
+        map_size = st.st_size;
+        map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            perror("Erreur lors du mappage de la source");
+            return -1;
+        }
+        is_mjpeg = map[0] == 0xFF && map[1] == 0xD8;
+        if (is_mjpeg) {
+            madvise(map, map_size, MADV_SEQUENTIAL);
+        } else {
+            munmap(map, map_size);
+            map = NULL;
+        }
+    }
+
+    pthread_t threads[BATCH_MAX_THREADS];
+    int started = 0;
+    b.start_ms = now_ms();
+    for (int i = 0; i < n_threads; i++) {
+        if (pthread_create(&threads[i], NULL, worker_thread, &b) != 0) break;
+        started++;
+    }
+
+    int n;
+    if (S_ISDIR(st.st_mode)) {
+        n = read_directory(&b, opt->source);
+    } else if (is_mjpeg) {
+        n = read_mjpeg(&b, map, map_size);
+    } else {
+#ifdef HAVE_GSTREAMER
+        gst_init(NULL, NULL);
+        n = read_video(&b, opt->source);
+#else
+        fprintf(stderr, "%s : ni dossier ni flux MJPEG, et lecture vidéo indisponible (compilé sans GStreamer)\n",
+                opt->source);
+        n = -1;
+#endif
+    }
+
+    pthread_mutex_lock(&b.lock);
+    b.closed = 1;
+    pthread_cond_broadcast(&b.not_empty);
+    pthread_mutex_unlock(&b.lock);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    double elapsed = now_ms() - b.start_ms;
+
+    int ret = n < 0 || started == 0 ? -1 : write_index(&b, opt->index_path);
+
+    const BatchStats* s = &b.stats;
+    if (n >= 0) {
+        fprintf(stderr, "%lu images (%lu illisibles) en %.2f s avec %d threads (%s, 1/%d) : %.1f images/s\n",
+                s->images, s->failed, elapsed / 1000.0, started, jpeg_decoder_name(), s->scale > 1 ? s->scale : 1,
+                elapsed > 0 ? s->images * 1000.0 / elapsed : 0.0);
+        fprintf(stderr, "%lu images avec QR code, %lu QR codes ; décodage %.2f ms/image, scan %.2f ms/image\n",
+                s->with_symbol, s->symbols, s->images ? s->decode_ms / s->images : 0.0,
+                s->images ? s->scan_ms / s->images : 0.0);
+    }
+
+    for (size_t i = 0; i < b.n_results; i++) free(b.results[i].symbol);
+    free(b.results);
+    for (size_t i = 0; i < b.n_paths; i++) free(b.paths[i]);
+    free(b.paths);
+    if (map) munmap(map, map_size);
+    pthread_cond_destroy(&b.not_empty);
+    pthread_cond_destroy(&b.not_full);
+    pthread_mutex_destroy(&b.lock);
+    pthread_mutex_destroy(&b.results_lock);
+    return ret;
+}
@@ -0,0 +1,36 @@
+#ifndef BATCH_QR_H
+#define BATCH_QR_H
+
+#include "../src/ZBar_And_Video/Decode_QR.h"
+
+// Relecture hors ligne d'enregistrements : toutes les images d'une source sont
+// décodées et scannées en parallèle, les QR codes trouvés sont écrits dans un
+// index trié par image.
+//
+// Sources acceptées :
+//   - un dossier d'images (JPEG, PNG, BMP, PGM), lues dans l'ordre alphabétique ;
+//   - un fichier de JPEG concaténés (flux MJPEG enregistré), découpé sans copie ;
+//   - une vidéo quelconque, décodée par GStreamer (si compilé avec HAVE_GSTREAMER).
+//
+// Index : une ligne par QR code, champs séparés par des tabulations :
+//   image  position  contenu  coins
+// position est le nom du fichier, le décalage "@octets" dans le flux MJPEG ou
+// le timestamp en ms de la vidéo ; coins est la liste "x,y x,y ..." en pixels.
+
+#define BATCH_QUEUE_DEPTH 64          // Images en attente de décodage au maximum
+#define BATCH_MAX_THREADS 32
+#define BATCH_PROGRESS_INTERVAL 1000  // Images entre deux affichages de la progression
+
+typedef struct {
+    const char* source;
+    const char* index_path;  // NULL : index écrit sur la sortie standard
+    int threads;             // <= 0 : un thread par cœur
+    QrScanMode mode;         // QR_SCAN_FULL conseillé : le mode rapide s'arrête au premier niveau
+                             // qui trouve un symbole et peut manquer les autres QR codes de l'image
+    int scale;               // Réduction des JPEG au décodage (2, 4 ou 8) si libjpeg-turbo, sinon 1
+} BatchOptions;
+
+// Traite toute la source, retourne -1 si elle est illisible ou si l'index ne peut pas être écrit
+int batch_qr_run(const BatchOptions* opt);
+
+#endif // BATCH_QR_H
@@ -0,0 +1,239 @@
+/* bench_colorspace.c - Vérifie les conversions (valeurs connues, SIMD contre scalaire) et mesure leur débit (MPix/s) */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/ZBar_And_Video/colorspace.h"
+
+#define MIN_DURATION 0.5  // Durée minimale d'une mesure (s)
+
+static const char *impls[] = {"scalar", "sse2", "avx2", "neon"};
+#define NUM_IMPLS (sizeof(impls) / sizeof(impls[0]))
+
+// Plans source et destination d'une image, avec des strides plus grands que la largeur
+typedef struct {
+    int width, height;
+    int yuyv_stride, y_stride, c_stride;
+    uint8_t *yuyv;                  // Source YUYV
+    uint8_t *y, *u, *v, *uv;        // Destinations
+    uint8_t *src_u, *src_v;         // Source I420 (plans de chrominance)
+    size_t yuyv_size, y_size, c_size;
+} Frame;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int frame_alloc(Frame *f, int width, int height, int padding) {
+    memset(f, 0, sizeof(*f));
+    f->width = width;
+    f->height = height;
+    f->yuyv_stride = 2 * width + padding;
+    f->y_stride = width + padding;
+    f->c_stride = width / 2 + padding;
+    f->yuyv_size = (size_t)f->yuyv_stride * height;
+    f->y_size = (size_t)f->y_stride * height;
+    f->c_size = (size_t)f->c_stride * ((height + 1) / 2);
+
+    f->yuyv = malloc(f->yuyv_size);
+    f->y = malloc(f->y_size);
+    f->u = malloc(f->c_size);
+    f->v = malloc(f->c_size);
+    f->uv = malloc(f->y_size);
+    f->src_u = malloc(f->c_size);
+    f->src_v = malloc(f->c_size);
+    if (!f->yuyv || !f->y || !f->u || !f->v || !f->uv || !f->src_u || !f->src_v) {
+        perror("Erreur d'allocation mémoire");
+        return -1;
+    }
+    for (size_t i = 0; i < f->yuyv_size; i++) f->yuyv[i] = (uint8_t)rand();
+    for (size_t i = 0; i < f->c_size; i++) {
+        f->src_u[i] = (uint8_t)rand();
+        f->src_v[i] = (uint8_t)rand();
+    }
+    return 0;
+}
+
+static void frame_free(Frame *f) {
+    free(f->yuyv);
+    free(f->y);
+    free(f->u);
+    free(f->v);
+    free(f->uv);
+    free(f->src_u);
+    free(f->src_v);
+}
+
+// Remet les destinations à une valeur connue (le padding doit rester intact)
+static void frame_clear(Frame *f) {
+    memset(f->y, 0xA5, f->y_size);
+    memset(f->u, 0xA5, f->c_size);
+    memset(f->v, 0xA5, f->c_size);
+    memset(f->uv, 0xA5, f->y_size);
+}
+
+enum { CONV_GRAY, CONV_I420, CONV_NV12, CONV_I420_NV12, CONV_DOWNSCALE, NUM_CONVS };
+static const char *conv_names[] = {"YUYV->GRAY8", "YUYV->I420", "YUYV->NV12", "I420->NV12", "GRAY8/2"};
+
+static void run_conv(int conv, Frame *f) {
+    switch (conv) {
+        case CONV_GRAY:
+            yuyv_to_gray8(f->yuyv, f->yuyv_stride, f->y, f->y_stride, f->width, f->height);
+            break;
+        case CONV_I420:
+            yuyv_to_i420(f->yuyv, f->yuyv_stride, f->y, f->y_stride, f->u, f->c_stride,
+                         f->v, f->c_stride, f->width, f->height);
+            break;
+        case CONV_NV12:
+            yuyv_to_nv12(f->yuyv, f->yuyv_stride, f->y, f->y_stride, f->uv, f->y_stride,
+                         f->width, f->height);
+            break;
+        case CONV_I420_NV12:
+            // Le plan Y de la source I420 est pris dans les octets YUYV
+            i420_to_nv12(f->yuyv, f->yuyv_stride, f->src_u, f->c_stride, f->src_v, f->c_stride,
+                         f->y, f->y_stride, f->uv, f->y_stride, f->width, f->height);
+            break;
+        default:
+            gray8_downscale_2x(f->yuyv, f->yuyv_stride, f->y, f->y_stride, f->width, f->height);
+            break;
+    }
+}
+
+// Compare chaque implémentation disponible à la version scalaire, retourne le nombre d'écarts
+static int check_exact(int width, int height) {
+    Frame ref, f;
+    int errors = 0;
+    if (frame_alloc(&ref, width, height, 7) < 0) return 1;
+    if (frame_alloc(&f, width, height, 7) < 0) {
+        frame_free(&ref);
+        return 1;
+    }
+    memcpy(f.yuyv, ref.yuyv, ref.yuyv_size);
+    memcpy(f.src_u, ref.src_u, ref.c_size);
+    memcpy(f.src_v, ref.src_v, ref.c_size);
+
+    for (int conv = 0; conv < NUM_CONVS; conv++) {
+        colorspace_select("scalar");
+        frame_clear(&ref);
+        run_conv(conv, &ref);
+
+        for (size_t i = 1; i < NUM_IMPLS; i++) {
+            if (colorspace_select(impls[i]) < 0) continue;
+            frame_clear(&f);
+            run_conv(conv, &f);
+            if (memcmp(ref.y, f.y, ref.y_size) || memcmp(ref.u, f.u, ref.c_size) ||
+                memcmp(ref.v, f.v, ref.c_size) || memcmp(ref.uv, f.uv, ref.y_size)) {
+                printf("Erreur: %s %s différent de scalar en %dx%d\n",
+                       conv_names[conv], impls[i], width, height);
+                errors++;
+            }
+        }
+    }
+    frame_free(&ref);
+    frame_free(&f);
+    return errors;
+}
+
+// Valeurs attendues calculées à la main, indépendamment du code testé, sur deux lignes
+// de KNOWN_WIDTH pixels (assez pour passer par les boucles SIMD) :
+//   Y(x, r) = 3x + 2r, U(p, r) = 5p + r, V(p, r) = 250 - 3p - r  (p : paire de pixels)
+// Chrominance moyennée en arrondissant au supérieur : U = 5p + 1, V = 250 - 3p.
+// Réduction 2x de Y (arrondi au plus proche) : (24p + 10 + 2) / 4 = 6p + 3.
+#define KNOWN_WIDTH 64
+
+static int check_known(const char *impl) {
+    uint8_t yuyv[2][2 * KNOWN_WIDTH], gray[2][KNOWN_WIDTH], small[KNOWN_WIDTH / 2];
+    uint8_t y[2][KNOWN_WIDTH], u[KNOWN_WIDTH / 2], v[KNOWN_WIDTH / 2], uv[KNOWN_WIDTH];
+    uint8_t src_u[KNOWN_WIDTH / 2], src_v[KNOWN_WIDTH / 2];
+    for (int r = 0; r < 2; r++) {
+        for (int p = 0; p < KNOWN_WIDTH / 2; p++) {
+            yuyv[r][4 * p] = (uint8_t)(3 * (2 * p) + 2 * r);
+            yuyv[r][4 * p + 1] = (uint8_t)(5 * p + r);
+            yuyv[r][4 * p + 2] = (uint8_t)(3 * (2 * p + 1) + 2 * r);
+            yuyv[r][4 * p + 3] = (uint8_t)(250 - 3 * p - r);
+        }
+    }
+    for (int p = 0; p < KNOWN_WIDTH / 2; p++) {
+        src_u[p] = (uint8_t)(5 * p);
+        src_v[p] = (uint8_t)(250 - 3 * p);
+    }
+
+    int errors = 0;
+    yuyv_to_gray8(yuyv[0], sizeof(yuyv[0]), gray[0], KNOWN_WIDTH, KNOWN_WIDTH, 2);
+    for (int r = 0; r < 2; r++) {
+        for (int x = 0; x < KNOWN_WIDTH; x++) errors += gray[r][x] != 3 * x + 2 * r;
+    }
+    gray8_downscale_2x(gray[0], KNOWN_WIDTH, small, KNOWN_WIDTH / 2, KNOWN_WIDTH, 2);
+    for (int p = 0; p < KNOWN_WIDTH / 2; p++) errors += small[p] != 6 * p + 3;
+
+    yuyv_to_i420(yuyv[0], sizeof(yuyv[0]), y[0], KNOWN_WIDTH, u, KNOWN_WIDTH / 2, v, KNOWN_WIDTH / 2,
+                 KNOWN_WIDTH, 2);
+    for (int p = 0; p < KNOWN_WIDTH / 2; p++) {
+        errors += u[p] != 5 * p + 1 || v[p] != 250 - 3 * p;
+        errors += y[1][2 * p] != 6 * p + 2 || y[1][2 * p + 1] != 6 * p + 5;
+    }
+    yuyv_to_nv12(yuyv[0], sizeof(yuyv[0]), y[0], KNOWN_WIDTH, uv, KNOWN_WIDTH, KNOWN_WIDTH, 2);
+    for (int p = 0; p < KNOWN_WIDTH / 2; p++) errors += uv[2 * p] != 5 * p + 1 || uv[2 * p + 1] != 250 - 3 * p;
+
+    memset(uv, 0, sizeof(uv));
+    i420_to_nv12(gray[0], KNOWN_WIDTH, src_u, KNOWN_WIDTH / 2, src_v, KNOWN_WIDTH / 2,
+                 y[0], KNOWN_WIDTH, uv, KNOWN_WIDTH, KNOWN_WIDTH, 2);
+    errors += memcmp(y, gray, sizeof(y)) != 0;
+    for (int p = 0; p < KNOWN_WIDTH / 2; p++) errors += uv[2 * p] != src_u[p] || uv[2 * p + 1] != src_v[p];
+
+    if (errors) printf("Erreur: %s donne %d valeurs différentes des valeurs attendues\n", impl, errors);
+    return errors;
+}
+
+// Débit d'une conversion en mégapixels source par seconde
+static double measure(int conv, Frame *f) {
+    long iterations = 0;
+    double start = now_sec(), elapsed;
+    do {
+        run_conv(conv, f);
+        iterations++;
+        elapsed = now_sec() - start;
+    } while (elapsed < MIN_DURATION);
+    return (double)iterations * f->width * f->height / elapsed / 1e6;
+}
+
+int main(void) {
+    printf("Implémentation choisie: %s\n", colorspace_impl_name());
+
+    // Tailles irrégulières pour tester les fins de ligne et les hauteurs impaires
+    const int check_sizes[][2] = {{2, 1}, {30, 3}, {66, 5}, {98, 17}, {640, 480}, {1282, 721}};
+    int errors = 0;
+    for (size_t i = 0; i < NUM_IMPLS; i++) {
+        if (colorspace_select(impls[i]) == 0) errors += check_known(impls[i]);
+    }
+    for (size_t i = 0; i < sizeof(check_sizes) / sizeof(check_sizes[0]); i++) {
+        errors += check_exact(check_sizes[i][0], check_sizes[i][1]);
+    }
+    if (errors) return EXIT_FAILURE;
+    printf("Valeurs attendues retrouvées, résultats identiques à la version scalaire\n");
+
+    const int sizes[][2] = {{640, 480}, {1280, 720}, {1920, 1080}};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        Frame f;
+        if (frame_alloc(&f, sizes[s][0], sizes[s][1], 0) < 0) return EXIT_FAILURE;
+
+        printf("\n%dx%d (MPix/s)\n%-12s", f.width, f.height, "");
+        for (size_t i = 0; i < NUM_IMPLS; i++) {
+            if (colorspace_select(impls[i]) == 0) printf(" %9s", impls[i]);
+        }
+        printf("\n");
+        for (int conv = 0; conv < NUM_CONVS; conv++) {
+            printf("%-12s", conv_names[conv]);
+            for (size_t i = 0; i < NUM_IMPLS; i++) {
+                if (colorspace_select(impls[i]) == 0) printf(" %9.0f", measure(conv, &f));
+            }
+            printf("\n");
+        }
+        frame_free(&f);
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* bench_entity_db.c - Recherche d'entités : parcours linéaire (ancienne liste allies/enemies)
+ * contre table de hachage, et temps de chargement du format texte contre le format binaire.
+ *
+ * Vérifie aussi que chaque identifiant est retrouvé avec son type dans les deux formats,
+ * et que le registre recharge le fichier modifié.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/ZBar_And_Video/entity_db.h"
+
+#define LINEAR_QUERIES 2000  // Le parcours linéaire est trop lent pour toutes les requêtes
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Ancienne version : strcmp sur chaque entrée de la liste
+static EntityType linear_lookup(char **ids, const EntityType *types, size_t n, const char *id) {
+    for (size_t i = 0; i < n; i++) {
+        if (strcmp(id, ids[i]) == 0) return types[i];
+    }
+    return UNKNOWN;
+}
+
+static int check_db(const char *name, const EntityDb *db, char **ids, const EntityType *types, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (entity_db_lookup(db, ids[i], strlen(ids[i])) != types[i]) {
+            printf("%s : mauvais type pour %s\n", name, ids[i]);
+            return -1;
+        }
+    }
+    if (entity_db_lookup(db, "http://10.0.0.1/absent", 22) != UNKNOWN) {
+        printf("%s : identifiant absent trouvé\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+static int write_text(const char *path, char **ids, const EntityType *types, size_t n) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("Erreur lors de l'ouverture du fichier texte");
+        return -1;
+    }
+    fprintf(f, "# Base générée par bench_entity_db\n");
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "%s %s\n", types[i] == ALLY ? "ALLY" : "TARGET", ids[i]);
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : 100000;
+    const char *text_path = "/tmp/bench_entities.txt";
+    const char *bin_path = "/tmp/bench_entities.edb";
+    if (n < 1) n = 1;
+
+    char **ids = malloc(n * sizeof(*ids));
+    EntityType *types = malloc(n * sizeof(*types));
+    if (!ids || !types) return EXIT_FAILURE;
+    for (size_t i = 0; i < n; i++) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "http://192.168.%zu.%zu/unit-%zu", (i >> 8) & 255, i & 255, i);
+        ids[i] = strdup(buf);
+        types[i] = (i % 3 == 0) ? TARGET : ALLY;
+    }
+    if (write_text(text_path, ids, types, n) < 0) return EXIT_FAILURE;
+
+    // Chargements
+    double start = now_sec();
+    EntityDb *text_db = entity_db_load(text_path);
+    double text_ms = (now_sec() - start) * 1000.0;
+    if (!text_db || entity_db_save(text_db, bin_path) < 0) return EXIT_FAILURE;
+
+    start = now_sec();
+    EntityDb *bin_db = entity_db_load(bin_path);
+    double bin_ms = (now_sec() - start) * 1000.0;
+    if (!bin_db) return EXIT_FAILURE;
+
+    printf("%zu entités\n", n);
+    printf("Chargement texte   %10.3f ms\n", text_ms);
+    printf("Chargement binaire %10.3f ms (mmap)\n", bin_ms);
+
+    if (check_db("texte", text_db, ids, types, n) < 0 || check_db("binaire", bin_db, ids, types, n) < 0) {
+        return EXIT_FAILURE;
+    }
+
+    // Recherches, dans un ordre mélangé pour ne pas favoriser le cache
+    size_t queries = n < LINEAR_QUERIES ? n : LINEAR_QUERIES;
+    unsigned long found = 0;
+    start = now_sec();
+    for (size_t q = 0; q < queries; q++) {
+        size_t i = (q * 7919) % n;
+        if (linear_lookup(ids, types, n, ids[i]) != UNKNOWN) found++;
+    }
+    double linear_us = (now_sec() - start) * 1e6 / queries;
+
+    start = now_sec();
+    for (size_t q = 0; q < n; q++) {
+        size_t i = (q * 7919) % n;
+        if (entity_db_lookup(bin_db, ids[i], strlen(ids[i])) != UNKNOWN) found++;
+    }
+    double hash_us = (now_sec() - start) * 1e6 / n;
+
+    printf("Recherche linéaire %10.3f us/requête\n", linear_us);
+    printf("Recherche hachage  %10.3f us/requête (x%.0f), %lu trouvées\n",
+           hash_us, hash_us > 0 ? linear_us / hash_us : 0.0, found);
+
+    // Rechargement à chaud : le fichier remplacé est pris en compte au contrôle suivant
+    EntityRegistry reg;
+    if (entity_registry_init(&reg, bin_path, NULL) < 0) return EXIT_FAILURE;
+    EntityType before = entity_registry_lookup(&reg, ids[0]);
+    sleep(1);  // mtime à la seconde sur certains systèmes de fichiers
+    types[0] = types[0] == ALLY ? TARGET : ALLY;
+    EntityDb *updated = entity_db_build((const char *const *)ids, types, n);
+    if (!updated || entity_db_save(updated, bin_path) < 0) return EXIT_FAILURE;
+    int reloaded = entity_registry_check(&reg);
+    EntityType after = entity_registry_lookup(&reg, ids[0]);
+    int ok = reloaded == 1 && after == types[0] && before != after;
+    printf("Rechargement       %s (%s -> %s)\n", ok ? "ok" : "ÉCHEC",
+           before == ALLY ? "ALLY" : "TARGET", after == ALLY ? "ALLY" : "TARGET");
+
+    entity_registry_close(&reg);
+    entity_db_free(updated);
+    entity_db_free(bin_db);
+    entity_db_free(text_db);
+    for (size_t i = 0; i < n; i++) free(ids[i]);
+    free(ids);
+    free(types);
+    unlink(text_path);
+    unlink(bin_path);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
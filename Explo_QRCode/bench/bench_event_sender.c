@@ -0,0 +1,149 @@
+/* bench_event_sender.c - Latence et regroupement des événements de détection UDP.
+ *
+ * Un récepteur local (127.0.0.1) décode les datagrammes et vérifie chaque événement.
+ * Mesure la latence d'un événement isolé (ajout -> réception), puis le nombre de
+ * datagrammes utilisés pour une rafale d'événements.
+ */
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/ZBar_And_Video/event_sender.h"
+
+#define PORT 5099
+#define SINGLE_EVENTS 1000
+#define BURST_EVENTS 5000
+#define BURST_SIZE 64  // Événements déjà en file quand le thread d'événements se réveille
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void make_event(DetectionEvent *ev, uint32_t frame_id) {
+    memset(ev, 0, sizeof(*ev));
+    ev->type = frame_id % 7 == 0 ? DETECTION_ALLY_TARGET : DETECTION_ENTITY;
+    ev->entity = frame_id % 2 ? ALLY : TARGET;
+    ev->previous = ev->type == DETECTION_ALLY_TARGET ? ALLY : NONE;
+    ev->stream = frame_id % 3;
+    ev->wall_us = 1700000000000000ULL + frame_id;
+    ev->frame_id = frame_id;
+    ev->n_corners = 4;
+    for (int i = 0; i < 4; i++) {
+        ev->corners[i].x = (int16_t)(100 + i * 50 - (int)(frame_id % 200));
+        ev->corners[i].y = (int16_t)(80 + i * 30);
+    }
+    snprintf(ev->symbol, sizeof(ev->symbol), "http://192.168.8.%u", frame_id % 250);
+}
+
+static int same_event(const DetectionEvent *a, const DetectionEvent *b) {
+    if (a->type != b->type || a->entity != b->entity || a->previous != b->previous ||
+        a->stream != b->stream || a->wall_us != b->wall_us || a->frame_id != b->frame_id ||
+        a->n_corners != b->n_corners || strcmp(a->symbol, b->symbol) != 0) {
+        return 0;
+    }
+    for (int i = 0; i < a->n_corners; i++) {
+        if (a->corners[i].x != b->corners[i].x || a->corners[i].y != b->corners[i].y) return 0;
+    }
+    return 1;
+}
+
+// Lit les datagrammes disponibles, vérifie les événements, retourne le nombre reçus
+static int receive(int sock, uint32_t *next_frame, unsigned long *datagrams, int *errors) {
+    uint8_t buf[2048];
+    int received = 0;
+    ssize_t len;
+    while ((len = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        int count = decode_event_header(buf, len, NULL);
+        if (count < 0) {
+            (*errors)++;
+            continue;
+        }
+        (*datagrams)++;
+        size_t pos = EVENT_HEADER_SIZE;
+        for (int i = 0; i < count; i++) {
+            DetectionEvent ev, expected;
+            int size = decode_detection_event(&ev, buf + pos, len - pos);
+            make_event(&expected, *next_frame);
+            if (size < 0 || !same_event(&ev, &expected)) {
+                (*errors)++;
+                break;
+            }
+            pos += size;
+            (*next_frame)++;
+            received++;
+        }
+    }
+    return received;
+}
+
+int main(void) {
+    int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(rx, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        return EXIT_FAILURE;
+    }
+
+    EventSender sender;
+    if (event_sender_open(&sender, "127.0.0.1", PORT) < 0) return EXIT_FAILURE;
+
+    // Événements isolés : un datagramme chacun, latence ajout -> réception
+    uint32_t frame = 0, next_frame = 0;
+    unsigned long datagrams = 0;
+    int errors = 0;
+    double total_us = 0, max_us = 0;
+    struct pollfd pfd = {rx, POLLIN, 0};
+    for (int i = 0; i < SINGLE_EVENTS; i++) {
+        DetectionEvent ev;
+        make_event(&ev, frame++);
+        double start = now_us();
+        event_sender_add(&sender, &ev);
+        event_sender_flush(&sender);
+        poll(&pfd, 1, 100);
+        receive(rx, &next_frame, &datagrams, &errors);
+        double elapsed = now_us() - start;
+        total_us += elapsed;
+        if (elapsed > max_us) max_us = elapsed;
+    }
+    printf("Isolés  : %d événements, %lu datagrammes, latence moyenne %.1f us (max %.1f us)\n",
+           SINGLE_EVENTS, datagrams, total_us / SINGLE_EVENTS, max_us);
+
+    // Rafale : BURST_SIZE événements en file à chaque réveil, regroupés
+    unsigned long burst_datagrams = 0;
+    double start = now_us();
+    for (int i = 0; i < BURST_EVENTS; i += BURST_SIZE) {
+        for (int j = 0; j < BURST_SIZE && i + j < BURST_EVENTS; j++) {
+            DetectionEvent ev;
+            make_event(&ev, frame++);
+            event_sender_add(&sender, &ev);
+        }
+        event_sender_flush(&sender);
+        receive(rx, &next_frame, &burst_datagrams, &errors);
+    }
+    usleep(10000);
+    receive(rx, &next_frame, &burst_datagrams, &errors);
+    double elapsed = now_us() - start;
+    printf("Rafale  : %d événements, %lu datagrammes (%.1f événements/datagramme), %.0f événements/s\n",
+           BURST_EVENTS, burst_datagrams, burst_datagrams ? (double)BURST_EVENTS / burst_datagrams : 0.0,
+           BURST_EVENTS / (elapsed / 1e6));
+
+    event_sender_close(&sender);
+    event_sender_print_stats(&sender);
+    close(rx);
+
+    int lost = (int)(frame - next_frame);
+    printf("Vérification : %u reçus, %d perdus, %d erreurs\n", next_frame, lost, errors);
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,147 @@
+/* bench_jpeg_decode.c - Débit de décodage JPEG : stb_image contre libjpeg-turbo.
+ *
+ * Usage : ./bench_jpeg_decode image.jpg [image2.jpg ...]
+ *
+ * Les fichiers sont chargés en mémoire puis décodés en boucle pour chaque
+ * configuration utilisée par le projet : RGB pleine résolution (affichage),
+ * niveaux de gris pleine résolution, 1/2 et 1/4 (analyse QR). L'écart moyen
+ * entre les deux décodeurs en niveaux de gris sert de contrôle de cohérence.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/ZBar_And_Video/jpeg_decode.h"
+
+#define MIN_DURATION_MS 1000.0  // Durée minimale de mesure par configuration
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} JpegFile;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int load_file(JpegFile *f, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    f->data = size > 0 ? malloc(size) : NULL;
+    f->size = size;
+    int ok = f->data && fread(f->data, 1, size, file) == (size_t)size;
+    fclose(file);
+    return ok ? 0 : -1;
+}
+
+// Décode toutes les images en boucle, retourne le débit en images/s (-1 si erreur)
+static double measure(const JpegFile *files, int n, int channels, int scale, int *out_w, int *out_h) {
+    DecodedImage img = {0};
+    unsigned long decoded = 0;
+    double start = now_ms(), elapsed;
+    do {
+        for (int i = 0; i < n; i++) {
+            if (image_decode(&img, files[i].data, files[i].size, channels, scale) < 0) {
+                image_free(&img);
+                return -1;
+            }
+            decoded++;
+        }
+        elapsed = now_ms() - start;
+    } while (elapsed < MIN_DURATION_MS);
+    *out_w = img.width;
+    *out_h = img.height;
+    image_free(&img);
+    return decoded * 1000.0 / elapsed;
+}
+
+// Écart moyen par pixel entre les deux décodeurs, en niveaux de gris pleine résolution
+static double gray_difference(const JpegFile *f) {
+    DecodedImage a = {0}, b = {0};
+    double diff = -1;
+    jpeg_decoder_select("stb_image");
+    int ok = image_decode(&a, f->data, f->size, 1, 1) == 0;
+    jpeg_decoder_select("libjpeg-turbo");
+    ok = ok && image_decode(&b, f->data, f->size, 1, 1) == 0;
+    if (ok && a.width == b.width && a.height == b.height) {
+        unsigned long long sum = 0;
+        size_t count = (size_t)a.width * a.height;
+        for (size_t i = 0; i < count; i++) sum += abs(a.pixels[i] - b.pixels[i]);
+        diff = (double)sum / count;
+    }
+    image_free(&a);
+    image_free(&b);
+    return diff;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage : %s image.jpg [image2.jpg ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int n = argc - 1;
+    JpegFile *files = calloc(n, sizeof(JpegFile));
+    size_t total = 0;
+    for (int i = 0; i < n; i++) {
+        if (load_file(&files[i], argv[i + 1]) < 0) return EXIT_FAILURE;
+        total += files[i].size;
+    }
+    printf("%d image(s), %.1f Ko en moyenne\n\n", n, total / 1024.0 / n);
+
+    static const struct {
+        const char *name;
+        int channels;
+        int scale;
+    } configs[] = {
+        {"RGB 1/1", 3, 1},
+        {"gris 1/1", 1, 1},
+        {"gris 1/2", 1, 2},
+        {"gris 1/4", 1, 4},
+    };
+    static const char *decoders[] = {"stb_image", "libjpeg-turbo"};
+
+    printf("%-10s %-14s %11s %12s\n", "Sortie", "Décodeur", "Taille", "Images/s");
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        double reference = 0;
+        for (int d = 0; d < 2; d++) {
+            if (jpeg_decoder_select(decoders[d]) < 0) {
+                printf("%-10s %-14s %11s %12s\n", configs[c].name, decoders[d], "-", "indisponible");
+                continue;
+            }
+            int w = 0, h = 0;
+            double rate = measure(files, n, configs[c].channels, configs[c].scale, &w, &h);
+            if (rate < 0) {
+                fprintf(stderr, "Erreur de décodage avec %s\n", decoders[d]);
+                return EXIT_FAILURE;
+            }
+            char size[32];
+            snprintf(size, sizeof(size), "%dx%d", w, h);
+            printf("%-10s %-14s %11s %12.1f", configs[c].name, decoders[d], size, rate);
+            if (d == 0) {
+                reference = rate;
+                printf("\n");
+            } else {
+                printf("  (x%.1f)\n", reference > 0 ? rate / reference : 0.0);
+            }
+        }
+    }
+
+    if (jpeg_decoder_select("libjpeg-turbo") == 0) {
+        double diff = gray_difference(&files[0]);
+        printf("\nÉcart moyen stb_image / libjpeg-turbo (gris 1/1, %s) : %.2f niveaux\n", argv[1], diff);
+    }
+
+    for (int i = 0; i < n; i++) free(files[i].data);
+    free(files);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/* bench_mjpeg_stream.c - Découpage d'un flux MJPEG reçu par morceaux de 4 Ko.
+ *
+ * Usage : ./bench_mjpeg_stream image.jpg [image2.jpg ...]
+ *
+ * Les images sont concaténées en un flux (avec quelques octets parasites entre
+ * elles) puis découpées en simulant des read() de 4 Ko :
+ *   - ancien découpage du visualiseur : recherche SOI/EOI depuis le début du
+ *     buffer à chaque lecture, puis memmove du reste après chaque image ;
+ *   - MjpegStream : analyseur incrémental et buffer circulaire.
+ * Chaque image trouvée est comparée à l'originale.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../Test_serveur_video/mjpeg_stream.h"
+
+#define CHUNK_SIZE 4096
+#define STREAM_FRAMES 100
+#define LEGACY_BUFFER_SIZE (10 * 1024 * 1024)
+#define RING_SIZE (4 * 1024 * 1024)  // Plus petit que le flux : les images font le tour du buffer
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} JpegFile;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int load_file(JpegFile *f, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    f->data = size > 0 ? malloc(size) : NULL;
+    f->size = size;
+    int ok = f->data && fread(f->data, 1, size, file) == (size_t)size;
+    fclose(file);
+    return ok ? 0 : -1;
+}
+
+// Ancienne version de serveur-test.c
+static int find_jpeg_frame(unsigned char *buf, int len, int *start, int *end) {
+    int i;
+    *start = -1;
+    *end = -1;
+    for (i = 0; i < len - 1; i++) {
+        if (*start == -1 && buf[i] == 0xFF && buf[i + 1] == 0xD8) {
+            *start = i;
+        }
+        if (*start != -1 && buf[i] == 0xFF && buf[i + 1] == 0xD9) {
+            *end = i + 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_frame(const JpegFile *files, int n, unsigned long index, const uint8_t *frame, size_t len) {
+    const JpegFile *f = &files[index % n];
+    return len == f->size && memcmp(frame, f->data, len) == 0;
+}
+
+static unsigned long run_legacy(const uint8_t *stream, size_t size, const JpegFile *files, int n, int *errors) {
+    static unsigned char frame_buffer[LEGACY_BUFFER_SIZE];
+    int frame_buf_len = 0, start, end;
+    unsigned long frames = 0;
+    for (size_t pos = 0; pos < size; pos += CHUNK_SIZE) {
+        size_t chunk = size - pos < CHUNK_SIZE ? size - pos : CHUNK_SIZE;
+        memcpy(frame_buffer + frame_buf_len, stream + pos, chunk);
+        frame_buf_len += chunk;
+        while (find_jpeg_frame(frame_buffer, frame_buf_len, &start, &end)) {
+            if (!check_frame(files, n, frames, frame_buffer + start, end - start + 1)) (*errors)++;
+            frames++;
+            memmove(frame_buffer, frame_buffer + end + 1, frame_buf_len - (end + 1));
+            frame_buf_len -= (end + 1);
+        }
+    }
+    return frames;
+}
+
+static unsigned long run_stream(MjpegStream *s, const uint8_t *stream, size_t size, const JpegFile *files, int n,
+                                int *errors) {
+    const uint8_t *frame;
+    size_t len;
+    unsigned long frames = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        size_t avail;
+        uint8_t *dst = mjpeg_stream_write_ptr(s, &avail);
+        size_t chunk = size - pos < CHUNK_SIZE ? size - pos : CHUNK_SIZE;
+        if (chunk > avail) chunk = avail;
+        memcpy(dst, stream + pos, chunk);  // Tient lieu de read()
+        pos += chunk;
+        mjpeg_stream_commit(s, chunk);
+        while (mjpeg_stream_next_frame(s, &frame, &len)) {
+            if (!check_frame(files, n, frames, frame, len)) (*errors)++;
+            frames++;
+        }
+    }
+    return frames;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage : %s image.jpg [image2.jpg ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int n = argc - 1;
+    JpegFile *files = calloc(n, sizeof(JpegFile));
+    size_t size = 0;
+    for (int i = 0; i < n; i++) {
+        if (load_file(&files[i], argv[i + 1]) < 0) return EXIT_FAILURE;
+        if (files[i].size > RING_SIZE / 2) {
+            fprintf(stderr, "%s : image trop grande\n", argv[i + 1]);
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < STREAM_FRAMES; i++) size += files[i % n].size + i % 3;
+
+    // Flux : images concaténées, 0 à 2 octets parasites après chacune
+    uint8_t *stream = malloc(size);
+    size_t pos = 0;
+    for (int i = 0; i < STREAM_FRAMES; i++) {
+        memcpy(stream + pos, files[i % n].data, files[i % n].size);
+        pos += files[i % n].size;
+        for (int j = 0; j < i % 3; j++) stream[pos++] = 0x55;
+    }
+    printf("Flux : %d images, %.1f Ko par image en moyenne, lectures de %d octets\n\n",
+           STREAM_FRAMES, size / 1024.0 / STREAM_FRAMES, CHUNK_SIZE);
+
+    int legacy_errors = 0, stream_errors = 0;
+    double start = now_ms();
+    unsigned long legacy_frames = run_legacy(stream, size, files, n, &legacy_errors);
+    double legacy_ms = now_ms() - start;
+    printf("%-26s %4lu images, %3d erreurs, %8.2f ms (%.1f Mo/s)\n", "find_jpeg_frame + memmove", legacy_frames,
+           legacy_errors, legacy_ms, size / 1048576.0 / (legacy_ms / 1000.0));
+
+    MjpegStream s;
+    if (mjpeg_stream_init(&s, RING_SIZE) < 0) return EXIT_FAILURE;
+    start = now_ms();
+    unsigned long stream_frames = run_stream(&s, stream, size, files, n, &stream_errors);
+    double stream_ms = now_ms() - start;
+    printf("%-26s %4lu images, %3d erreurs, %8.2f ms (%.1f Mo/s, x%.1f)\n", "MjpegStream", stream_frames,
+           stream_errors, stream_ms, size / 1048576.0 / (stream_ms / 1000.0),
+           stream_ms > 0 ? legacy_ms / stream_ms : 0.0);
+    mjpeg_stream_print_stats(&s);
+    mjpeg_stream_close(&s);
+
+    for (int i = 0; i < n; i++) free(files[i].data);
+    free(files);
+    free(stream);
+    return stream_frames == STREAM_FRAMES && stream_errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,111 @@
+/* bench_zbar.c - Débit du scan QR (frames/s) avant et après le scanner ZBar persistant.
+ *
+ * Les frames viennent d'un enregistrement GRAY8 brut, par exemple :
+ *   gst-launch-1.0 libcamerasrc num-buffers=300 ! video/x-raw,width=640,height=480 ! \
+ *       videoconvert ! video/x-raw,format=GRAY8 ! filesink location=footage.gray
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <zbar.h>
+
+#include "../src/ZBar_And_Video/Decode_QR.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Ancienne version : scanner créé, configuré pour tous les symboles puis détruit à chaque frame
+static int scan_per_frame(const uint8_t *gray, int width, int height) {
+    zbar_image_scanner_t *scanner = zbar_image_scanner_create();
+    zbar_image_scanner_set_config(scanner, 0, ZBAR_CFG_ENABLE, 1);
+    zbar_image_t *image = zbar_image_create();
+    zbar_image_set_format(image, zbar_fourcc('Y', '8', '0', '0'));
+    zbar_image_set_size(image, width, height);
+    zbar_image_set_data(image, gray, (unsigned long)width * height, NULL);
+    int n = zbar_scan_image(scanner, image);
+    zbar_image_destroy(image);
+    zbar_image_scanner_destroy(scanner);
+    return n;
+}
+
+// Rejoue toutes les frames, retourne le débit en frames/s
+static double run(const char *name, QrScanner *scanner, const uint8_t *footage,
+                  int frames, int passes, int width, int height) {
+    size_t frame_size = (size_t)width * height;
+    int found = 0;
+    double start = now_sec();
+    for (int p = 0; p < passes; p++) {
+        for (int i = 0; i < frames; i++) {
+            const uint8_t *gray = footage + i * frame_size;
+            int n = scanner ? qr_scanner_detect(scanner, gray, width, height, width)
+                            : scan_per_frame(gray, width, height);
+            if (n > 0) found++;
+        }
+    }
+    double elapsed = now_sec() - start;
+    double fps = frames * passes / elapsed;
+    printf("%-28s %8.1f fps %8.2f ms/frame %6d frames avec symbole\n",
+           name, fps, 1000.0 / fps, found);
+    return fps;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        printf("Usage: %s <footage.gray> <largeur> <hauteur> [passes]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int width = atoi(argv[2]), height = atoi(argv[3]);
+    int passes = argc > 4 ? atoi(argv[4]) : 1;
+    size_t frame_size = (size_t)width * height;
+    if (width <= 0 || height <= 0 || passes <= 0) {
+        printf("Erreur: dimensions ou nombre de passes invalides\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (!file) {
+        perror("Erreur ouverture enregistrement");
+        return EXIT_FAILURE;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    int frames = (int)(size / frame_size);
+    uint8_t *footage = frames > 0 ? malloc(frames * frame_size) : NULL;
+    if (!footage || fread(footage, frame_size, frames, file) != (size_t)frames) {
+        printf("Erreur: enregistrement vide ou illisible\n");
+        fclose(file);
+        free(footage);
+        return EXIT_FAILURE;
+    }
+    fclose(file);
+    printf("%d frames %dx%d, %d passe(s)\n", frames, width, height, passes);
+
+    double before = run("avant (création par frame)", NULL, footage, frames, passes, width, height);
+
+    // Scanners persistants, QR uniquement
+    struct {
+        const char *name;
+        QrScanMode mode;
+        int cache;
+    } configs[] = {
+        {"persistant", QR_SCAN_FULL, 0},
+        {"persistant + cache", QR_SCAN_FULL, 1},
+        {"persistant + ROI/réduction", QR_SCAN_FAST, 0},
+    };
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        QrScanner scanner;
+        if (qr_scanner_init(&scanner, configs[i].mode, configs[i].cache) < 0) break;
+        double fps = run(configs[i].name, &scanner, footage, frames, passes, width, height);
+        printf("%-28s x%.2f\n", "", fps / before);
+        qr_scanner_close(&scanner);
+    }
+
+    free(footage);
+    return 0;
+}
@@ -6,120 +6,275 @@
 #include <string.h>
 #include <zbar.h>
 #include "Decode_QR.h"
+#include "colorspace.h"
 
-#define DETECTION_TIME 3.0
+#define ROI_MARGIN 0.5    // Marge autour du dernier symbole, en fraction de sa taille
+#define ROI_MIN_SIZE 64   // Côté minimal de la ROI (pixels)
 
-static const char* image_path = "/tmp/cam_frame.jpg";
 
+// Identifie l'entité dans la base courante (NULL : aucune base chargée)
+static EntityType get_entity_type(EntityRegistry* entities, const char* id) {
+    EntityType type = entities ? entity_registry_lookup(entities, id) : UNKNOWN;
+    if (type == ALLY) {
+        printf("ALLY detected : %s\n", id);
+    } else if (type == TARGET) {
+        printf("TARGET detected : %s\n", id);
+    }
+    return type;
+}
 
-// Simuler une base de données
-const char* allies[] = {"http://192.168.8.205", "192.168.8.222", "192.168.8.333"};
-const char* enemies[] = {"http://192.168.8.1", "192.168.8.2", "192.168.8.3"};
-const int num_allies = 3;
-const int num_enemies = 3;
+// Traite un symbole détecté : capture et identification
+static void handle_symbol(QrScanner* s, const zbar_symbol_t* symbol, const uint8_t* gray_data,
+                          int width, int height, int stride) {
+    // Extraction des données du symbole (chaîne de caractères contenue dans le QR code)
+    const char* data = zbar_symbol_get_data(symbol);
+    printf("QR Code détecté : %s\n", data);
 
-typedef enum { 
-    NONE, 
-    ALLY, 
-    TARGET,
-    UNKNOWN,
- } 
-    EntityType;
+    // Capture de l’image dès qu’un QR code est détecté, à partir de la frame analysée.
+    // L'encodage JPEG se fait en arrière-plan : l'analyse ne bloque pas.
+    if (s->snapshots) snapshot_request(s->snapshots, data, gray_data, width, height, stride);
 
-EntityType last_entity_type = NONE;
-time_t last_detection_time = 0;
+    // Identification du type d'entité représentée par le QR code, puis mise à jour de
+    // l'automate du flux (anti-rebond, cas ALLY_TARGET) qui publie les transitions
+    EntityType current_type = get_entity_type(s->entities, data);
+    if (!s->tracker) return;
 
-EntityType get_entity_type(const char* id) {
-    for (int i = 0; i < num_allies; ++i) {
-        if (strcmp(id, allies[i]) == 0) {
-            printf("ALLY detected : %s\n",id);
-            return ALLY;
-        }   
-    }
+    DetectionSighting sighting;
+    sighting.symbol = data;
+    sighting.type = current_type;
+    sighting.frame_id = s->frame_id;
+    sighting.time_ms = detection_now_ms();
 
-    for (int i = 0; i < num_enemies; ++i) {
-        if (strcmp(id, enemies[i]) == 0) {
-            printf("TARGET detected : %s\n",id);
-            return TARGET;
-        } 
+    // Coins du symbole, ramenés de l'image scannée (ROI, 1/2) à la pleine résolution
+    unsigned n = zbar_symbol_get_loc_size(symbol);
+    sighting.n_corners = n < DETECTION_MAX_CORNERS ? (int)n : DETECTION_MAX_CORNERS;
+    for (int i = 0; i < sighting.n_corners; i++) {
+        sighting.corners[i].x = (int16_t)(s->loc_x + zbar_symbol_get_loc_x(symbol, i) * s->loc_scale);
+        sighting.corners[i].y = (int16_t)(s->loc_y + zbar_symbol_get_loc_y(symbol, i) * s->loc_scale);
     }
-    return UNKNOWN;
+    detection_tracker_observe(s->tracker, &sighting);
 }
 
-void capture_image_to_file(const char* filename) {
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "libcamera-jpeg -o %s --width 640 --height 480", filename);
-    int ret = system(cmd);
-    if (ret != 0) {
-        fprintf(stderr, "Erreur lors de la capture de l'image\n");
-    } else {
-        printf("Image capturée : %s\n", filename);
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Agrandit un buffer de travail si nécessaire (réutilisé d'une frame à l'autre)
+static uint8_t* scratch_reserve(QrScratch* scratch, size_t size) {
+    if (scratch->size < size) {
+        uint8_t* data = realloc(scratch->data, size);
+        if (!data) return NULL;
+        scratch->data = data;
+        scratch->size = size;
     }
+    return scratch->data;
 }
 
-// Fonction pour décoder les QR codes à partir d'une image en niveaux de gris
-int decode_qr_from_buffer(uint8_t* gray_data, int width, int height) {
-    // Création d'un scanner ZBar pour la détection de QR codes
-    zbar_image_scanner_t* scanner = zbar_image_scanner_create();
-    
-    // Activation de la détection pour tous les types de symboles (ici, QR codes inclus)
-    zbar_image_scanner_set_config(scanner, 0, ZBAR_CFG_ENABLE, 1);
+int qr_scanner_init(QrScanner* s, QrScanMode mode, int cache) {
+    memset(s, 0, sizeof(*s));
+    s->mode = mode;
+    s->cache = cache;
 
-    // Création d'une image ZBar
-    zbar_image_t* image = zbar_image_create();
+    // Scanner créé une seule fois : la configuration n'est plus refaite à chaque frame
+    s->scanner = zbar_image_scanner_create();
+    s->image = zbar_image_create();
+    if (!s->scanner || !s->image) {
+        fprintf(stderr, "Erreur lors de la création du scanner ZBar\n");
+        qr_scanner_close(s);
+        return -1;
+    }
+
+    // Seuls les QR codes sont recherchés : les décodeurs linéaires (EAN, Code 128...)
+    // ne parcourent plus chaque ligne de l'image pour rien
+    zbar_image_scanner_set_config(s->scanner, 0, ZBAR_CFG_ENABLE, 0);
+    zbar_image_scanner_set_config(s->scanner, ZBAR_QRCODE, ZBAR_CFG_ENABLE, 1);
+
+    // Cache inter-frames : un symbole n'est rapporté qu'une fois tant qu'il reste visible
+    zbar_image_scanner_enable_cache(s->scanner, cache);
 
     // Définition du format de l'image : 'Y800' signifie image en niveaux de gris (8 bits par pixel)
-    zbar_image_set_format(image, zbar_fourcc('Y','8','0','0'));
+    zbar_image_set_format(s->image, zbar_fourcc('Y','8','0','0'));
+    return 0;
+}
 
-    // Définition de la taille de l'image
-    zbar_image_set_size(image, width, height);
+void qr_scanner_close(QrScanner* s) {
+    if (s->image) zbar_image_destroy(s->image);
+    if (s->scanner) zbar_image_scanner_destroy(s->scanner);
+    free(s->roi_buffer.data);
+    free(s->half_buffer.data);
+    free(s->full_buffer.data);
+    memset(s, 0, sizeof(*s));
+}
+
+// Scanne une image en niveaux de gris contiguë avec l'enveloppe réutilisable.
+// Les symboles trouvés restent attachés à s->image jusqu'au scan suivant.
+static int scan_gray(QrScanner* s, const uint8_t* data, int width, int height) {
+    zbar_image_set_size(s->image, width, height);
 
     // Passage des données d'image à ZBar (le buffer est géré par l'appelant, pas libéré ici)
-    zbar_image_set_data(image, gray_data, width * height, NULL);
-
-    // Lancement du scan de l'image à la recherche de codes
-    int n = zbar_scan_image(scanner, image);
-
-    // Si au moins un symbole est détecté
-    if (n > 0) {
-        // Récupération du premier symbole trouvé
-        const zbar_symbol_t* symbol = zbar_image_first_symbol(image);
-
-        // Parcours de tous les symboles détectés
-        for (; symbol; symbol = zbar_symbol_next(symbol)) {
-            // Extraction des données du symbole (chaîne de caractères contenue dans le QR code)
-            const char* data = zbar_symbol_get_data(symbol);
-            printf("QR Code détecté : %s\n", data);
-
-            // Capture de l’image dès qu’un QR code est détecté 
-            capture_image_to_file("/tmp/capture.jpg");
-
-            // Identification du type d'entité représentée par le QR code
-            EntityType current_type = get_entity_type(data);
-            time_t current_time = time(NULL);  // Heure actuelle
-
-            // Si une entité valide est détectée
-            if (current_type != NONE && current_type != UNKNOWN) {
-                // Vérifie s'il s'agit d'une transition rapide entre deux types d'entités différents
-                if (last_entity_type != NONE &&
-                    current_type != last_entity_type &&
-                    difftime(current_time, last_detection_time) <= DETECTION_TIME) {
-                    // Cas particulier où deux entités différentes sont détectées en peu de temps
-                    printf("Cas spécial : ALLY_TARGET détecté\n");
-                }
-
-                // Mise à jour du dernier type détecté et du temps de détection
-                last_entity_type = current_type;
-                last_detection_time = current_time;
-            }
+    zbar_image_set_data(s->image, data, (unsigned long)width * height, NULL);
+
+    return zbar_scan_image(s->scanner, s->image) > 0;
+}
+
+// Met à jour la ROI autour des symboles trouvés. Les coordonnées ZBar sont celles
+// de l'image scannée : scale et (x0, y0) les ramènent à la pleine résolution.
+static void update_roi(QrScanner* s, int scale, int x0, int y0, int width, int height) {
+    QrRoi* roi = &s->roi;
+    s->loc_scale = scale;
+    s->loc_x = x0;
+    s->loc_y = y0;
+    int min_x = width, min_y = height, max_x = -1, max_y = -1;
+    const zbar_symbol_t* symbol = zbar_image_first_symbol(s->image);
+    for (; symbol; symbol = zbar_symbol_next(symbol)) {
+        unsigned n = zbar_symbol_get_loc_size(symbol);
+        for (unsigned i = 0; i < n; i++) {
+            int x = x0 + zbar_symbol_get_loc_x(symbol, i) * scale;
+            int y = y0 + zbar_symbol_get_loc_y(symbol, i) * scale;
+            if (x < min_x) min_x = x;
+            if (x > max_x) max_x = x;
+            if (y < min_y) min_y = y;
+            if (y > max_y) max_y = y;
         }
     }
+    if (max_x < 0) {
+        roi->valid = 0;  // Pas de position fournie par ZBar
+        return;
+    }
 
-    // Libération des ressources ZBar utilisées
-    zbar_image_destroy(image);
-    zbar_image_scanner_destroy(scanner);
+    // Marge pour suivre le symbole s'il bouge d'une frame à l'autre
+    int size = (max_x - min_x > max_y - min_y) ? max_x - min_x : max_y - min_y;
+    int margin = (int)(size * ROI_MARGIN);
+    if (size + 2 * margin < ROI_MIN_SIZE) margin = (ROI_MIN_SIZE - size) / 2;
 
-    // Retourne le nombre de symboles détectés
+    roi->x = min_x - margin < 0 ? 0 : min_x - margin;
+    roi->y = min_y - margin < 0 ? 0 : min_y - margin;
+    roi->w = (max_x + margin >= width ? width - 1 : max_x + margin) - roi->x + 1;
+    roi->h = (max_y + margin >= height ? height - 1 : max_y + margin) - roi->y + 1;
+    roi->valid = 1;
+}
+
+// Niveau ROI : recopie la zone autour du dernier symbole dans un buffer contigu
+static int scan_roi(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride) {
+    const QrRoi* roi = &s->roi;
+    uint8_t* crop = scratch_reserve(&s->roi_buffer, (size_t)roi->w * roi->h);
+    if (!crop) return 0;
+    for (int row = 0; row < roi->h; row++) {
+        memcpy(crop + (size_t)row * roi->w, gray_data + (size_t)(roi->y + row) * stride + roi->x, roi->w);
+    }
+    if (!scan_gray(s, crop, roi->w, roi->h)) return 0;
+    update_roi(s, 1, roi->x, roi->y, width, height);
+    return 1;
+}
+
+// Niveau 1/2 : luminance réduite 2x (4 fois moins de pixels à parcourir)
+static int scan_half(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride) {
+    int half_w = width / 2, half_h = height / 2;
+    uint8_t* half = scratch_reserve(&s->half_buffer, (size_t)half_w * half_h);
+    if (!half) return 0;
+    gray8_downscale_2x(gray_data, stride, half, half_w, width, height);
+    if (!scan_gray(s, half, half_w, half_h)) return 0;
+    update_roi(s, 2, 0, 0, width, height);
+    return 1;
+}
+
+// Pleine résolution : ZBar lit des lignes contiguës, la frame n'est recopiée
+// (dans un buffer réutilisé) que si ses lignes ont du padding
+static int scan_full(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride) {
+    if (stride != width) {
+        uint8_t* packed = scratch_reserve(&s->full_buffer, (size_t)width * height);
+        if (!packed) return 0;
+        for (int row = 0; row < height; row++) {
+            memcpy(packed + (size_t)row * width, gray_data + (size_t)row * stride, width);
+        }
+        gray_data = packed;
+    }
+    if (!scan_gray(s, gray_data, width, height)) return 0;
+    update_roi(s, 1, 0, 0, width, height);
+    return 1;
+}
+
+void qr_scanner_print_stats(const QrScanner* s) {
+    const QrScanStats* st = &s->stats;
+    if (st->frames == 0) return;
+    printf("Scan QR [%s%s]: %lu frames, %lu avec symbole, temps moyen %.2f ms (dernier %.2f ms, max %.2f ms)\n",
+           s->mode == QR_SCAN_FAST ? "rapide" : "pleine résolution", s->cache ? ", cache" : "",
+           st->frames, st->found, st->total_ms / st->frames, st->last_ms, st->max_ms);
+    if (s->mode == QR_SCAN_FAST) {
+        printf("  Scans ROI %lu (trouvés %lu), 1/2 %lu (trouvés %lu), pleine résolution %lu (trouvés %lu)\n",
+               st->scans[QR_LEVEL_ROI], st->hits[QR_LEVEL_ROI], st->scans[QR_LEVEL_HALF],
+               st->hits[QR_LEVEL_HALF], st->scans[QR_LEVEL_FULL], st->hits[QR_LEVEL_FULL]);
+    }
+}
+
+// En mode rapide, on scanne d'abord la ROI du dernier symbole, puis l'image
+// réduite 2x, et la pleine résolution seulement si rien n'a été trouvé.
+int qr_scanner_detect(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride) {
+    double start = now_ms();
+
+    int found = 0;
+    QrScanLevel level = QR_LEVEL_FULL;
+    if (s->mode == QR_SCAN_FAST) {
+        if (s->roi.valid) {
+            s->stats.scans[QR_LEVEL_ROI]++;
+            found = scan_roi(s, gray_data, width, height, stride);
+            level = QR_LEVEL_ROI;
+        }
+        if (!found) {
+            s->stats.scans[QR_LEVEL_HALF]++;
+            found = scan_half(s, gray_data, width, height, stride);
+            level = QR_LEVEL_HALF;
+        }
+    }
+    if (!found) {
+        s->stats.scans[QR_LEVEL_FULL]++;
+        found = scan_full(s, gray_data, width, height, stride);
+        level = QR_LEVEL_FULL;
+    }
+
+    // Temps de scan seul : la gestion des symboles (capture, affichage) n'est pas comptée
+    double elapsed = now_ms() - start;
+    s->stats.frames++;
+    s->stats.last_ms = elapsed;
+    s->stats.total_ms += elapsed;
+    if (elapsed > s->stats.max_ms) s->stats.max_ms = elapsed;
+
+    if (!found) {
+        s->roi.valid = 0;  // Symbole perdu : la prochaine frame repart de l'image réduite
+        return 0;
+    }
+    s->stats.found++;
+    s->stats.hits[level]++;
+
+    int n = 0;
+    const zbar_symbol_t* symbol = zbar_image_first_symbol(s->image);
+    for (; symbol; symbol = zbar_symbol_next(symbol)) n++;
+    return n;
+}
+
+int qr_scanner_handle_symbols(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride) {
+    int n = 0;
+
+    // Parcours de tous les symboles détectés
+    const zbar_symbol_t* symbol = zbar_image_first_symbol(s->image);
+    for (; symbol; symbol = zbar_symbol_next(symbol)) {
+        // Avec le cache, seul le premier décodage fiable (compteur à 0) est traité :
+        // un compteur négatif signale un symbole pas encore confirmé, positif un symbole déjà traité
+        if (s->cache && zbar_symbol_get_count(symbol) != 0) continue;
+
+        handle_symbol(s, symbol, gray_data, width, height, stride);
+        n++;
+    }
     return n;
 }
 
+// Fonction pour décoder les QR codes à partir d'une image en niveaux de gris
+int qr_scanner_scan(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride) {
+    int n = qr_scanner_detect(s, gray_data, width, height, stride);
+    if (n > 0) qr_scanner_handle_symbols(s, gray_data, width, height, stride);
+
+    // Retourne le nombre de symboles détectés
+    return n;
+}
@@ -1,6 +1,90 @@
 #ifndef DECODE_QR_H
 #define DECODE_QR_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <zbar.h>
+#include "detection.h"
+#include "entity_db.h"
+#include "snapshot.h"
+
 int decode_qr(const char* path);
 
-#endif // DECODE_QR_H
\ No newline at end of file
+// Stratégie de scan des frames
+typedef enum {
+    QR_SCAN_FULL,  // Toute la frame en pleine résolution
+    QR_SCAN_FAST,  // ROI du dernier symbole, puis image réduite 2x, puis pleine résolution
+} QrScanMode;
+
+// Niveaux de scan du mode rapide
+typedef enum {
+    QR_LEVEL_ROI,
+    QR_LEVEL_HALF,
+    QR_LEVEL_FULL,
+    QR_LEVELS,
+} QrScanLevel;
+
+// Statistiques de scan (temps ZBar par frame, sans le traitement des symboles)
+typedef struct {
+    unsigned long frames;            // Frames analysées
+    unsigned long found;             // Frames avec au moins un symbole
+    unsigned long scans[QR_LEVELS];  // Scans lancés par niveau
+    unsigned long hits[QR_LEVELS];   // Scans ayant trouvé un symbole, par niveau
+    double last_ms;
+    double total_ms;
+    double max_ms;
+} QrScanStats;
+
+// Zone autour du dernier symbole détecté, en pleine résolution
+typedef struct {
+    int valid;
+    int x, y, w, h;
+} QrRoi;
+
+// Buffer de travail réutilisé d'une frame à l'autre
+typedef struct {
+    uint8_t* data;
+    size_t size;
+} QrScratch;
+
+// Scanner ZBar persistant, configuré une seule fois pour les QR codes.
+// Un scanner par thread d'analyse : ZBar n'est pas thread-safe sur un même scanner.
+typedef struct {
+    zbar_image_scanner_t* scanner;
+    zbar_image_t* image;  // Enveloppe réutilisée, pointe sur les pixels du dernier scan
+    QrScanMode mode;
+    int cache;            // Cache inter-frames de ZBar activé
+    QrRoi roi;
+    QrScratch roi_buffer;
+    QrScratch half_buffer;
+    QrScratch full_buffer;  // Frame recopiée sans padding, si ses lignes en ont
+    QrScanStats stats;
+    SnapshotWorker* snapshots;  // Captures lors des détections, NULL pour les désactiver
+    EntityRegistry* entities;   // Base des entités, partagée entre les scanners
+    DetectionTracker* tracker;  // Automate du flux analysé, NULL pour ne pas suivre les détections
+    uint32_t frame_id;          // Numéro de la frame analysée, repris dans les détections
+    int loc_scale;              // Passage des coordonnées ZBar du dernier scan à la pleine résolution :
+    int loc_x, loc_y;           // x = loc_x + x_zbar * loc_scale
+} QrScanner;
+
+// Crée le scanner, retourne -1 en cas d'erreur
+int qr_scanner_init(QrScanner* s, QrScanMode mode, int cache);
+
+// Cherche les QR codes d'une frame GRAY8 (width x height, lignes de stride octets) sans les traiter.
+// Retourne le nombre de symboles, lisibles avec zbar_image_first_symbol(s->image)
+// jusqu'au scan suivant.
+int qr_scanner_detect(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride);
+
+// Traite les nouveaux symboles du dernier qr_scanner_detect() (capture, identification) pour
+// la même frame, numérotée s->frame_id. L'automate du flux est thread-safe, mais les appels
+// doivent suivre l'ordre des frames. Retourne le nombre de symboles traités.
+int qr_scanner_handle_symbols(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride);
+
+// Cherche les QR codes d'une frame et traite chaque nouveau symbole (detect + handle_symbols).
+// Retourne le nombre de symboles détectés.
+int qr_scanner_scan(QrScanner* s, const uint8_t* gray_data, int width, int height, int stride);
+
+void qr_scanner_print_stats(const QrScanner* s);
+void qr_scanner_close(QrScanner* s);
+
+#endif // DECODE_QR_H
@@ -0,0 +1,469 @@
+#include "colorspace.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Noyaux d'une implémentation : chacun traite une ligne (ou une paire de lignes),
+// les boucles sur les plans sont communes. Les versions SIMD traitent des blocs
+// entiers et laissent la fin de ligne aux versions scalaires.
+typedef struct {
+    const char *name;
+    void (*gray_row)(const uint8_t *src, uint8_t *dst, int width);
+    void (*i420_rows)(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                      uint8_t *u, uint8_t *v, int width);
+    void (*nv12_rows)(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                      uint8_t *uv, int width);
+    void (*interleave_row)(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n);
+    void (*downscale_row)(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width);
+} ColorspaceImpl;
+
+/*------------------------------------------------------------------------------------------*/
+// Versions scalaires (référence), à partir du pixel x
+
+static void gray_row_from(const uint8_t *src, uint8_t *dst, int x, int width) {
+    for (; x < width; x++) {
+        dst[x] = src[2 * x];
+    }
+}
+
+static void i420_rows_from(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *u, uint8_t *v, int x, int width) {
+    for (; x < width; x += 2) {
+        const uint8_t *p0 = s0 + 2 * x, *p1 = s1 + 2 * x;
+        y0[x] = p0[0];
+        y0[x + 1] = p0[2];
+        y1[x] = p1[0];
+        y1[x + 1] = p1[2];
+        u[x / 2] = (uint8_t)((p0[1] + p1[1] + 1) >> 1);
+        v[x / 2] = (uint8_t)((p0[3] + p1[3] + 1) >> 1);
+    }
+}
+
+static void nv12_rows_from(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *uv, int x, int width) {
+    for (; x < width; x += 2) {
+        const uint8_t *p0 = s0 + 2 * x, *p1 = s1 + 2 * x;
+        y0[x] = p0[0];
+        y0[x + 1] = p0[2];
+        y1[x] = p1[0];
+        y1[x + 1] = p1[2];
+        uv[x] = (uint8_t)((p0[1] + p1[1] + 1) >> 1);
+        uv[x + 1] = (uint8_t)((p0[3] + p1[3] + 1) >> 1);
+    }
+}
+
+static void interleave_row_from(const uint8_t *u, const uint8_t *v, uint8_t *uv, int i, int n) {
+    for (; i < n; i++) {
+        uv[2 * i] = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+}
+
+static void downscale_row_from(const uint8_t *s0, const uint8_t *s1, uint8_t *dst,
+                               int x, int dst_width) {
+    for (; x < dst_width; x++) {
+        dst[x] = (uint8_t)((s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1] + 2) >> 2);
+    }
+}
+
+static void gray_row_scalar(const uint8_t *src, uint8_t *dst, int width) {
+    gray_row_from(src, dst, 0, width);
+}
+
+static void i420_rows_scalar(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                             uint8_t *u, uint8_t *v, int width) {
+    i420_rows_from(s0, s1, y0, y1, u, v, 0, width);
+}
+
+static void nv12_rows_scalar(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                             uint8_t *uv, int width) {
+    nv12_rows_from(s0, s1, y0, y1, uv, 0, width);
+}
+
+static void interleave_row_scalar(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n) {
+    interleave_row_from(u, v, uv, 0, n);
+}
+
+static void downscale_row_scalar(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width) {
+    downscale_row_from(s0, s1, dst, 0, dst_width);
+}
+
+static const ColorspaceImpl impl_scalar = {
+    "scalar", gray_row_scalar, i420_rows_scalar, nv12_rows_scalar,
+    interleave_row_scalar, downscale_row_scalar
+};
+
+/*------------------------------------------------------------------------------------------*/
+#if defined(__x86_64__) || defined(__i386__)
+
+// SSE2 : 16 pixels par itération. Les octets pairs d'une ligne YUYV sont la
+// luminance, les impairs la chrominance U0 V0 U1 V1...
+__attribute__((target("sse2")))
+static void gray_row_sse2(const uint8_t *src, uint8_t *dst, int width) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 2 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 2 * x + 16));
+        __m128i y = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+        _mm_storeu_si128((__m128i *)(dst + x), y);
+    }
+    gray_row_from(src, dst, x, width);
+}
+
+// Luminance des deux lignes et chrominance moyennée (U V entrelacés) de 16 pixels
+__attribute__((target("sse2")))
+static inline __m128i yuyv_pair_sse2(const uint8_t *s0, const uint8_t *s1,
+                                     uint8_t *y0, uint8_t *y1) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    __m128i a0 = _mm_loadu_si128((const __m128i *)s0);
+    __m128i a1 = _mm_loadu_si128((const __m128i *)(s0 + 16));
+    __m128i b0 = _mm_loadu_si128((const __m128i *)s1);
+    __m128i b1 = _mm_loadu_si128((const __m128i *)(s1 + 16));
+    _mm_storeu_si128((__m128i *)y0,
+                     _mm_packus_epi16(_mm_and_si128(a0, mask), _mm_and_si128(a1, mask)));
+    _mm_storeu_si128((__m128i *)y1,
+                     _mm_packus_epi16(_mm_and_si128(b0, mask), _mm_and_si128(b1, mask)));
+    __m128i c0 = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8));
+    __m128i c1 = _mm_packus_epi16(_mm_srli_epi16(b0, 8), _mm_srli_epi16(b1, 8));
+    return _mm_avg_epu8(c0, c1);  // (a + b + 1) >> 1, comme la version scalaire
+}
+
+__attribute__((target("sse2")))
+static void i420_rows_sse2(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *u, uint8_t *v, int width) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i c = yuyv_pair_sse2(s0 + 2 * x, s1 + 2 * x, y0 + x, y1 + x);
+        __m128i cu = _mm_packus_epi16(_mm_and_si128(c, mask), _mm_setzero_si128());
+        __m128i cv = _mm_packus_epi16(_mm_srli_epi16(c, 8), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i *)(u + x / 2), cu);
+        _mm_storel_epi64((__m128i *)(v + x / 2), cv);
+    }
+    i420_rows_from(s0, s1, y0, y1, u, v, x, width);
+}
+
+__attribute__((target("sse2")))
+static void nv12_rows_sse2(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *uv, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i c = yuyv_pair_sse2(s0 + 2 * x, s1 + 2 * x, y0 + x, y1 + x);
+        _mm_storeu_si128((__m128i *)(uv + x), c);
+    }
+    nv12_rows_from(s0, s1, y0, y1, uv, x, width);
+}
+
+__attribute__((target("sse2")))
+static void interleave_row_sse2(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(u + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(v + i));
+        _mm_storeu_si128((__m128i *)(uv + 2 * i), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128((__m128i *)(uv + 2 * i + 16), _mm_unpackhi_epi8(a, b));
+    }
+    interleave_row_from(u, v, uv, i, n);
+}
+
+// Somme des paires d'octets voisins d'un bloc de 16 octets, sur 16 bits
+__attribute__((target("sse2")))
+static inline __m128i pair_sum_sse2(__m128i a) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    return _mm_add_epi16(_mm_and_si128(a, mask), _mm_srli_epi16(a, 8));
+}
+
+__attribute__((target("sse2")))
+static void downscale_row_sse2(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width) {
+    const __m128i two = _mm_set1_epi16(2);
+    int x = 0;
+    for (; x + 16 <= dst_width; x += 16) {
+        __m128i lo = _mm_add_epi16(pair_sum_sse2(_mm_loadu_si128((const __m128i *)(s0 + 2 * x))),
+                                   pair_sum_sse2(_mm_loadu_si128((const __m128i *)(s1 + 2 * x))));
+        __m128i hi = _mm_add_epi16(pair_sum_sse2(_mm_loadu_si128((const __m128i *)(s0 + 2 * x + 16))),
+                                   pair_sum_sse2(_mm_loadu_si128((const __m128i *)(s1 + 2 * x + 16))));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    downscale_row_from(s0, s1, dst, x, dst_width);
+}
+
+static const ColorspaceImpl impl_sse2 = {
+    "sse2", gray_row_sse2, i420_rows_sse2, nv12_rows_sse2,
+    interleave_row_sse2, downscale_row_sse2
+};
+
+// AVX2 : 32 pixels par itération. packus travaille dans chaque moitié de 128 bits,
+// permute4x64(0xD8) remet les 64 bits du résultat dans l'ordre des pixels.
+__attribute__((target("avx2")))
+static inline __m256i pack_ordered_avx2(__m256i a, __m256i b) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+}
+
+__attribute__((target("avx2")))
+static void gray_row_avx2(const uint8_t *src, uint8_t *dst, int width) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + 2 * x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 2 * x + 32));
+        __m256i y = pack_ordered_avx2(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        _mm256_storeu_si256((__m256i *)(dst + x), y);
+    }
+    gray_row_from(src, dst, x, width);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i yuyv_pair_avx2(const uint8_t *s0, const uint8_t *s1,
+                                     uint8_t *y0, uint8_t *y1) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    __m256i a0 = _mm256_loadu_si256((const __m256i *)s0);
+    __m256i a1 = _mm256_loadu_si256((const __m256i *)(s0 + 32));
+    __m256i b0 = _mm256_loadu_si256((const __m256i *)s1);
+    __m256i b1 = _mm256_loadu_si256((const __m256i *)(s1 + 32));
+    _mm256_storeu_si256((__m256i *)y0,
+                        pack_ordered_avx2(_mm256_and_si256(a0, mask), _mm256_and_si256(a1, mask)));
+    _mm256_storeu_si256((__m256i *)y1,
+                        pack_ordered_avx2(_mm256_and_si256(b0, mask), _mm256_and_si256(b1, mask)));
+    __m256i c0 = pack_ordered_avx2(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(a1, 8));
+    __m256i c1 = pack_ordered_avx2(_mm256_srli_epi16(b0, 8), _mm256_srli_epi16(b1, 8));
+    return _mm256_avg_epu8(c0, c1);
+}
+
+__attribute__((target("avx2")))
+static void i420_rows_avx2(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *u, uint8_t *v, int width) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i c = yuyv_pair_avx2(s0 + 2 * x, s1 + 2 * x, y0 + x, y1 + x);
+        __m256i cu = _mm256_and_si256(c, mask);
+        __m256i cv = _mm256_srli_epi16(c, 8);
+        _mm_storeu_si128((__m128i *)(u + x / 2), _mm256_castsi256_si128(pack_ordered_avx2(cu, cu)));
+        _mm_storeu_si128((__m128i *)(v + x / 2), _mm256_castsi256_si128(pack_ordered_avx2(cv, cv)));
+    }
+    i420_rows_from(s0, s1, y0, y1, u, v, x, width);
+}
+
+__attribute__((target("avx2")))
+static void nv12_rows_avx2(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *uv, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i c = yuyv_pair_avx2(s0 + 2 * x, s1 + 2 * x, y0 + x, y1 + x);
+        _mm256_storeu_si256((__m256i *)(uv + x), c);
+    }
+    nv12_rows_from(s0, s1, y0, y1, uv, x, width);
+}
+
+__attribute__((target("avx2")))
+static void interleave_row_avx2(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        // Après la permutation, chaque moitié de 128 bits contient les octets à entrelacer ensemble
+        __m256i a = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(u + i)), 0xD8);
+        __m256i b = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(v + i)), 0xD8);
+        _mm256_storeu_si256((__m256i *)(uv + 2 * i), _mm256_unpacklo_epi8(a, b));
+        _mm256_storeu_si256((__m256i *)(uv + 2 * i + 32), _mm256_unpackhi_epi8(a, b));
+    }
+    interleave_row_from(u, v, uv, i, n);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pair_sum_avx2(__m256i a) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    return _mm256_add_epi16(_mm256_and_si256(a, mask), _mm256_srli_epi16(a, 8));
+}
+
+__attribute__((target("avx2")))
+static void downscale_row_avx2(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width) {
+    const __m256i two = _mm256_set1_epi16(2);
+    int x = 0;
+    for (; x + 32 <= dst_width; x += 32) {
+        __m256i lo = _mm256_add_epi16(pair_sum_avx2(_mm256_loadu_si256((const __m256i *)(s0 + 2 * x))),
+                                      pair_sum_avx2(_mm256_loadu_si256((const __m256i *)(s1 + 2 * x))));
+        __m256i hi = _mm256_add_epi16(pair_sum_avx2(_mm256_loadu_si256((const __m256i *)(s0 + 2 * x + 32))),
+                                      pair_sum_avx2(_mm256_loadu_si256((const __m256i *)(s1 + 2 * x + 32))));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, two), 2);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, two), 2);
+        _mm256_storeu_si256((__m256i *)(dst + x), pack_ordered_avx2(lo, hi));
+    }
+    downscale_row_from(s0, s1, dst, x, dst_width);
+}
+
+static const ColorspaceImpl impl_avx2 = {
+    "avx2", gray_row_avx2, i420_rows_avx2, nv12_rows_avx2,
+    interleave_row_avx2, downscale_row_avx2
+};
+
+/*------------------------------------------------------------------------------------------*/
+#elif defined(__aarch64__)
+
+// NEON : vld2/vld4 désentrelacent les lignes YUYV directement au chargement
+static void gray_row_neon(const uint8_t *src, uint8_t *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t p = vld2q_u8(src + 2 * x);  // val[0] = Y, val[1] = U/V
+        vst1q_u8(dst + x, p.val[0]);
+    }
+    gray_row_from(src, dst, x, width);
+}
+
+// 32 pixels : val[0] = Y pairs, val[1] = U, val[2] = Y impairs, val[3] = V
+static void i420_rows_neon(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *u, uint8_t *v, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        uint8x16x4_t a = vld4q_u8(s0 + 2 * x);
+        uint8x16x4_t b = vld4q_u8(s1 + 2 * x);
+        vst2q_u8(y0 + x, (uint8x16x2_t){{a.val[0], a.val[2]}});
+        vst2q_u8(y1 + x, (uint8x16x2_t){{b.val[0], b.val[2]}});
+        vst1q_u8(u + x / 2, vrhaddq_u8(a.val[1], b.val[1]));  // (a + b + 1) >> 1
+        vst1q_u8(v + x / 2, vrhaddq_u8(a.val[3], b.val[3]));
+    }
+    i420_rows_from(s0, s1, y0, y1, u, v, x, width);
+}
+
+static void nv12_rows_neon(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *uv, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        uint8x16x4_t a = vld4q_u8(s0 + 2 * x);
+        uint8x16x4_t b = vld4q_u8(s1 + 2 * x);
+        vst2q_u8(y0 + x, (uint8x16x2_t){{a.val[0], a.val[2]}});
+        vst2q_u8(y1 + x, (uint8x16x2_t){{b.val[0], b.val[2]}});
+        vst2q_u8(uv + x, (uint8x16x2_t){{vrhaddq_u8(a.val[1], b.val[1]),
+                                          vrhaddq_u8(a.val[3], b.val[3])}});
+    }
+    nv12_rows_from(s0, s1, y0, y1, uv, x, width);
+}
+
+static void interleave_row_neon(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        vst2q_u8(uv + 2 * i, (uint8x16x2_t){{vld1q_u8(u + i), vld1q_u8(v + i)}});
+    }
+    interleave_row_from(u, v, uv, i, n);
+}
+
+static void downscale_row_neon(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width) {
+    int x = 0;
+    for (; x + 16 <= dst_width; x += 16) {
+        // Somme des paires horizontales sur 16 bits, puis de la ligne suivante
+        uint16x8_t lo = vpadalq_u8(vpaddlq_u8(vld1q_u8(s0 + 2 * x)), vld1q_u8(s1 + 2 * x));
+        uint16x8_t hi = vpadalq_u8(vpaddlq_u8(vld1q_u8(s0 + 2 * x + 16)), vld1q_u8(s1 + 2 * x + 16));
+        vst1q_u8(dst + x, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));  // (s + 2) >> 2
+    }
+    downscale_row_from(s0, s1, dst, x, dst_width);
+}
+
+static const ColorspaceImpl impl_neon = {
+    "neon", gray_row_neon, i420_rows_neon, nv12_rows_neon,
+    interleave_row_neon, downscale_row_neon
+};
+#endif
+
+/*------------------------------------------------------------------------------------------*/
+
+static const ColorspaceImpl *impl = &impl_scalar;
+
+// Retourne l'implémentation demandée si le processeur la supporte, NULL sinon
+static const ColorspaceImpl *find_impl(const char *name) {
+    if (strcmp(name, "scalar") == 0) return &impl_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) return &impl_sse2;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) return &impl_avx2;
+#elif defined(__aarch64__)
+    if (strcmp(name, "neon") == 0) return &impl_neon;  // NEON fait partie d'ARMv8
+#endif
+    return NULL;
+}
+
+// Choisit l'implémentation la plus rapide au chargement du programme
+__attribute__((constructor))
+static void colorspace_init(void) {
+    const char *preferred[] = {"neon", "avx2", "sse2"};
+    for (size_t i = 0; i < sizeof(preferred) / sizeof(preferred[0]); i++) {
+        const ColorspaceImpl *found = find_impl(preferred[i]);
+        if (found) {
+            impl = found;
+            return;
+        }
+    }
+}
+
+const char *colorspace_impl_name(void) {
+    return impl->name;
+}
+
+int colorspace_select(const char *name) {
+    const ColorspaceImpl *found = find_impl(name);
+    if (!found) return -1;
+    impl = found;
+    return 0;
+}
+
+/*------------------------------------------------------------------------------------------*/
+
+void yuyv_to_gray8(const uint8_t *src, int src_stride, uint8_t *dst, int dst_stride,
+                   int width, int height) {
+    width &= ~1;
+    for (int row = 0; row < height; row++) {
+        impl->gray_row(src + (size_t)row * src_stride, dst + (size_t)row * dst_stride, width);
+    }
+}
+
+void yuyv_to_i420(const uint8_t *src, int src_stride,
+                  uint8_t *y, int y_stride, uint8_t *u, int u_stride, uint8_t *v, int v_stride,
+                  int width, int height) {
+    width &= ~1;
+    for (int row = 0; row < height; row += 2) {
+        // Hauteur impaire : la dernière ligne est sa propre voisine
+        int next = row + 1 < height ? row + 1 : row;
+        impl->i420_rows(src + (size_t)row * src_stride, src + (size_t)next * src_stride,
+                        y + (size_t)row * y_stride, y + (size_t)next * y_stride,
+                        u + (size_t)(row / 2) * u_stride, v + (size_t)(row / 2) * v_stride, width);
+    }
+}
+
+void yuyv_to_nv12(const uint8_t *src, int src_stride,
+                  uint8_t *y, int y_stride, uint8_t *uv, int uv_stride,
+                  int width, int height) {
+    width &= ~1;
+    for (int row = 0; row < height; row += 2) {
+        int next = row + 1 < height ? row + 1 : row;
+        impl->nv12_rows(src + (size_t)row * src_stride, src + (size_t)next * src_stride,
+                        y + (size_t)row * y_stride, y + (size_t)next * y_stride,
+                        uv + (size_t)(row / 2) * uv_stride, width);
+    }
+}
+
+void i420_to_nv12(const uint8_t *y, int y_stride, const uint8_t *u, int u_stride,
+                  const uint8_t *v, int v_stride,
+                  uint8_t *dst_y, int dst_y_stride, uint8_t *dst_uv, int dst_uv_stride,
+                  int width, int height) {
+    width &= ~1;
+    for (int row = 0; row < height; row++) {
+        memcpy(dst_y + (size_t)row * dst_y_stride, y + (size_t)row * y_stride, width);
+    }
+    for (int row = 0; row < (height + 1) / 2; row++) {
+        impl->interleave_row(u + (size_t)row * u_stride, v + (size_t)row * v_stride,
+                             dst_uv + (size_t)row * dst_uv_stride, width / 2);
+    }
+}
+
+void gray8_downscale_2x(const uint8_t *src, int src_stride, uint8_t *dst, int dst_stride,
+                        int width, int height) {
+    for (int row = 0; row < height / 2; row++) {
+        const uint8_t *s0 = src + (size_t)(2 * row) * src_stride;
+        impl->downscale_row(s0, s0 + src_stride, dst + (size_t)row * dst_stride, width / 2);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef COLORSPACE_H
+#define COLORSPACE_H
+
+#include <stdint.h>
+
+// Conversions d'espace colorimétrique pour préparer les frames de la caméra
+// (YUYV V4L2, I420 libcamera) sans passer par videoconvert/videoscale ni ffmpeg.
+// Utilise NEON (Raspberry Pi, aarch64), AVX2 ou SSE2 (x86) quand le processeur
+// les supporte, sinon une version scalaire qui sert aussi de référence : toutes
+// les implémentations donnent exactement les mêmes octets.
+//
+// Les strides sont en octets et peuvent dépasser la largeur utile (buffers V4L2,
+// GstVideoFrame). Les largeurs YUYV, I420 et NV12 sont arrondies au pair inférieur.
+
+// YUYV -> GRAY8 : extraction de la luminance (image Y800 pour ZBar)
+void yuyv_to_gray8(const uint8_t *src, int src_stride, uint8_t *dst, int dst_stride,
+                   int width, int height);
+
+// YUYV 4:2:2 -> I420 4:2:0 : la chrominance de deux lignes est moyennée (arrondi au supérieur).
+// Les plans U et V font (width / 2) x ((height + 1) / 2).
+void yuyv_to_i420(const uint8_t *src, int src_stride,
+                  uint8_t *y, int y_stride, uint8_t *u, int u_stride, uint8_t *v, int v_stride,
+                  int width, int height);
+
+// YUYV 4:2:2 -> NV12 : même sous-échantillonnage, U et V entrelacés dans un seul plan
+void yuyv_to_nv12(const uint8_t *src, int src_stride,
+                  uint8_t *y, int y_stride, uint8_t *uv, int uv_stride,
+                  int width, int height);
+
+// I420 -> NV12 : copie du plan Y et entrelacement des plans U et V
+void i420_to_nv12(const uint8_t *y, int y_stride, const uint8_t *u, int u_stride,
+                  const uint8_t *v, int v_stride,
+                  uint8_t *dst_y, int dst_y_stride, uint8_t *dst_uv, int dst_uv_stride,
+                  int width, int height);
+
+// Réduction 2x d'une image GRAY8 (moyenne de chaque bloc 2x2, arrondie au plus proche).
+// width et height sont ceux de la source, la destination fait (width / 2) x (height / 2).
+void gray8_downscale_2x(const uint8_t *src, int src_stride, uint8_t *dst, int dst_stride,
+                        int width, int height);
+
+// Nom de l'implémentation utilisée ("neon", "avx2", "sse2" ou "scalar")
+const char *colorspace_impl_name(void);
+
+// Force une implémentation (comparaison des performances et de l'exactitude).
+// Retourne -1 si elle n'existe pas ou n'est pas supportée par ce processeur.
+// À appeler avant de lancer les threads qui convertissent des frames.
+int colorspace_select(const char *name);
+
+#endif // COLORSPACE_H
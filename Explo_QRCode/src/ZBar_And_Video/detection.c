@@ -0,0 +1,217 @@
+#include "detection.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+uint64_t detection_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+const char* detection_event_name(DetectionEventType type) {
+    switch (type) {
+        case DETECTION_ENTITY: return "ENTITY";
+        case DETECTION_ALLY_TARGET: return "ALLY_TARGET";
+        case DETECTION_LOST: return "LOST";
+    }
+    return "?";
+}
+
+/*------------------------------------------------------------------------------------------*/
+
+void detection_queue_init(DetectionQueue* q) {
+    memset(q, 0, sizeof(*q));
+    pthread_mutex_init(&q->lock, NULL);
+
+    // Attente sur l'horloge monotone : insensible aux changements d'heure système
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->not_empty, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void detection_queue_push(DetectionQueue* q, const DetectionEvent* ev) {
+    pthread_mutex_lock(&q->lock);
+    if (q->count == DETECTION_QUEUE_SIZE) {
+        // Consommateur trop lent : on garde les événements les plus récents
+        q->head = (q->head + 1) % DETECTION_QUEUE_SIZE;
+        q->count--;
+        q->dropped++;
+    }
+    q->events[(q->head + q->count) % DETECTION_QUEUE_SIZE] = *ev;
+    q->count++;
+    q->pushed++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+int detection_queue_pop(DetectionQueue* q, DetectionEvent* ev, int timeout_ms) {
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&q->not_empty, &q->lock);
+        } else if (pthread_cond_timedwait(&q->not_empty, &q->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    int ret;
+    if (q->count > 0) {
+        *ev = q->events[q->head];
+        q->head = (q->head + 1) % DETECTION_QUEUE_SIZE;
+        q->count--;
+        ret = 1;
+    } else {
+        ret = q->closed ? -1 : 0;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+void detection_queue_close(DetectionQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+void detection_queue_destroy(DetectionQueue* q) {
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->lock);
+}
+
+/*------------------------------------------------------------------------------------------*/
+
+void detection_tracker_init(DetectionTracker* t, int stream, DetectionQueue* queue) {
+    memset(t, 0, sizeof(*t));
+    t->stream = stream;
+    t->queue = queue;
+    t->last_type = NONE;
+    pthread_mutex_init(&t->lock, NULL);
+}
+
+static uint64_t wall_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Appelé verrou pris. sighting est NULL pour LOST.
+static void emit(DetectionTracker* t, DetectionEventType type, EntityType entity, EntityType previous,
+                 const DetectionSighting* sighting, uint64_t now_ms) {
+    DetectionEvent ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = type;
+    ev.stream = t->stream;
+    ev.entity = entity;
+    ev.previous = previous;
+    ev.time_ms = now_ms;
+    ev.wall_us = wall_clock_us();
+    ev.frame_id = t->last_frame;
+    if (sighting) {
+        ev.frame_id = sighting->frame_id;
+        ev.n_corners = sighting->n_corners;
+        memcpy(ev.corners, sighting->corners, sizeof(ev.corners));
+        snprintf(ev.symbol, sizeof(ev.symbol), "%s", sighting->symbol);
+    }
+    t->events++;
+    if (t->queue) detection_queue_push(t->queue, &ev);
+}
+
+// Entrée du code dans la table d'anti-rebond, NULL s'il n'y est pas
+static DetectionSeen* seen_find(DetectionTracker* t, const char* symbol) {
+    for (int i = 0; i < DETECTION_SYMBOLS; i++) {
+        if (t->seen[i].symbol[0] && strncmp(t->seen[i].symbol, symbol, DETECTION_MAX_SYMBOL_LEN - 1) == 0) {
+            return &t->seen[i];
+        }
+    }
+    return NULL;
+}
+
+// Nouvelle entrée : emplacement libre, sinon le code vu le moins récemment
+static DetectionSeen* seen_add(DetectionTracker* t, const char* symbol) {
+    DetectionSeen* oldest = &t->seen[0];
+    for (int i = 0; i < DETECTION_SYMBOLS; i++) {
+        if (!t->seen[i].symbol[0]) {
+            oldest = &t->seen[i];
+            break;
+        }
+        if (t->seen[i].last_ms < oldest->last_ms) oldest = &t->seen[i];
+    }
+    snprintf(oldest->symbol, sizeof(oldest->symbol), "%s", symbol);
+    return oldest;
+}
+
+void detection_tracker_observe(DetectionTracker* t, const DetectionSighting* sighting) {
+    const char* symbol = sighting->symbol;
+    EntityType type = sighting->type;
+    uint64_t now_ms = sighting->time_ms;
+    int valid = type == ALLY || type == TARGET;
+
+    pthread_mutex_lock(&t->lock);
+    t->observed++;
+
+    // Anti-rebond : un code resté visible ne produit qu'un seul événement
+    DetectionSeen* seen = seen_find(t, symbol);
+    if (seen && now_ms < seen->last_ms + DETECTION_DEBOUNCE_MS) {
+        if (now_ms > seen->last_ms) seen->last_ms = now_ms;
+        if (valid && now_ms > t->last_ms) {
+            t->last_ms = now_ms;  // L'entité est toujours suivie
+            t->last_frame = sighting->frame_id;
+        }
+        t->debounced++;
+        pthread_mutex_unlock(&t->lock);
+        return;
+    }
+    if (!seen) seen = seen_add(t, symbol);
+    seen->last_ms = now_ms;
+
+    emit(t, DETECTION_ENTITY, valid ? type : UNKNOWN, NONE, sighting, now_ms);
+
+    if (valid) {
+        // Transition rapide entre deux types d'entités différents
+        if (t->last_type != NONE && type != t->last_type &&
+            now_ms <= t->last_ms + DETECTION_WINDOW_MS) {
+            emit(t, DETECTION_ALLY_TARGET, type, t->last_type, sighting, now_ms);
+        }
+        t->last_type = type;
+        if (now_ms > t->last_ms) t->last_ms = now_ms;
+        t->last_frame = sighting->frame_id;
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+void detection_tracker_tick(DetectionTracker* t, uint64_t now_ms) {
+    pthread_mutex_lock(&t->lock);
+    if (t->last_type != NONE && now_ms > t->last_ms + DETECTION_LOST_MS) {
+        emit(t, DETECTION_LOST, t->last_type, NONE, NULL, now_ms);
+        t->last_type = NONE;
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+void detection_tracker_print_stats(DetectionTracker* t) {
+    pthread_mutex_lock(&t->lock);
+    printf("Détections flux %d : %lu codes reçus, %lu ignorés (anti-rebond), %lu événements\n",
+           t->stream, t->observed, t->debounced, t->events);
+    pthread_mutex_unlock(&t->lock);
+}
+
+void detection_tracker_destroy(DetectionTracker* t) {
+    pthread_mutex_destroy(&t->lock);
+}
@@ -0,0 +1,124 @@
+#ifndef DETECTION_H
+#define DETECTION_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "entity_db.h"
+
+// Suivi des détections d'un flux vidéo. Chaque flux a son propre automate
+// (dernière entité, horodatage monotone en ms, codes vus récemment) ; les
+// transitions sont publiées sous forme d'événements dans une file que d'autres
+// threads consomment (affichage, envoi réseau...).
+//
+// États : aucune entité suivie (NONE) ou entité de type ALLY / TARGET suivie.
+//   - un code valide pas vu récemment        -> DETECTION_ENTITY
+//   - type différent en moins de WINDOW_MS   -> DETECTION_ALLY_TARGET en plus
+//   - aucune entité pendant LOST_MS          -> DETECTION_LOST, retour à NONE
+// Un même code revu moins de DEBOUNCE_MS après sa dernière apparition n'émet rien.
+
+#define DETECTION_WINDOW_MS 3000    // Délai max entre deux entités pour le cas ALLY_TARGET
+#define DETECTION_DEBOUNCE_MS 1000  // Absence nécessaire avant de signaler à nouveau un code
+#define DETECTION_LOST_MS 3000      // Absence de toute entité avant de revenir à l'état initial
+#define DETECTION_SYMBOLS 32        // Codes suivis pour l'anti-rebond
+#define DETECTION_MAX_SYMBOL_LEN 128
+#define DETECTION_QUEUE_SIZE 64
+#define DETECTION_MAX_CORNERS 4     // Coins d'un QR code fournis par ZBar
+
+typedef enum {
+    DETECTION_ENTITY,       // Entité (ALLY, TARGET ou UNKNOWN) nouvellement détectée
+    DETECTION_ALLY_TARGET,  // Deux types d'entités différents en moins de DETECTION_WINDOW_MS
+    DETECTION_LOST,         // Plus d'entité détectée depuis DETECTION_LOST_MS
+} DetectionEventType;
+
+// Point en pixels de la frame pleine résolution
+typedef struct {
+    int16_t x, y;
+} DetectionPoint;
+
+// Un code vu dans une frame
+typedef struct {
+    const char* symbol;
+    EntityType type;
+    uint32_t frame_id;
+    int n_corners;
+    DetectionPoint corners[DETECTION_MAX_CORNERS];
+    uint64_t time_ms;  // Horloge monotone
+} DetectionSighting;
+
+typedef struct {
+    DetectionEventType type;
+    int stream;
+    EntityType entity;    // Entité détectée (dernière entité suivie pour LOST)
+    EntityType previous;  // Entité précédente pour ALLY_TARGET, NONE sinon
+    uint64_t time_ms;     // Horloge monotone
+    uint64_t wall_us;     // Date de l'événement (µs depuis l'epoch Unix), pour les autres machines
+    uint32_t frame_id;    // Frame de la détection (dernière frame de l'entité pour LOST)
+    int n_corners;        // 0 pour LOST
+    DetectionPoint corners[DETECTION_MAX_CORNERS];
+    char symbol[DETECTION_MAX_SYMBOL_LEN];  // Vide pour LOST
+} DetectionEvent;
+
+// File bornée d'événements, partagée entre les flux et les consommateurs.
+// Pleine : l'événement le plus ancien est perdu, un producteur ne bloque jamais.
+typedef struct {
+    DetectionEvent events[DETECTION_QUEUE_SIZE];
+    int head;
+    int count;
+    int closed;
+    unsigned long pushed;
+    unsigned long dropped;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+} DetectionQueue;
+
+// Dernière apparition d'un code
+typedef struct {
+    char symbol[DETECTION_MAX_SYMBOL_LEN];
+    uint64_t last_ms;
+} DetectionSeen;
+
+typedef struct {
+    int stream;
+    DetectionQueue* queue;
+    EntityType last_type;  // NONE : aucune entité suivie
+    uint64_t last_ms;      // Dernière détection d'une entité valide
+    uint32_t last_frame;   // Frame de cette détection
+    DetectionSeen seen[DETECTION_SYMBOLS];
+    unsigned long observed;   // Codes reçus
+    unsigned long debounced;  // Codes ignorés par l'anti-rebond
+    unsigned long events;     // Événements publiés
+    pthread_mutex_t lock;
+} DetectionTracker;
+
+// Horloge monotone en millisecondes
+uint64_t detection_now_ms(void);
+
+void detection_queue_init(DetectionQueue* q);
+
+// Ajoute un événement sans bloquer
+void detection_queue_push(DetectionQueue* q, const DetectionEvent* ev);
+
+// Retire le plus ancien événement, en attendant au plus timeout_ms (-1 : sans limite).
+// Retourne 1 si ev est rempli, 0 à l'expiration, -1 si la file est fermée et vide.
+int detection_queue_pop(DetectionQueue* q, DetectionEvent* ev, int timeout_ms);
+
+// Réveille les consommateurs : les événements restants sont encore lisibles
+void detection_queue_close(DetectionQueue* q);
+
+void detection_queue_destroy(DetectionQueue* q);
+
+void detection_tracker_init(DetectionTracker* t, int stream, DetectionQueue* queue);
+
+// Signale un code détecté, avec le type de l'entité qu'il représente
+void detection_tracker_observe(DetectionTracker* t, const DetectionSighting* sighting);
+
+// Fait vieillir l'état sans nouvelle détection (à appeler à chaque frame)
+void detection_tracker_tick(DetectionTracker* t, uint64_t now_ms);
+
+void detection_tracker_print_stats(DetectionTracker* t);
+
+void detection_tracker_destroy(DetectionTracker* t);
+
+const char* detection_event_name(DetectionEventType type);
+
+#endif // DETECTION_H
@@ -0,0 +1,377 @@
+#include "entity_db.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// FNV-1a 64 bits ; 0 est réservé aux slots vides
+static uint64_t hash_id(const char* id, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)id[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h ? h : 1;
+}
+
+// Taille du bloc header + slots + identifiants
+static size_t image_size(uint32_t capacity, uint64_t pool_size) {
+    return sizeof(EntityDbHeader) + (size_t)capacity * sizeof(EntitySlot) + pool_size;
+}
+
+// Renseigne les pointeurs de la base à partir d'une image (mémoire ou fichier mappé)
+static void attach_image(EntityDb* db, const void* image) {
+    const EntityDbHeader* header = (const EntityDbHeader*)image;
+    db->capacity = header->capacity;
+    db->count = header->count;
+    db->slots = (const EntitySlot*)(header + 1);
+    db->pool = (const char*)(db->slots + header->capacity);
+}
+
+EntityDb* entity_db_build(const char* const* ids, const EntityType* types, size_t n) {
+    // Taux de remplissage <= 50 % : sondages courts même pour les identifiants absents
+    uint32_t capacity = 16;
+    while (capacity < 2 * n) {
+        if (capacity >= (1U << 31)) return NULL;
+        capacity <<= 1;
+    }
+    uint64_t pool_size = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t len = strlen(ids[i]);
+        if (len == 0 || len > ENTITY_DB_MAX_ID_LEN) {
+            fprintf(stderr, "Identifiant d'entité invalide (%zu octets)\n", len);
+            return NULL;
+        }
+        pool_size += len;
+    }
+    if (pool_size > UINT32_MAX) return NULL;
+
+    EntityDb* db = calloc(1, sizeof(EntityDb));
+    void* image = calloc(1, image_size(capacity, pool_size));
+    if (!db || !image) {
+        perror("Erreur d'allocation mémoire");
+        free(db);
+        free(image);
+        return NULL;
+    }
+    EntityDbHeader* header = (EntityDbHeader*)image;
+    header->magic = ENTITY_DB_MAGIC;
+    header->version = ENTITY_DB_VERSION;
+    header->capacity = capacity;
+    header->pool_size = pool_size;
+    EntitySlot* slots = (EntitySlot*)(header + 1);
+    char* pool = (char*)(slots + capacity);
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t len = strlen(ids[i]);
+        uint64_t h = hash_id(ids[i], len);
+        uint32_t pos = (uint32_t)h & (capacity - 1);
+        while (slots[pos].hash != 0) {
+            // Doublon : la dernière occurrence l'emporte
+            if (slots[pos].hash == h && slots[pos].len == len &&
+                memcmp(pool + slots[pos].offset, ids[i], len) == 0) {
+                break;
+            }
+            pos = (pos + 1) & (capacity - 1);
+        }
+        if (slots[pos].hash == 0) {
+            memcpy(pool + offset, ids[i], len);
+            slots[pos].hash = h;
+            slots[pos].offset = offset;
+            slots[pos].len = (uint16_t)len;
+            offset += (uint32_t)len;
+            header->count++;
+        }
+        slots[pos].type = (uint8_t)types[i];
+    }
+    header->pool_size = offset;  // Sans les doublons
+
+    db->memory = image;
+    attach_image(db, image);
+    return db;
+}
+
+// Vérifie un fichier binaire mappé avant de s'en servir : un fichier tronqué ou
+// corrompu ne doit jamais faire lire hors du mapping
+static int check_image(const void* image, size_t size) {
+    const EntityDbHeader* header = (const EntityDbHeader*)image;
+    if (size < sizeof(EntityDbHeader) || header->magic != ENTITY_DB_MAGIC ||
+        header->version != ENTITY_DB_VERSION) {
+        return -1;
+    }
+    uint32_t capacity = header->capacity;
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || header->count >= capacity ||
+        header->pool_size > UINT32_MAX || image_size(capacity, header->pool_size) != size) {
+        return -1;
+    }
+    const EntitySlot* slots = (const EntitySlot*)(header + 1);
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < capacity; i++) {
+        if (slots[i].hash == 0) continue;
+        if ((uint64_t)slots[i].offset + slots[i].len > header->pool_size) return -1;
+        used++;
+    }
+    // count < capacity : il reste un slot vide, qui arrête le sondage de entity_db_lookup()
+    return used == header->count ? 0 : -1;
+}
+
+static EntityDb* load_binary(int fd, size_t size, const char* path) {
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("Erreur mmap de la base d'entités");
+        return NULL;
+    }
+    if (check_image(map, size) < 0) {
+        fprintf(stderr, "Base d'entités binaire invalide : %s\n", path);
+        munmap(map, size);
+        return NULL;
+    }
+    EntityDb* db = calloc(1, sizeof(EntityDb));
+    if (!db) {
+        munmap(map, size);
+        return NULL;
+    }
+    db->map = map;
+    db->map_size = size;
+    attach_image(db, map);
+    return db;
+}
+
+static EntityDb* load_text(FILE* file, const char* path) {
+    char** ids = NULL;
+    EntityType* types = NULL;
+    size_t n = 0, allocated = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    int line_num = 0, error = 0;
+
+    while (!error && (len = getline(&line, &line_size, file)) >= 0) {
+        line_num++;
+        while (len > 0 && isspace((unsigned char)line[len - 1])) line[--len] = '\0';
+        char* p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        EntityType type;
+        if (strncmp(p, "ALLY", 4) == 0 && isspace((unsigned char)p[4])) {
+            type = ALLY;
+            p += 4;
+        } else if (strncmp(p, "TARGET", 6) == 0 && isspace((unsigned char)p[6])) {
+            type = TARGET;
+            p += 6;
+        } else {
+            fprintf(stderr, "%s:%d : type d'entité attendu (ALLY ou TARGET)\n", path, line_num);
+            error = 1;
+            break;
+        }
+        while (isspace((unsigned char)*p)) p++;
+
+        if (n == allocated) {
+            allocated = allocated ? 2 * allocated : 1024;
+            char** new_ids = realloc(ids, allocated * sizeof(char*));
+            EntityType* new_types = new_ids ? realloc(types, allocated * sizeof(EntityType)) : NULL;
+            if (new_ids) ids = new_ids;
+            if (!new_ids || !new_types) {
+                error = 1;
+                break;
+            }
+            types = new_types;
+        }
+        ids[n] = strdup(p);
+        if (!ids[n]) {
+            error = 1;
+            break;
+        }
+        types[n++] = type;
+    }
+    free(line);
+
+    EntityDb* db = error ? NULL : entity_db_build((const char* const*)ids, types, n);
+    for (size_t i = 0; i < n; i++) free(ids[i]);
+    free(ids);
+    free(types);
+    return db;
+}
+
+EntityDb* entity_db_load(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Erreur ouverture de la base d'entités");
+        return NULL;
+    }
+    struct stat st;
+    uint32_t magic = 0;
+    if (fstat(fd, &st) < 0 || pread(fd, &magic, sizeof(magic), 0) < 0) {
+        perror("Erreur lecture de la base d'entités");
+        close(fd);
+        return NULL;
+    }
+
+    EntityDb* db;
+    if (magic == ENTITY_DB_MAGIC) {
+        db = load_binary(fd, (size_t)st.st_size, path);
+        close(fd);  // Le mapping reste valide après la fermeture
+    } else {
+        FILE* file = fdopen(fd, "r");
+        if (!file) {
+            close(fd);
+            return NULL;
+        }
+        db = load_text(file, path);
+        fclose(file);
+    }
+    return db;
+}
+
+int entity_db_save(const EntityDb* db, const char* path) {
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* file = fopen(tmp_path, "wb");
+    if (!file) {
+        perror("Erreur ouverture du fichier de base");
+        return -1;
+    }
+
+    // L'image (header + slots + identifiants) est écrite telle quelle
+    const EntityDbHeader* header = (const EntityDbHeader*)(db->memory ? db->memory : db->map);
+    size_t size = image_size(header->capacity, header->pool_size);
+    int ok = fwrite(header, 1, size, file) == size;
+    if (fclose(file) != 0 || !ok || rename(tmp_path, path) != 0) {
+        perror("Erreur écriture du fichier de base");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+EntityType entity_db_lookup(const EntityDb* db, const char* id, size_t len) {
+    uint64_t h = hash_id(id, len);
+    uint32_t mask = db->capacity - 1;
+    for (uint32_t pos = (uint32_t)h & mask; db->slots[pos].hash != 0; pos = (pos + 1) & mask) {
+        const EntitySlot* slot = &db->slots[pos];
+        if (slot->hash == h && slot->len == len && memcmp(db->pool + slot->offset, id, len) == 0) {
+            return (EntityType)slot->type;
+        }
+    }
+    return UNKNOWN;
+}
+
+void entity_db_free(EntityDb* db) {
+    if (!db) return;
+    free(db->memory);
+    if (db->map) munmap(db->map, db->map_size);
+    free(db);
+}
+
+const char* entity_type_name(EntityType type) {
+    switch (type) {
+        case ALLY: return "ALLY";
+        case TARGET: return "TARGET";
+        case UNKNOWN: return "UNKNOWN";
+        default: return "NONE";
+    }
+}
+
+/*------------------------------------------------------------------------------------------*/
+
+static EntityDbRef* ref_create(EntityDb* db) {
+    EntityDbRef* ref = calloc(1, sizeof(EntityDbRef));
+    if (ref) ref->db = db;
+    return ref;
+}
+
+static void ref_free(EntityDbRef* ref) {
+    entity_db_free(ref->db);
+    free(ref);
+}
+
+int entity_registry_init(EntityRegistry* reg, const char* path, EntityDb* fallback) {
+    memset(reg, 0, sizeof(*reg));
+    pthread_mutex_init(&reg->lock, NULL);
+    reg->path = path;
+
+    EntityDb* db = NULL;
+    struct stat st;
+    if (path && stat(path, &st) == 0) {
+        // Même invalide, cette version du fichier n'est retentée qu'une fois modifiée
+        reg->mtime = st.st_mtim;
+        reg->size = st.st_size;
+        db = entity_db_load(path);
+    }
+    if (db) {
+        entity_db_free(fallback);
+        printf("Base d'entités : %u entités (%s)\n", db->count, path);
+    } else {
+        db = fallback;
+        if (!db) return -1;
+        printf("Base d'entités : %u entités (base de repli)\n", db->count);
+    }
+    reg->current = ref_create(db);
+    if (!reg->current) {
+        entity_db_free(db);
+        return -1;
+    }
+    return 0;
+}
+
+int entity_registry_check(EntityRegistry* reg) {
+    struct stat st;
+    if (!reg->path || stat(reg->path, &st) < 0) return 0;
+    if (st.st_mtim.tv_sec == reg->mtime.tv_sec && st.st_mtim.tv_nsec == reg->mtime.tv_nsec &&
+        st.st_size == reg->size) {
+        return 0;
+    }
+    reg->mtime = st.st_mtim;
+    reg->size = st.st_size;
+
+    // Chargement hors verrou : les recherches continuent sur l'ancienne base
+    EntityDb* db = entity_db_load(reg->path);
+    if (!db) {
+        fprintf(stderr, "Rechargement de %s impossible, ancienne base conservée\n", reg->path);
+        return -1;
+    }
+    EntityDbRef* ref = ref_create(db);
+    if (!ref) {
+        entity_db_free(db);
+        return -1;
+    }
+
+    pthread_mutex_lock(&reg->lock);
+    EntityDbRef* old = reg->current;
+    reg->current = ref;
+    reg->reloads++;
+    int free_old = old->refs == 0;  // Sinon, libérée par son dernier lecteur
+    pthread_mutex_unlock(&reg->lock);
+
+    if (free_old) ref_free(old);
+    printf("Base d'entités rechargée : %u entités (%s)\n", db->count, reg->path);
+    return 1;
+}
+
+EntityType entity_registry_lookup(EntityRegistry* reg, const char* id) {
+    // Le verrou ne couvre que la prise de référence, pas la recherche
+    pthread_mutex_lock(&reg->lock);
+    EntityDbRef* ref = reg->current;
+    ref->refs++;
+    pthread_mutex_unlock(&reg->lock);
+
+    EntityType type = entity_db_lookup(ref->db, id, strlen(id));
+
+    pthread_mutex_lock(&reg->lock);
+    int free_ref = --ref->refs == 0 && ref != reg->current;
+    pthread_mutex_unlock(&reg->lock);
+    if (free_ref) ref_free(ref);
+    return type;
+}
+
+void entity_registry_close(EntityRegistry* reg) {
+    if (reg->current) ref_free(reg->current);
+    reg->current = NULL;
+}
@@ -0,0 +1,108 @@
+#ifndef ENTITY_DB_H
+#define ENTITY_DB_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+// Base des entités identifiées par les QR codes (alliés, cibles).
+// Table de hachage à adressage ouvert (sondage linéaire, FNV-1a 64 bits) dont
+// l'image mémoire est aussi le format binaire sur disque : un fichier compilé est
+// chargé par mmap, sans analyse du texte ni copie, quelle que soit sa taille.
+//
+// Un fichier binaire doit être remplacé par renommage (comme entity_db_save), jamais
+// réécrit en place : il peut être mappé par une base encore en service.
+//
+// Format texte : une entité par ligne, "ALLY <id>" ou "TARGET <id>", lignes vides
+// et commentaires '#' ignorés. L'identifiant s'étend jusqu'à la fin de la ligne.
+
+typedef enum {
+    NONE,
+    ALLY,
+    TARGET,
+    UNKNOWN,
+} EntityType;
+
+#define ENTITY_DB_MAGIC 0x31424445  // "EDB1" en little-endian : refuse un fichier d'une autre architecture
+#define ENTITY_DB_VERSION 1
+#define ENTITY_DB_MAX_ID_LEN 1024
+
+// En-tête du format binaire, suivi de capacity slots puis des identifiants
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;   // Puissance de 2, au moins le double du nombre d'entités
+    uint32_t count;
+    uint64_t pool_size;  // Taille du bloc d'identifiants
+    uint64_t reserved;
+} EntityDbHeader;
+
+typedef struct {
+    uint64_t hash;    // 0 pour un slot vide
+    uint32_t offset;  // Position de l'identifiant dans le bloc
+    uint16_t len;
+    uint8_t type;     // EntityType
+    uint8_t reserved;
+} EntitySlot;
+
+typedef struct {
+    const EntitySlot* slots;
+    const char* pool;
+    uint32_t capacity;
+    uint32_t count;
+    void* memory;        // Table construite en mémoire (malloc), ou NULL
+    void* map;           // Fichier binaire mappé, ou NULL
+    size_t map_size;
+} EntityDb;
+
+// Construit une base à partir de n identifiants et de leurs types, retourne NULL en cas d'erreur
+EntityDb* entity_db_build(const char* const* ids, const EntityType* types, size_t n);
+
+// Charge un fichier texte ou binaire (détecté par son en-tête), retourne NULL en cas d'erreur
+EntityDb* entity_db_load(const char* path);
+
+// Écrit la base au format binaire (fichier temporaire puis renommage)
+int entity_db_save(const EntityDb* db, const char* path);
+
+// Type d'une entité, UNKNOWN si elle est absente
+EntityType entity_db_lookup(const EntityDb* db, const char* id, size_t len);
+
+void entity_db_free(EntityDb* db);
+
+// Nom d'un type d'entité ("ALLY", "TARGET"...)
+const char* entity_type_name(EntityType type);
+
+// Base courante partagée entre les threads d'analyse, remplaçable à chaud :
+// la nouvelle base est chargée à côté puis échangée, les lecteurs en cours
+// terminent sur l'ancienne, libérée par le dernier d'entre eux.
+typedef struct {
+    EntityDb* db;
+    unsigned int refs;
+} EntityDbRef;
+
+typedef struct {
+    const char* path;   // Fichier surveillé, NULL pour une base fixe
+    EntityDbRef* current;
+    struct timespec mtime;  // Date et taille du fichier au dernier chargement
+    off_t size;
+    unsigned long reloads;
+    pthread_mutex_t lock;
+} EntityRegistry;
+
+// Charge path dans le registre, ou la base de repli fallback si path est NULL ou illisible
+// (le registre prend possession de fallback). Retourne -1 si aucune base n'est disponible.
+int entity_registry_init(EntityRegistry* reg, const char* path, EntityDb* fallback);
+
+// Recharge le fichier s'il a changé depuis le dernier chargement.
+// Retourne 1 si la base a été remplacée, 0 sinon, -1 si le nouveau fichier est invalide
+// (l'ancienne base reste en service).
+int entity_registry_check(EntityRegistry* reg);
+
+// Type d'une entité dans la base courante (sûr depuis n'importe quel thread)
+EntityType entity_registry_lookup(EntityRegistry* reg, const char* id);
+
+void entity_registry_close(EntityRegistry* reg);
+
+#endif // ENTITY_DB_H
@@ -0,0 +1,190 @@
+#include "event_sender.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void put_be16(uint8_t* buf, uint16_t value) {
+    buf[0] = value >> 8;
+    buf[1] = value;
+}
+
+static uint16_t get_be16(const uint8_t* buf) {
+    return (uint16_t)((buf[0] << 8) | buf[1]);
+}
+
+static void put_be32(uint8_t* buf, uint32_t value) {
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+static uint32_t get_be32(const uint8_t* buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+static void put_be64(uint8_t* buf, uint64_t value) {
+    put_be32(buf, value >> 32);
+    put_be32(buf + 4, (uint32_t)value);
+}
+
+static uint64_t get_be64(const uint8_t* buf) {
+    return ((uint64_t)get_be32(buf) << 32) | get_be32(buf + 4);
+}
+
+int encode_detection_event(const DetectionEvent* ev, uint8_t* buf, size_t buf_size) {
+    size_t symbol_len = strnlen(ev->symbol, sizeof(ev->symbol) - 1);
+    int n_corners = ev->n_corners < 0 ? 0 : (ev->n_corners > DETECTION_MAX_CORNERS ? DETECTION_MAX_CORNERS : ev->n_corners);
+    size_t size = EVENT_FIXED_SIZE + (size_t)n_corners * 4 + symbol_len;
+    if (size > buf_size) return -1;
+
+    buf[0] = (uint8_t)ev->type;
+    buf[1] = (uint8_t)ev->entity;
+    buf[2] = (uint8_t)ev->previous;
+    buf[3] = (uint8_t)ev->stream;
+    put_be64(buf + 4, ev->wall_us);
+    put_be32(buf + 12, ev->frame_id);
+    buf[16] = (uint8_t)n_corners;
+    buf[17] = (uint8_t)symbol_len;
+    uint8_t* p = buf + EVENT_FIXED_SIZE;
+    for (int i = 0; i < n_corners; i++) {
+        put_be16(p, (uint16_t)ev->corners[i].x);
+        put_be16(p + 2, (uint16_t)ev->corners[i].y);
+        p += 4;
+    }
+    memcpy(p, ev->symbol, symbol_len);
+    return (int)size;
+}
+
+int decode_detection_event(DetectionEvent* ev, const uint8_t* buf, size_t len) {
+    if (len < EVENT_FIXED_SIZE) return -1;
+    int n_corners = buf[16];
+    size_t symbol_len = buf[17];
+    size_t size = EVENT_FIXED_SIZE + (size_t)n_corners * 4 + symbol_len;
+    if (n_corners > DETECTION_MAX_CORNERS || symbol_len >= DETECTION_MAX_SYMBOL_LEN || size > len) {
+        return -1;
+    }
+
+    memset(ev, 0, sizeof(*ev));
+    ev->type = (DetectionEventType)buf[0];
+    ev->entity = (EntityType)buf[1];
+    ev->previous = (EntityType)buf[2];
+    ev->stream = buf[3];
+    ev->wall_us = get_be64(buf + 4);
+    ev->frame_id = get_be32(buf + 12);
+    ev->n_corners = n_corners;
+    const uint8_t* p = buf + EVENT_FIXED_SIZE;
+    for (int i = 0; i < n_corners; i++) {
+        ev->corners[i].x = (int16_t)get_be16(p);
+        ev->corners[i].y = (int16_t)get_be16(p + 2);
+        p += 4;
+    }
+    memcpy(ev->symbol, p, symbol_len);
+    return (int)size;
+}
+
+int decode_event_header(const uint8_t* buf, size_t len, uint32_t* seq) {
+    if (len < EVENT_HEADER_SIZE || buf[0] != EVENT_MAGIC_0 || buf[1] != EVENT_MAGIC_1 ||
+        buf[2] != EVENT_VERSION) {
+        return -1;
+    }
+    if (seq) *seq = get_be32(buf + 4);
+    return buf[3];
+}
+
+/*------------------------------------------------------------------------------------------*/
+
+int event_sender_open(EventSender* s, const char* ip, int port) {
+    memset(s, 0, sizeof(*s));
+    s->sock = -1;
+    s->dest.sin_family = AF_INET;
+    s->dest.sin_port = htons(port);
+    if (inet_pton(AF_INET, ip, &s->dest.sin_addr) != 1) {
+        fprintf(stderr, "Adresse de la station invalide : %s\n", ip);
+        return -1;
+    }
+
+    s->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s->sock < 0) {
+        perror("Erreur lors de la création du socket d'événements");
+        return -1;
+    }
+
+    // Non bloquant : le thread d'événements ne doit jamais attendre le réseau
+    int flags = fcntl(s->sock, F_GETFL, 0);
+    if (flags < 0 || fcntl(s->sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+        perror("Erreur lors du passage du socket en non bloquant");
+        close(s->sock);
+        s->sock = -1;
+        return -1;
+    }
+
+    if (IN_MULTICAST(ntohl(s->dest.sin_addr.s_addr))) {
+        unsigned char ttl = EVENT_MULTICAST_TTL;
+        if (setsockopt(s->sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) {
+            perror("Erreur lors de la configuration du multicast");
+            close(s->sock);
+            s->sock = -1;
+            return -1;
+        }
+    }
+    printf("Événements envoyés à %s:%d (%s)\n", ip, port,
+           IN_MULTICAST(ntohl(s->dest.sin_addr.s_addr)) ? "multicast" : "unicast");
+    return 0;
+}
+
+int event_sender_flush(EventSender* s) {
+    if (s->batch_count == 0) return 0;
+
+    s->batch[3] = (uint8_t)s->batch_count;
+    int count = (int)s->batch_count;
+    ssize_t sent = sendto(s->sock, s->batch, s->batch_len, 0, (struct sockaddr*)&s->dest, sizeof(s->dest));
+    s->batch_len = 0;
+    s->batch_count = 0;
+
+    if (sent < 0) {
+        // EAGAIN : socket plein, on ne retente pas (les événements suivants sont plus récents)
+        if (errno != EAGAIN && errno != EWOULDBLOCK) perror("Erreur lors de l'envoi des événements");
+        s->stats.dropped += count;
+        return -1;
+    }
+    s->stats.datagrams++;
+    s->stats.events += count;
+    if ((unsigned int)count > s->stats.max_batch) s->stats.max_batch = count;
+    return count;
+}
+
+void event_sender_add(EventSender* s, const DetectionEvent* ev) {
+    uint8_t encoded[EVENT_MAX_SIZE];
+    int size = encode_detection_event(ev, encoded, sizeof(encoded));
+    if (size < 0) return;
+
+    if (s->batch_count == 255 || s->batch_len + size > sizeof(s->batch)) event_sender_flush(s);
+    if (s->batch_count == 0) {
+        s->batch[0] = EVENT_MAGIC_0;
+        s->batch[1] = EVENT_MAGIC_1;
+        s->batch[2] = EVENT_VERSION;
+        put_be32(s->batch + 4, s->seq++);
+        s->batch_len = EVENT_HEADER_SIZE;
+    }
+    memcpy(s->batch + s->batch_len, encoded, size);
+    s->batch_len += size;
+    s->batch_count++;
+}
+
+void event_sender_print_stats(const EventSender* s) {
+    const EventSenderStats* st = &s->stats;
+    printf("Événements UDP : %lu envoyés en %lu datagrammes (max %u par datagramme), %lu perdus\n",
+           st->events, st->datagrams, st->max_batch, st->dropped);
+}
+
+void event_sender_close(EventSender* s) {
+    event_sender_flush(s);
+    if (s->sock >= 0) close(s->sock);
+    s->sock = -1;
+}
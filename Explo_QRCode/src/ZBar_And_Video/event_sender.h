@@ -0,0 +1,86 @@
+#ifndef EVENT_SENDER_H
+#define EVENT_SENDER_H
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "detection.h"
+
+// Publication des événements de détection en UDP (unicast ou multicast) vers la
+// station de contrôle. Les événements sont regroupés dans un datagramme tant que
+// d'autres sont déjà en attente : un événement isolé part seul, immédiatement,
+// une rafale part en quelques datagrammes. L'envoi ne bloque jamais : si le
+// socket est plein, le datagramme est compté comme perdu.
+//
+// Format v1, champs fixes en ordre réseau :
+//
+//   Datagramme
+//     octet 0-1 : magic 'Q' 'E'
+//     octet 2   : version du format
+//     octet 3   : nombre d'événements
+//     octet 4-7 : numéro du datagramme (les trous signalent des pertes)
+//     puis les événements, à la suite
+//
+//   Événement
+//     octet 0     : type (DetectionEventType)
+//     octet 1     : entité (EntityType)
+//     octet 2     : entité précédente (EntityType, cas ALLY_TARGET)
+//     octet 3     : flux
+//     octet 4-11  : date (µs depuis l'epoch Unix, CLOCK_REALTIME)
+//     octet 12-15 : numéro de frame
+//     octet 16    : nombre de coins n (0 à DETECTION_MAX_CORNERS)
+//     octet 17    : longueur du contenu l
+//     n x (x, y)  : coins en pixels, entiers signés 16 bits
+//     l octets    : contenu du QR code, sans '\0'
+
+#define EVENT_MAGIC_0 'Q'
+#define EVENT_MAGIC_1 'E'
+#define EVENT_VERSION 1
+
+#define EVENT_HEADER_SIZE 8
+#define EVENT_FIXED_SIZE 18
+#define EVENT_MAX_SIZE (EVENT_FIXED_SIZE + DETECTION_MAX_CORNERS * 4 + DETECTION_MAX_SYMBOL_LEN - 1)
+#define EVENT_DATAGRAM_MAX_SIZE 1400  // Sous la MTU Ethernet : pas de fragmentation IP
+#define EVENT_MULTICAST_TTL 1         // Multicast limité au réseau local
+
+typedef struct {
+    unsigned long events;     // Événements envoyés
+    unsigned long datagrams;  // Datagrammes envoyés
+    unsigned long dropped;    // Événements perdus (socket plein ou erreur d'envoi)
+    unsigned int max_batch;   // Plus grand nombre d'événements dans un datagramme
+} EventSenderStats;
+
+typedef struct {
+    int sock;
+    struct sockaddr_in dest;
+    uint32_t seq;
+    uint8_t batch[EVENT_DATAGRAM_MAX_SIZE];
+    size_t batch_len;  // 0 : aucun événement en attente
+    unsigned int batch_count;
+    EventSenderStats stats;
+} EventSender;
+
+// Ouvre un socket non bloquant vers ip:port (adresse multicast 224.0.0.0/4 acceptée).
+// Retourne -1 en cas d'erreur.
+int event_sender_open(EventSender* s, const char* ip, int port);
+
+// Ajoute un événement au datagramme en cours, envoyé d'abord s'il est plein
+void event_sender_add(EventSender* s, const DetectionEvent* ev);
+
+// Envoie le datagramme en cours. Retourne le nombre d'événements envoyés, -1 s'ils sont perdus.
+int event_sender_flush(EventSender* s);
+
+void event_sender_print_stats(const EventSender* s);
+void event_sender_close(EventSender* s);
+
+// Encode un événement, retourne le nombre d'octets écrits ou -1 si buf est trop petit
+int encode_detection_event(const DetectionEvent* ev, uint8_t* buf, size_t buf_size);
+
+// Décode un événement, retourne le nombre d'octets lus ou -1 s'il est invalide.
+// time_ms n'est pas transmis (horloge propre à l'émetteur) et vaut 0.
+int decode_detection_event(DetectionEvent* ev, const uint8_t* buf, size_t len);
+
+// Vérifie l'en-tête d'un datagramme, retourne le nombre d'événements ou -1 s'il est invalide
+int decode_event_header(const uint8_t* buf, size_t len, uint32_t* seq);
+
+#endif // EVENT_SENDER_H
@@ -0,0 +1,40 @@
+#ifndef JPEG_DECODE_H
+#define JPEG_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Décodage d'images pour l'affichage et l'analyse QR. Les JPEG passent par
+// libjpeg-turbo quand le programme est compilé avec HAVE_LIBJPEG (IDCT SIMD,
+// réduction 1/2, 1/4 ou 1/8 pendant la décompression, sortie en niveaux de gris
+// sans traiter la chrominance). Les autres formats, et les JPEG sans
+// libjpeg-turbo, passent par stb_image (pleine résolution uniquement).
+
+typedef struct {
+    uint8_t *pixels;  // Lignes contiguës de width * channels octets
+    int width;
+    int height;
+    int channels;     // 1 (GRAY8) ou 3 (RGB)
+    int scale;        // Réduction réellement appliquée : 1, 2, 4 ou 8
+    size_t capacity;  // Taille allouée, le buffer est réutilisé d'une image à l'autre
+    int from_stb;     // pixels alloué par stb_image
+} DecodedImage;
+
+// Décode une image en mémoire en channels canaux (1 ou 3), réduite de scale (1, 2, 4 ou 8)
+// si le décodeur le permet. img doit être initialisée à zéro avant le premier appel.
+// Retourne -1 si l'image est invalide.
+int image_decode(DecodedImage *img, const uint8_t *data, size_t size, int channels, int scale);
+
+// Même chose pour un fichier
+int image_decode_file(DecodedImage *img, const char *path, int channels, int scale);
+
+void image_free(DecodedImage *img);
+
+// Décodeur utilisé pour les JPEG ("libjpeg-turbo" ou "stb_image")
+const char *jpeg_decoder_name(void);
+
+// Force un décodeur (comparaison des performances). Retourne -1 s'il n'est pas disponible.
+// À appeler avant de lancer les threads qui décodent.
+int jpeg_decoder_select(const char *name);
+
+#endif // JPEG_DECODE_H
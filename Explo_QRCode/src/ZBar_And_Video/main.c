@@ -1,8 +1,13 @@
 #include "Decode_QR.h"
+#include "detection.h"
+#include "event_sender.h"
+#include "scan_pool.h"
 
 #include <gst/gst.h>
 #include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
 #include <zbar.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -14,6 +19,20 @@
 // Puis nous avons pu construire notre propre pipeline avec deux flux vidéos différents
 
 
+// Image enregistrée lors d'une détection
+#define SNAPSHOT_PATH "/tmp/capture.jpg"
+
+// Base des entités (texte ou binaire compilé) et période de vérification de ses modifications
+#define ENTITY_DB_PATH "entities.txt"
+#define ENTITY_RELOAD_PERIOD_S 2
+
+// Base de repli si le fichier est absent ou invalide
+static const char* fallback_ids[] = {
+    "http://192.168.8.205", "192.168.8.222", "192.168.8.333",  // Alliés
+    "http://192.168.8.1", "192.168.8.2", "192.168.8.3",        // Ennemis
+};
+static const EntityType fallback_types[] = {ALLY, ALLY, ALLY, TARGET, TARGET, TARGET};
+
 // Variable globale pour le main loop
 GMainLoop* loop = NULL;
 
@@ -58,61 +77,60 @@ static void on_eos_message(GstBus *bus, GstMessage *message, gpointer user_data)
     if (loop) g_main_loop_quit(loop);
 }
 
-// Callback qui reçoit les frames du pipeline GStreamer
+// Callback qui reçoit les frames du pipeline GStreamer : la frame est confiée au pool
+// d'analyse sans copie, le thread de streaming n'attend jamais la fin d'un scan
 static GstFlowReturn on_new_sample(GstAppSink* appsink, gpointer user_data) {
-    g_print("New sample callback triggered!\n");
+    ScanPool* pool = (ScanPool*)user_data;
     GstSample* sample = gst_app_sink_pull_sample(appsink);
     if (!sample) {
         g_print("Failed to pull sample\n");
         return GST_FLOW_ERROR;
     }
+    scan_pool_push(pool, sample);
+    return GST_FLOW_OK;
+}
 
-    GstBuffer* buffer = gst_sample_get_buffer(sample);
-    GstCaps* caps = gst_sample_get_caps(sample);
-    GstStructure* s = gst_caps_get_structure(caps, 0);
-
-    int width, height;
-    gst_structure_get_int(s, "width", &width);
-    gst_structure_get_int(s, "height", &height);
-    g_print("Frame received: %dx%d\n", width, height);
-
-    // Récupérer le format exact
-    const gchar* format_str = gst_structure_get_string(s, "format");
-    g_print("Format: %s\n", format_str ? format_str : "unknown");
-
-    GstMapInfo map;
-    if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-        g_print("Failed to map buffer\n");
-        gst_sample_unref(sample);
-        return GST_FLOW_ERROR;
-    }
-
-    // Le format doit être GRAY8 pour ZBar : Y800
-    uint8_t* gray_data = (uint8_t*)malloc(width * height);
-    if (!gray_data) {
-        g_print("Failed to allocate memory for frame\n");
-        gst_buffer_unmap(buffer, &map);
-        gst_sample_unref(sample);
-        return GST_FLOW_ERROR;
-    }
+// Recharge la base d'entités si son fichier a changé. Appelé par la boucle principale :
+// le chargement ne bloque jamais les threads d'analyse.
+static gboolean on_entity_timer(gpointer user_data) {
+    entity_registry_check((EntityRegistry*)user_data);
+    return TRUE;
+}
 
-    // Copie des données gris
-    memcpy(gray_data, map.data, width * height);
+typedef struct {
+    DetectionQueue* queue;
+    EventSender* sender;  // NULL : événements seulement affichés
+} EventConsumer;
 
-    // Analyse QR
-    g_print("Analyzing frame for QR codes...\n");
-    int qr_found = decode_qr_from_buffer(gray_data, width, height);
-    if (qr_found == 0) {
-        g_print("No QR code detected in this frame.\n");
+static void print_event(const DetectionEvent* ev) {
+    if (ev->type == DETECTION_ALLY_TARGET) {
+        // Cas particulier où deux entités différentes sont détectées en peu de temps
+        printf("Cas spécial : ALLY_TARGET détecté (%s puis %s : %s)\n",
+               entity_type_name(ev->previous), entity_type_name(ev->entity), ev->symbol);
     } else {
-        g_print("QR code found! Value: %d\n", qr_found);
+        printf("Événement flux %d frame %u à %llu ms : %s %s %s\n", ev->stream, ev->frame_id,
+               (unsigned long long)ev->time_ms, detection_event_name(ev->type),
+               entity_type_name(ev->entity), ev->symbol);
     }
+}
 
-    free(gray_data);
-    gst_buffer_unmap(buffer, &map);
-    gst_sample_unref(sample);
-
-    return GST_FLOW_OK;
+// Consommateur des événements de détection, hors des threads d'analyse.
+// Tout ce qui est déjà en file part dans le même datagramme, puis est affiché :
+// l'envoi réseau passe avant les logs.
+static void* event_thread(void* arg) {
+    EventConsumer* consumer = (EventConsumer*)arg;
+    DetectionEvent batch[DETECTION_QUEUE_SIZE];
+    while (detection_queue_pop(consumer->queue, &batch[0], -1) > 0) {
+        int n = 1;
+        while (n < DETECTION_QUEUE_SIZE && detection_queue_pop(consumer->queue, &batch[n], 0) > 0) n++;
+
+        if (consumer->sender) {
+            for (int i = 0; i < n; i++) event_sender_add(consumer->sender, &batch[i]);
+            event_sender_flush(consumer->sender);
+        }
+        for (int i = 0; i < n; i++) print_event(&batch[i]);
+    }
+    return NULL;
 }
 
 // Fonction pour tester si le périphérique vidéo existe
@@ -169,6 +187,99 @@ static void test_pipeline() {
 
 int main(int argc, char* argv[]) {
     gst_init(&argc, &argv);
+
+    // Mode de scan : "fast" (ROI puis image réduite, par défaut) ou "full",
+    // "cache" active le cache inter-frames de ZBar, "workers=N" fixe le nombre de
+    // threads d'analyse (un par cœur par défaut)
+    QrScanMode scan_mode = QR_SCAN_FAST;
+    int scan_cache = 0;
+    int n_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* entity_path = ENTITY_DB_PATH;
+    const char* compile_path = NULL;
+    char event_ip[64] = "";
+    int event_port = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "full") == 0) {
+            scan_mode = QR_SCAN_FULL;
+        } else if (strcmp(argv[i], "cache") == 0) {
+            scan_cache = 1;
+        } else if (strncmp(argv[i], "workers=", 8) == 0) {
+            n_workers = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "entities=", 9) == 0) {
+            entity_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "compile=", 8) == 0) {
+            compile_path = argv[i] + 8;
+        } else if (strncmp(argv[i], "events=", 7) == 0 &&
+                   sscanf(argv[i] + 7, "%63[^:]:%d", event_ip, &event_port) == 2) {
+            // Station de contrôle destinataire des événements, "events=IP:PORT" (unicast ou multicast)
+        } else if (strcmp(argv[i], "fast") != 0) {
+            g_print("Usage: %s [fast|full] [cache] [workers=N] [entities=fichier] [compile=fichier.edb] [events=IP:PORT]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    // Conversion de la base texte au format binaire, chargé par mmap au démarrage
+    if (compile_path) {
+        EntityDb* db = entity_db_load(entity_path);
+        int ret = db ? entity_db_save(db, compile_path) : -1;
+        if (ret == 0) g_print("Base compilée : %u entités -> %s\n", db->count, compile_path);
+        entity_db_free(db);
+        return ret;
+    }
+
+    EntityRegistry entities;
+    EntityDb* fallback = entity_db_build(fallback_ids, fallback_types,
+                                         sizeof(fallback_ids) / sizeof(fallback_ids[0]));
+    if (entity_registry_init(&entities, entity_path, fallback) < 0) {
+        return -1;
+    }
+
+    SnapshotWorker snapshots;
+    if (snapshot_start(&snapshots, SNAPSHOT_PATH) < 0) {
+        entity_registry_close(&entities);
+        return -1;
+    }
+
+    // Automate de détection du flux caméra, ses transitions sont traitées par un thread dédié
+    DetectionQueue events;
+    DetectionTracker tracker;
+    EventSender sender;
+    EventConsumer consumer = {&events, NULL};
+    pthread_t event_tid;
+    if (event_port > 0) {
+        if (event_sender_open(&sender, event_ip, event_port) < 0) {
+            snapshot_stop(&snapshots);
+            entity_registry_close(&entities);
+            return -1;
+        }
+        consumer.sender = &sender;
+    }
+    detection_queue_init(&events);
+    detection_tracker_init(&tracker, 0, &events);
+    if (pthread_create(&event_tid, NULL, event_thread, &consumer) != 0) {
+        perror("Erreur lors de la création du thread d'événements");
+        if (consumer.sender) event_sender_close(&sender);
+        snapshot_stop(&snapshots);
+        entity_registry_close(&entities);
+        return -1;
+    }
+
+    // Un scanner par worker ; la file garde une frame en attente par worker au plus :
+    // au-delà, les frames attendraient plus longtemps qu'un scan
+    ScanPool pool;
+    if (scan_pool_start(&pool, n_workers, n_workers, scan_mode, scan_cache, &snapshots, &entities,
+                        &tracker) < 0) {
+        detection_queue_close(&events);
+        pthread_join(event_tid, NULL);
+        if (consumer.sender) event_sender_close(&sender);
+        snapshot_stop(&snapshots);
+        entity_registry_close(&entities);
+        return -1;
+    }
+    g_print("QR analysis with %d worker(s)\n", pool.n_workers);
+    if (scan_cache && pool.n_workers > 1) {
+        g_print("Warning: ZBar cache is per worker, use workers=1 for full duplicate filtering\n");
+    }
     
     // Lister tous les périphériques vidéo disponibles
     // list_video_devices();
@@ -263,8 +374,10 @@ int main(int argc, char* argv[]) {
     // Configuration de l'appsink avec callbacks
     GstAppSinkCallbacks callbacks = {NULL};
     callbacks.new_sample = on_new_sample;
-    gst_app_sink_set_callbacks(GST_APP_SINK(appsink), &callbacks, NULL, NULL);
+    gst_app_sink_set_callbacks(GST_APP_SINK(appsink), &callbacks, &pool, NULL);
     gst_app_sink_set_emit_signals(GST_APP_SINK(appsink), TRUE);
+    // Le callback rend la main immédiatement : c'est la file du pool qui absorbe
+    // les variations du temps de scan et compte les frames abandonnées
     gst_app_sink_set_max_buffers(GST_APP_SINK(appsink), 1);
     gst_app_sink_set_drop(GST_APP_SINK(appsink), TRUE);
     gst_object_unref(appsink);
@@ -288,11 +401,26 @@ int main(int argc, char* argv[]) {
 
     g_print("Video capture started, QR code analysis in progress...\n");
     loop = g_main_loop_new(NULL, FALSE);
+    g_timeout_add_seconds(ENTITY_RELOAD_PERIOD_S, on_entity_timer, &entities);
     g_main_loop_run(loop);
 
-    // Nettoyage
+    // Nettoyage : plus aucune frame n'arrive une fois le pipeline arrêté
     gst_element_set_state(pipeline, GST_STATE_NULL);
     gst_object_unref(pipeline);
+    scan_pool_stop(&pool);
+    scan_pool_print_stats(&pool);
+    detection_queue_close(&events);
+    pthread_join(event_tid, NULL);
+    detection_tracker_print_stats(&tracker);
+    if (consumer.sender) {
+        event_sender_close(&sender);
+        event_sender_print_stats(&sender);
+    }
+    detection_tracker_destroy(&tracker);
+    detection_queue_destroy(&events);
+    snapshot_stop(&snapshots);
+    snapshot_print_stats(&snapshots);
+    entity_registry_close(&entities);
     // Ajouter un mutex
     if (loop) g_main_loop_unref(loop);
 
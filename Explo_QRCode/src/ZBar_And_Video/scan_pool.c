@@ -0,0 +1,193 @@
+#include "scan_pool.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <gst/video/video.h>
+
+// Scanne une frame, puis attend son tour pour traiter les symboles dans l'ordre des frames
+static void scan_job(ScanWorker* worker, ScanJob* job, unsigned long ticket) {
+    ScanPool* pool = worker->pool;
+    QrScanner* scanner = &worker->scanner;
+
+    // Frame mappée en place : la référence sur le sample garde le buffer valide
+    GstVideoInfo info;
+    GstVideoFrame frame;
+    int mapped = gst_video_info_from_caps(&info, gst_sample_get_caps(job->sample)) &&
+                 gst_video_frame_map(&frame, &info, gst_sample_get_buffer(job->sample), GST_MAP_READ);
+
+    // Part de la ROI publiée par la dernière frame traitée, quel que soit le worker qui l'a scannée
+    pthread_mutex_lock(&pool->lock);
+    scanner->roi = pool->roi;
+    pthread_mutex_unlock(&pool->lock);
+
+    const uint8_t* gray_data = NULL;
+    int width = 0, height = 0, stride = 0, n = 0;
+    if (mapped) {
+        gray_data = GST_VIDEO_FRAME_PLANE_DATA(&frame, 0);
+        stride = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0);
+        width = GST_VIDEO_FRAME_WIDTH(&frame);
+        height = GST_VIDEO_FRAME_HEIGHT(&frame);
+        n = qr_scanner_detect(scanner, gray_data, width, height, stride);
+    } else {
+        g_print("Failed to map buffer\n");
+    }
+
+    // Chaque numéro passe par ici, même en cas d'échec, pour ne pas bloquer les suivants
+    pthread_mutex_lock(&pool->lock);
+    while (pool->next_emit != ticket) {
+        pthread_cond_wait(&pool->turn, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // Section ordonnée : un seul worker à la fois, dans l'ordre des frames
+    if (n > 0) {
+        g_print("QR code found! Value: %d (frame %" G_GUINT64_FORMAT " ms)\n", n,
+                GST_CLOCK_TIME_IS_VALID(job->pts) ? job->pts / GST_MSECOND : 0);
+        scanner->frame_id = job->frame_id;
+        qr_scanner_handle_symbols(scanner, gray_data, width, height, stride);
+    }
+    if (scanner->tracker) detection_tracker_tick(scanner->tracker, detection_now_ms());
+    if (mapped) gst_video_frame_unmap(&frame);
+    gst_sample_unref(job->sample);
+
+    pthread_mutex_lock(&pool->lock);
+    if (mapped) {
+        pool->stats.scanned++;
+        if (n > 0) pool->stats.with_symbol++;
+        double scan_ms = scanner->stats.last_ms;
+        pool->stats.scan_total_ms += scan_ms;
+        if (scan_ms > pool->stats.scan_max_ms) pool->stats.scan_max_ms = scan_ms;
+    }
+    if (mapped) pool->roi = scanner->roi;  // Publiée dans l'ordre des frames
+    pool->last_pts = job->pts;
+    pool->next_emit++;
+    int print = pool->next_emit % SCAN_POOL_STATS_INTERVAL == 0;
+    pthread_cond_broadcast(&pool->turn);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (print) scan_pool_print_stats(pool);
+}
+
+static void* worker_thread(void* arg) {
+    ScanWorker* worker = (ScanWorker*)arg;
+    ScanPool* pool = worker->pool;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->running && pool->count == 0) {
+            pthread_cond_wait(&pool->not_empty, &pool->lock);
+        }
+        if (!pool->running) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+
+        // FIFO : les numéros suivent l'ordre d'arrivée des frames
+        ScanJob job = pool->jobs[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+        unsigned long ticket = pool->next_ticket++;
+        pthread_mutex_unlock(&pool->lock);
+
+        scan_job(worker, &job, ticket);
+    }
+    return NULL;
+}
+
+int scan_pool_start(ScanPool* pool, int n_workers, unsigned int depth, QrScanMode mode, int cache,
+                    SnapshotWorker* snapshots, EntityRegistry* entities, DetectionTracker* tracker) {
+    memset(pool, 0, sizeof(*pool));
+    pool->n_workers = n_workers < 1 ? 1 : (n_workers > SCAN_POOL_MAX_WORKERS ? SCAN_POOL_MAX_WORKERS : n_workers);
+    pool->capacity = depth < 1 ? 1 : (depth > SCAN_POOL_MAX_DEPTH ? SCAN_POOL_MAX_DEPTH : depth);
+    pool->last_pts = GST_CLOCK_TIME_NONE;
+    pool->running = 1;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->turn, NULL);
+
+    for (int i = 0; i < pool->n_workers; i++) {
+        ScanWorker* worker = &pool->workers[i];
+        worker->pool = pool;
+        if (qr_scanner_init(&worker->scanner, mode, cache) < 0) {
+            scan_pool_stop(pool);
+            return -1;
+        }
+        worker->scanner.snapshots = snapshots;
+        worker->scanner.entities = entities;
+        worker->scanner.tracker = tracker;
+        if (pthread_create(&worker->thread, NULL, worker_thread, worker) != 0) {
+            perror("Erreur lors de la création d'un thread d'analyse");
+            qr_scanner_close(&worker->scanner);
+            scan_pool_stop(pool);
+            return -1;
+        }
+        worker->started = 1;
+    }
+    return 0;
+}
+
+void scan_pool_push(ScanPool* pool, GstSample* sample) {
+    GstSample* dropped = NULL;
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stats.received++;
+    if (!pool->running) {
+        dropped = sample;
+    } else {
+        if (pool->count == pool->capacity) {
+            // La frame la plus récente est la plus utile : on abandonne la plus ancienne
+            dropped = pool->jobs[pool->head].sample;
+            pool->head = (pool->head + 1) % pool->capacity;
+            pool->count--;
+            pool->stats.dropped++;
+        }
+        ScanJob* job = &pool->jobs[(pool->head + pool->count) % pool->capacity];
+        job->sample = sample;
+        job->pts = buffer ? GST_BUFFER_PTS(buffer) : GST_CLOCK_TIME_NONE;
+        job->frame_id = (uint32_t)pool->stats.received;
+        pool->count++;
+        if (pool->count > pool->stats.max_depth) pool->stats.max_depth = pool->count;
+        pthread_cond_signal(&pool->not_empty);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // Libérée hors verrou : rend le buffer au pool GStreamer
+    if (dropped) gst_sample_unref(dropped);
+}
+
+void scan_pool_stop(ScanPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->running = 0;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->n_workers; i++) {
+        ScanWorker* worker = &pool->workers[i];
+        if (worker->started) {
+            pthread_join(worker->thread, NULL);
+            worker->started = 0;
+            qr_scanner_print_stats(&worker->scanner);
+            qr_scanner_close(&worker->scanner);
+        }
+    }
+
+    while (pool->count > 0) {
+        gst_sample_unref(pool->jobs[pool->head].sample);
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+    }
+}
+
+void scan_pool_print_stats(ScanPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    ScanPoolStats s = pool->stats;
+    GstClockTime pts = pool->last_pts;
+    pthread_mutex_unlock(&pool->lock);
+
+    printf("Pool QR [%d workers, file %u]: %lu reçues, %lu scannées, %lu perdues, %lu avec symbole\n",
+           pool->n_workers, pool->capacity, s.received, s.scanned, s.dropped, s.with_symbol);
+    printf("  File: profondeur max %u, scan moyen %.2f ms (max %.2f ms), dernière frame %" G_GUINT64_FORMAT " ms\n",
+           s.max_depth, s.scanned ? s.scan_total_ms / s.scanned : 0.0, s.scan_max_ms,
+           GST_CLOCK_TIME_IS_VALID(pts) ? pts / GST_MSECOND : 0);
+}
@@ -0,0 +1,82 @@
+#ifndef SCAN_POOL_H
+#define SCAN_POOL_H
+
+#include <gst/gst.h>
+#include <pthread.h>
+#include "Decode_QR.h"
+
+// Pool de threads d'analyse QR derrière l'appsink. Le callback GStreamer ne fait
+// que déposer une référence sur le GstSample (sans copie) dans une file bornée ;
+// chaque worker a son propre scanner ZBar. Les frames sont scannées en parallèle
+// mais leurs résultats sont traités dans l'ordre d'arrivée (donc de timestamp).
+//
+// En mode rapide, la ROI est partagée : chaque frame repart de celle publiée par la
+// dernière frame traitée (en retard d'au plus n_workers - 1 frames sur un flux séquentiel).
+// Le cache inter-frames de ZBar, lui, reste propre à chaque scanner et ne voit qu'une
+// frame sur n_workers : un symbole est confirmé plus tard et peut être signalé une fois
+// par worker. Avec le cache, lancer un seul worker (workers=1) garde l'anti-doublon complet.
+
+#define SCAN_POOL_MAX_WORKERS 8
+#define SCAN_POOL_MAX_DEPTH 16
+#define SCAN_POOL_STATS_INTERVAL 100  // Frames entre deux affichages des statistiques
+
+typedef struct {
+    GstSample* sample;
+    GstClockTime pts;
+    uint32_t frame_id;  // Rang de la frame parmi celles reçues (les pertes laissent des trous)
+} ScanJob;
+
+typedef struct {
+    unsigned long received;     // Frames déposées par l'appsink
+    unsigned long dropped;      // Frames remplacées dans la file pleine avant d'être scannées
+    unsigned long scanned;      // Frames scannées
+    unsigned long with_symbol;  // Frames scannées avec au moins un symbole
+    unsigned int max_depth;     // Profondeur maximale atteinte par la file
+    double scan_total_ms;       // Temps ZBar cumulé (tous workers)
+    double scan_max_ms;
+} ScanPoolStats;
+
+typedef struct ScanPool ScanPool;
+
+typedef struct {
+    ScanPool* pool;
+    QrScanner scanner;
+    pthread_t thread;
+    int started;
+} ScanWorker;
+
+struct ScanPool {
+    ScanWorker workers[SCAN_POOL_MAX_WORKERS];
+    int n_workers;
+    ScanJob jobs[SCAN_POOL_MAX_DEPTH];  // File circulaire, la plus ancienne frame en tête
+    unsigned int head;
+    unsigned int count;
+    unsigned int capacity;
+    unsigned long next_ticket;  // Numéro donné à la prochaine frame sortie de la file
+    unsigned long next_emit;    // Numéro de la frame dont les résultats sont attendus
+    GstClockTime last_pts;      // Timestamp de la dernière frame traitée
+    QrRoi roi;                  // ROI de la dernière frame traitée, reprise par le prochain scan
+    int running;
+    ScanPoolStats stats;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t turn;        // Signalé quand next_emit avance
+};
+
+// Démarre n_workers threads (bornés à SCAN_POOL_MAX_WORKERS), chacun avec un scanner
+// configuré selon mode et cache. depth est la taille de la file (1 à SCAN_POOL_MAX_DEPTH).
+// snapshots, entities et tracker (l'automate du flux) sont partagés par tous les scanners.
+// Retourne -1 en cas d'erreur.
+int scan_pool_start(ScanPool* pool, int n_workers, unsigned int depth, QrScanMode mode, int cache,
+                    SnapshotWorker* snapshots, EntityRegistry* entities, DetectionTracker* tracker);
+
+// Dépose une frame GRAY8 sans bloquer, le pool prend la référence sur sample.
+// File pleine : la frame la plus ancienne est abandonnée au profit de celle-ci.
+void scan_pool_push(ScanPool* pool, GstSample* sample);
+
+// Arrête les workers (les frames en cours sont terminées, celles en file abandonnées)
+void scan_pool_stop(ScanPool* pool);
+
+void scan_pool_print_stats(ScanPool* pool);
+
+#endif // SCAN_POOL_H
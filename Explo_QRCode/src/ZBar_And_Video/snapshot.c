@@ -0,0 +1,241 @@
+#include "snapshot.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <jpeglib.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+} SnapshotError;
+
+// Par défaut libjpeg appelle exit() : une erreur (disque plein...) arrêterait le détecteur
+static void on_jpeg_error(j_common_ptr cinfo) {
+    char message[JMSG_LENGTH_MAX];
+    cinfo->err->format_message(cinfo, message);
+    fprintf(stderr, "Erreur encodage de la capture : %s\n", message);
+    longjmp(((SnapshotError *)cinfo->err)->jump, 1);
+}
+
+// Encode une frame GRAY8 en JPEG dans un fichier temporaire puis le renomme :
+// un lecteur ne voit jamais de fichier à moitié écrit
+static int write_jpeg(const char *path, const SnapshotSlot *slot) {
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        perror("Erreur ouverture fichier de capture");
+        return -1;
+    }
+
+    struct jpeg_compress_struct cinfo;
+    SnapshotError jerr;
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = on_jpeg_error;
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        fclose(file);
+        remove(tmp_path);
+        return -1;
+    }
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, file);
+
+    cinfo.image_width = slot->width;
+    cinfo.image_height = slot->height;
+    cinfo.input_components = 1;
+    cinfo.in_color_space = JCS_GRAYSCALE;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, SNAPSHOT_QUALITY, TRUE);
+    cinfo.dct_method = JDCT_IFAST;
+
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = slot->pixels + (size_t)cinfo.next_scanline * slot->width;
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    // Une écriture courte ne lève pas toujours d'erreur libjpeg : ferror() la détecte
+    int write_error = ferror(file);
+    if (fclose(file) != 0 || write_error || rename(tmp_path, path) != 0) {
+        perror("Erreur écriture fichier de capture");
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// Thread d'encodage : traite les emplacements prêts dans l'ordre des demandes
+static void *snapshot_thread(void *arg) {
+    SnapshotWorker *w = (SnapshotWorker *)arg;
+
+    pthread_mutex_lock(&w->lock);
+    while (1) {
+        while (w->running && w->queue_count == 0) {
+            pthread_cond_wait(&w->ready, &w->lock);
+        }
+        if (w->queue_count == 0) break;  // Arrêt demandé et file vide
+
+        SnapshotSlot *slot = &w->slots[w->queue[w->queue_head]];
+        w->queue_head = (w->queue_head + 1) % SNAPSHOT_SLOTS;
+        w->queue_count--;
+        slot->state = SNAPSHOT_ENCODING;
+        pthread_mutex_unlock(&w->lock);
+
+        // Encodage hors verrou : les demandes restent possibles pendant ce temps
+        double start = now_ms();
+        int ret = write_jpeg(w->path, slot);
+        double elapsed = now_ms() - start;
+        if (ret == 0) printf("Image capturée : %s (%s)\n", w->path, slot->symbol);
+
+        pthread_mutex_lock(&w->lock);
+        slot->state = SNAPSHOT_FREE;
+        if (ret == 0) {
+            w->stats.written++;
+            w->stats.encode_total_ms += elapsed;
+            if (elapsed > w->stats.encode_max_ms) w->stats.encode_max_ms = elapsed;
+        } else {
+            w->stats.failed++;
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+int snapshot_start(SnapshotWorker *w, const char *path) {
+    memset(w, 0, sizeof(*w));
+    w->path = path;
+    w->running = 1;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->ready, NULL);
+
+    if (pthread_create(&w->thread, NULL, snapshot_thread, w) != 0) {
+        perror("Erreur lors de la création du thread de capture");
+        w->running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+// Entrée de limitation de débit du symbole, NULL s'il n'est pas suivi (verrou tenu)
+static SnapshotRate *rate_find(SnapshotWorker *w, const char *symbol) {
+    for (int i = 0; i < SNAPSHOT_SYMBOLS; i++) {
+        SnapshotRate *rate = &w->rates[i];
+        if (rate->symbol[0] && strncmp(rate->symbol, symbol, SNAPSHOT_MAX_SYMBOL_LEN - 1) == 0) {
+            return rate;
+        }
+    }
+    return NULL;
+}
+
+// Nouveau symbole : remplace celui capturé il y a le plus longtemps (verrou tenu)
+static SnapshotRate *rate_add(SnapshotWorker *w, const char *symbol) {
+    SnapshotRate *oldest = &w->rates[0];
+    for (int i = 1; i < SNAPSHOT_SYMBOLS; i++) {
+        if (w->rates[i].last_ms < oldest->last_ms) oldest = &w->rates[i];
+    }
+    snprintf(oldest->symbol, sizeof(oldest->symbol), "%s", symbol);
+    return oldest;
+}
+
+int snapshot_request(SnapshotWorker *w, const char *symbol, const uint8_t *gray_data,
+                     int width, int height, int stride) {
+    double now = now_ms();
+
+    pthread_mutex_lock(&w->lock);
+    w->stats.requested++;
+    if (!w->running) {
+        pthread_mutex_unlock(&w->lock);
+        return 0;
+    }
+    SnapshotRate *rate = rate_find(w, symbol);
+    if (rate && now - rate->last_ms < SNAPSHOT_MIN_INTERVAL_MS) {
+        w->stats.rate_limited++;
+        pthread_mutex_unlock(&w->lock);
+        return 0;
+    }
+    SnapshotSlot *slot = NULL;
+    for (int i = 0; i < SNAPSHOT_SLOTS && !slot; i++) {
+        if (w->slots[i].state == SNAPSHOT_FREE) slot = &w->slots[i];
+    }
+    if (!slot) {
+        // Encodeur saturé : on perd la capture plutôt que de bloquer l'analyse
+        w->stats.dropped++;
+        pthread_mutex_unlock(&w->lock);
+        return 0;
+    }
+    // Le délai ne démarre que pour une capture réellement programmée
+    if (!rate) rate = rate_add(w, symbol);
+    rate->last_ms = now;
+    slot->state = SNAPSHOT_FILLING;
+    pthread_mutex_unlock(&w->lock);
+
+    // Copie hors verrou : la frame appartient à GStreamer et sera réutilisée
+    size_t size = (size_t)width * height;
+    if (slot->capacity < size) {
+        uint8_t *pixels = realloc(slot->pixels, size);
+        if (!pixels) {
+            perror("Erreur d'allocation mémoire");
+            pthread_mutex_lock(&w->lock);
+            slot->state = SNAPSHOT_FREE;
+            w->stats.failed++;
+            pthread_mutex_unlock(&w->lock);
+            return -1;
+        }
+        slot->pixels = pixels;
+        slot->capacity = size;
+    }
+    for (int row = 0; row < height; row++) {
+        memcpy(slot->pixels + (size_t)row * width, gray_data + (size_t)row * stride, width);
+    }
+    slot->width = width;
+    slot->height = height;
+    snprintf(slot->symbol, sizeof(slot->symbol), "%s", symbol);
+
+    pthread_mutex_lock(&w->lock);
+    slot->state = SNAPSHOT_READY;
+    w->queue[(w->queue_head + w->queue_count) % SNAPSHOT_SLOTS] = (int)(slot - w->slots);
+    w->queue_count++;
+    pthread_cond_signal(&w->ready);
+    pthread_mutex_unlock(&w->lock);
+    return 1;
+}
+
+void snapshot_stop(SnapshotWorker *w) {
+    pthread_mutex_lock(&w->lock);
+    int was_running = w->running;
+    w->running = 0;
+    pthread_cond_signal(&w->ready);
+    pthread_mutex_unlock(&w->lock);
+
+    if (was_running) pthread_join(w->thread, NULL);
+    for (int i = 0; i < SNAPSHOT_SLOTS; i++) {
+        free(w->slots[i].pixels);
+        w->slots[i].pixels = NULL;
+        w->slots[i].capacity = 0;
+    }
+}
+
+void snapshot_print_stats(SnapshotWorker *w) {
+    pthread_mutex_lock(&w->lock);
+    SnapshotStats s = w->stats;
+    pthread_mutex_unlock(&w->lock);
+
+    printf("Captures: %lu demandées, %lu écrites, %lu limitées, %lu perdues (file pleine), %lu erreurs\n",
+           s.requested, s.written, s.rate_limited, s.dropped, s.failed);
+    if (s.written > 0) {
+        printf("  Encodage JPEG: moyenne %.2f ms, max %.2f ms\n",
+               s.encode_total_ms / s.written, s.encode_max_ms);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Captures d'image lors d'une détection, prises sur la frame déjà en mémoire.
+// La frame est recopiée dans un emplacement préalloué puis encodée en JPEG
+// (libjpeg-turbo) par un thread dédié : le thread d'analyse ne bloque jamais sur
+// l'encodage ni sur l'écriture du fichier.
+
+#define SNAPSHOT_SLOTS 4                 // Captures en attente d'encodage au maximum
+#define SNAPSHOT_SYMBOLS 32              // Symboles suivis pour la limitation de débit
+#define SNAPSHOT_MAX_SYMBOL_LEN 128
+#define SNAPSHOT_MIN_INTERVAL_MS 2000.0  // Délai minimal entre deux captures d'un même symbole
+#define SNAPSHOT_QUALITY 85
+
+typedef enum {
+    SNAPSHOT_FREE,     // Emplacement disponible
+    SNAPSHOT_FILLING,  // Frame en cours de copie par le thread d'analyse
+    SNAPSHOT_READY,    // En attente d'encodage
+    SNAPSHOT_ENCODING,
+} SnapshotState;
+
+typedef struct {
+    SnapshotState state;
+    uint8_t *pixels;   // GRAY8 sans padding, réalloué seulement si la frame grandit
+    size_t capacity;
+    int width, height;
+    char symbol[SNAPSHOT_MAX_SYMBOL_LEN];
+} SnapshotSlot;
+
+// Dernière capture de chaque symbole
+typedef struct {
+    char symbol[SNAPSHOT_MAX_SYMBOL_LEN];
+    double last_ms;
+} SnapshotRate;
+
+typedef struct {
+    unsigned long requested;     // Demandes de capture
+    unsigned long rate_limited;  // Ignorées : même symbole capturé trop récemment
+    unsigned long dropped;       // Ignorées : tous les emplacements occupés
+    unsigned long written;       // Fichiers JPEG écrits
+    unsigned long failed;
+    double encode_total_ms;
+    double encode_max_ms;
+} SnapshotStats;
+
+typedef struct {
+    const char *path;  // Fichier de la dernière capture, remplacé atomiquement
+    SnapshotSlot slots[SNAPSHOT_SLOTS];
+    int queue[SNAPSHOT_SLOTS];  // Emplacements prêts, dans l'ordre des demandes
+    int queue_head;
+    int queue_count;
+    SnapshotRate rates[SNAPSHOT_SYMBOLS];
+    SnapshotStats stats;
+    int running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} SnapshotWorker;
+
+// Démarre le thread d'encodage, retourne -1 en cas d'erreur
+int snapshot_start(SnapshotWorker *w, const char *path);
+
+// Demande la capture d'une frame GRAY8 (lignes de stride octets) pour un symbole.
+// Ne bloque pas : retourne 1 si la capture est programmée, 0 si elle est ignorée
+// (limitation de débit ou file pleine), -1 en cas d'erreur.
+int snapshot_request(SnapshotWorker *w, const char *symbol, const uint8_t *gray_data,
+                     int width, int height, int stride);
+
+// Encode les captures en attente puis arrête le thread.
+// À appeler une fois les threads d'analyse arrêtés.
+void snapshot_stop(SnapshotWorker *w);
+
+void snapshot_print_stats(SnapshotWorker *w);
+
+#endif // SNAPSHOT_H
@@ -14,6 +14,12 @@
 #include <dirent.h>
 #include <sys/stat.h>  // Pour mkdir
 #include <sys/types.h> // Types supplémentaires pour mkdir
+#include "../com_udp.h"
+#include "../crc32c.h"
+#include "../compression.h"
+#include "../capture_v4l2.h"
+#include <linux/videodev2.h>
+
 
 #define PORT 8888
 #define BUFFER_SIZE 9000  // Pour accueillir l'en-tête + données (8Ko + marge)
@@ -22,15 +28,10 @@
 #define MAX_FRAG_SIZE 8192  // 8 Ko par fragment
 #define MAX_CLIENTS 10      // Nombre maximum de clients à mémoriser
 #define CMD_BUFFER_SIZE 1024 // Taille du buffer pour les commandes
-
-// Structure pour l'en-tête des fragments
-typedef struct {
-    uint32_t image_id;     // Identifiant unique de l'image
-    uint32_t seq_num;      // Numéro de séquence du fragment
-    uint32_t total_frags;  // Nombre total de fragments
-    uint32_t frag_size;    // Taille du fragment en octets
-    uint8_t is_last;       // Indique si c'est le dernier fragment
-} ImageFragmentHeader;
+#define CAMERA_DEVICE "/dev/video0"
+#define CAMERA_WIDTH 1280
+#define CAMERA_HEIGHT 720
+#define CAMERA_WAIT_MS 2000  // Attente maximale d'une frame de la caméra
 
 // Structure pour stocker une image en cours de réception
 typedef struct {
@@ -41,8 +42,16 @@ typedef struct {
     uint8_t *received_frags;  // Tableau de bits pour suivre les fragments reçus
     uint32_t total_frags;
     time_t last_update;
+    uint8_t has_image_crc;    // CRC de l'image reçu avec le dernier fragment
+    uint32_t image_crc;
+    uint8_t compression;      // CompressionType annoncé par l'émetteur
+    uint32_t original_size;   // Taille après décompression
 } ImageReceiver;
 
+// Compteurs d'intégrité
+uint32_t corrupted_frags = 0;   // Fragments rejetés (CRC invalide)
+uint32_t corrupted_images = 0;  // Images complètes dont le CRC ne correspond pas
+
 // Structure pour stocker les informations des clients
 typedef struct {
     struct sockaddr_in addr;
@@ -57,6 +66,10 @@ ClientInfo clients[MAX_CLIENTS];
 pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
 int running = 1;
 
+// Caméra en MJPEG natif, ouverte à la première commande qui en a besoin
+CaptureDevice camera;
+int camera_ready = 0;
+
 // Initialise la structure de réception d'image
 ImageReceiver* init_image_receiver(uint32_t image_id, uint32_t total_frags) {
     ImageReceiver *receiver = malloc(sizeof(ImageReceiver));
@@ -69,6 +82,10 @@ ImageReceiver* init_image_receiver(uint32_t image_id, uint32_t total_frags) {
     receiver->received_frags = calloc((total_frags + 7) / 8, 1);  // Bitmap pour les fragments reçus
     receiver->total_frags = total_frags;
     receiver->last_update = time(NULL);
+    receiver->has_image_crc = 0;
+    receiver->image_crc = 0;
+    receiver->compression = COMPRESSION_NONE;
+    receiver->original_size = 0;
     
     return receiver;
 }
@@ -106,6 +123,34 @@ void free_image_receiver(ImageReceiver *receiver) {
     }
 }
 
+// Remplace les données compressées de l'image par les données d'origine
+int decompress_image(ImageReceiver *receiver) {
+    if (!compression_supported(receiver->compression)) {
+        printf("Compression %u non supportée par ce serveur\n", receiver->compression);
+        return -1;
+    }
+    if (receiver->original_size > MAX_IMAGE_SIZE) {
+        printf("Taille décompressée invalide (%u octets)\n", receiver->original_size);
+        return -1;
+    }
+    
+    uint8_t *original = malloc(receiver->original_size);
+    if (!original) return -1;
+    
+    CompressionStats stats;
+    if (decompress_buffer(receiver->compression, receiver->data, receiver->total_size,
+                          original, receiver->original_size, &stats) < 0) {
+        free(original);
+        return -1;
+    }
+    print_compression_stats("Décompression", &stats);
+    
+    free(receiver->data);
+    receiver->data = original;
+    receiver->total_size = receiver->original_size;
+    return 0;
+}
+
 // Sauvegarde l'image complète dans un fichier
 void save_image(ImageReceiver *receiver, const char* filename) {
     FILE *fp = fopen(filename, "wb");
@@ -244,51 +289,22 @@ void list_images(const char *directory) {
 }
 
 // Envoie une image JPEG via UDP
-void send_jpeg_image(int sockfd, struct sockaddr_in *dest_addr, socklen_t addr_len, const char *image_path) {
-    // Ouvrir et lire l'image
-    FILE *fp = fopen(image_path, "rb");
-    if (!fp) {
-        perror("Impossible d'ouvrir l'image");
-        return;
-    }
-    
-    // Déterminer la taille de l'image
-    fseek(fp, 0, SEEK_END);
-    long image_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-    
-    printf("Taille de l'image %s: %ld octets\n", image_path, image_size);
-    
-    // Allouer la mémoire pour l'image
-    uint8_t *image_data = malloc(image_size);
-    if (!image_data) {
-        perror("Erreur d'allocation mémoire");
-        fclose(fp);
-        return;
-    }
-    
-    // Lire l'image en mémoire
-    size_t bytes_read = fread(image_data, 1, image_size, fp);
-    fclose(fp);
-    
-    if (bytes_read != image_size) {
-        perror("Erreur de lecture du fichier");
-        free(image_data);
-        return;
-    }
-    
+// Fragmente et envoie une image JPEG déjà en mémoire (fichier lu ou frame MJPEG de la caméra).
+// capture_us : date de capture de la frame (extension CAPTURE_TIME), 0 si inconnue.
+void send_jpeg_buffer(int sockfd, struct sockaddr_in *dest_addr, socklen_t addr_len,
+                      const uint8_t *image_data, uint32_t image_size, uint32_t image_id,
+                      uint64_t capture_us) {
     // Paramètres de fragmentation
     uint32_t total_frags = (image_size + MAX_FRAG_SIZE - 1) / MAX_FRAG_SIZE;
-    uint32_t image_id = (uint32_t)time(NULL);  // Utiliser le timestamp comme ID
+    uint32_t image_crc = crc32c(image_data, image_size);  // Vérifié par le récepteur
     
     printf("Fragmentation de l'image en %u fragments de %u octets max\n", 
            total_frags, MAX_FRAG_SIZE);
     
     // Buffer pour stocker l'en-tête + les données
-    uint8_t *packet = malloc(sizeof(ImageFragmentHeader) + MAX_FRAG_SIZE);
+    uint8_t *packet = malloc(FRAG_HEADER_MAX_SIZE + MAX_FRAG_SIZE);
     if (!packet) {
         perror("Erreur d'allocation mémoire pour le packet");
-        free(image_data);
         return;
     }
     
@@ -299,22 +315,32 @@ void send_jpeg_image(int sockfd, struct sockaddr_in *dest_addr, socklen_t addr_l
             (image_size - offset) : MAX_FRAG_SIZE;
         
         // Préparer l'en-tête
-        ImageFragmentHeader header = {
-            .image_id = image_id,
+        FragmentHeader header = {
+            .flags = FRAG_FLAG_CRC | ((i == total_frags - 1) ? FRAG_FLAG_LAST : 0),
+            .transfer_id = image_id,
             .seq_num = i,
             .total_frags = total_frags,
-            .frag_size = current_frag_size,
-            .is_last = (i == total_frags - 1) ? 1 : 0
+            .offset = offset,
+            .total_size = image_size,
+            .has_image_crc = (i == total_frags - 1),
+            .image_crc = image_crc,
+            .has_capture_time = (capture_us != 0),
+            .capture_time_us = capture_us
         };
         
-        // Copier l'en-tête dans le packet
-        memcpy(packet, &header, sizeof(header));
+        // Encoder l'en-tête dans le packet
+        int header_len = encode_fragment_header(&header, packet, FRAG_HEADER_MAX_SIZE);
+        if (header_len < 0) {
+            fprintf(stderr, "Erreur d'encodage de l'en-tête du fragment %u\n", i);
+            continue;
+        }
         
         // Copier les données dans le packet
-        memcpy(packet + sizeof(header), image_data + offset, current_frag_size);
+        memcpy(packet + header_len, image_data + offset, current_frag_size);
+        seal_fragment_crc(packet, header_len + current_frag_size);
         
         // Envoyer le fragment
-        ssize_t sent_bytes = sendto(sockfd, packet, sizeof(header) + current_frag_size, 0,
+        ssize_t sent_bytes = sendto(sockfd, packet, header_len + current_frag_size, 0,
                                    (struct sockaddr *)dest_addr, addr_len);
         
         if (sent_bytes < 0) {
@@ -330,10 +356,101 @@ void send_jpeg_image(int sockfd, struct sockaddr_in *dest_addr, socklen_t addr_l
     }
     
     free(packet);
-    free(image_data);
     printf("Image envoyée avec succès! ID=%u\n", image_id);
 }
 
+void send_jpeg_image(int sockfd, struct sockaddr_in *dest_addr, socklen_t addr_len, const char *image_path) {
+    // Ouvrir et lire l'image
+    FILE *fp = fopen(image_path, "rb");
+    if (!fp) {
+        perror("Impossible d'ouvrir l'image");
+        return;
+    }
+    
+    // Déterminer la taille de l'image
+    fseek(fp, 0, SEEK_END);
+    long image_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    
+    printf("Taille de l'image %s: %ld octets\n", image_path, image_size);
+    
+    // Allouer la mémoire pour l'image
+    uint8_t *image_data = malloc(image_size);
+    if (!image_data) {
+        perror("Erreur d'allocation mémoire");
+        fclose(fp);
+        return;
+    }
+    
+    // Lire l'image en mémoire
+    size_t bytes_read = fread(image_data, 1, image_size, fp);
+    fclose(fp);
+    
+    if (bytes_read != image_size) {
+        perror("Erreur de lecture du fichier");
+        free(image_data);
+        return;
+    }
+    
+    uint32_t image_id = (uint32_t)time(NULL);  // Utiliser le timestamp comme ID
+    send_jpeg_buffer(sockfd, dest_addr, addr_len, image_data, image_size, image_id, 0);
+    free(image_data);
+}
+
+// Ouvre la caméra en MJPEG natif si elle le propose : ses frames sont déjà des JPEG,
+// envoyées telles quelles (ni frames brutes sur le réseau, ni encodage sur le CPU)
+int open_camera(void) {
+    if (camera_ready) return 0;
+
+    const uint32_t formats[] = { V4L2_PIX_FMT_MJPEG, V4L2_PIX_FMT_JPEG };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (capture_probe_format(CAMERA_DEVICE, formats[i]) != 1) continue;
+
+        if (capture_open(&camera, CAMERA_DEVICE, CAMERA_WIDTH, CAMERA_HEIGHT, formats[i], 4) == -1) {
+            return -1;
+        }
+        if (capture_start(&camera) == -1) {
+            capture_close(&camera);
+            return -1;
+        }
+        camera_ready = 1;
+        printf("Caméra %s ouverte en %.4s %ux%u\n", CAMERA_DEVICE,
+               (const char *)&camera.pixelformat, camera.width, camera.height);
+        return 0;
+    }
+
+    printf("La caméra %s ne propose pas de MJPEG (ou est absente)\n", CAMERA_DEVICE);
+    return -1;
+}
+
+// Capture une frame récente de la caméra, à rendre avec capture_release()
+CaptureBuffer *grab_camera_frame(void) {
+    if (open_camera() == -1) return NULL;
+
+    // Les frames remplies depuis la dernière commande sont anciennes : rendues au driver
+    CaptureBuffer *frame;
+    while ((frame = capture_acquire(&camera)) != NULL) {
+        capture_release(&camera, frame);
+    }
+
+    if (capture_wait(&camera, CAMERA_WAIT_MS) != 1) {
+        printf("Aucune frame reçue de la caméra\n");
+        return NULL;
+    }
+    CaptureBuffer *latest = NULL;
+    while ((frame = capture_acquire(&camera)) != NULL) {
+        if (latest) capture_release(&camera, latest);
+        latest = frame;
+    }
+    return latest;
+}
+
+// Envoie une frame MJPEG directement depuis le buffer du driver
+void send_camera_frame(struct sockaddr_in *dest_addr, socklen_t addr_len, const CaptureBuffer *frame) {
+    send_jpeg_buffer(sockfd, dest_addr, addr_len, frame->start, frame->bytesused, frame->sequence,
+                     capture_epoch_us(capture_frame_time_ms(frame)));
+}
+
 // Thread pour lire les commandes de l'utilisateur
 void* command_thread(void *arg) {
     char cmd_buffer[CMD_BUFFER_SIZE];
@@ -345,6 +462,8 @@ void* command_thread(void *arg) {
     printf("- list_images [dossier] : Liste les images JPEG dans le dossier spécifié\n");
     printf("- send_image [client_idx] [chemin_image] : Envoie une image au client spécifié\n");
     printf("- broadcast_image [chemin_image] : Envoie une image à tous les clients\n");
+    printf("- send_camera [client_idx] : Envoie une photo de la caméra (MJPEG) au client spécifié\n");
+    printf("- broadcast_camera : Envoie une photo de la caméra à tous les clients\n");
     printf("- quit : Quitte le serveur\n");
     
     while (running) {
@@ -421,6 +540,50 @@ void* command_thread(void *arg) {
                 printf("Syntaxe incorrecte. Usage: broadcast_image [chemin_image]\n");
             }
         }
+        else if (strncmp(cmd_buffer, "send_camera", 11) == 0) {
+            int client_idx = -1;
+            
+            if (sscanf(cmd_buffer + 11, " %d", &client_idx) == 1) {
+                client_idx--;
+                
+                pthread_mutex_lock(&clients_mutex);
+                if (client_idx >= 0 && client_idx < MAX_CLIENTS && clients[client_idx].last_seen > 0) {
+                    struct sockaddr_in client_addr = clients[client_idx].addr;
+                    socklen_t addr_len = clients[client_idx].addr_len;
+                    pthread_mutex_unlock(&clients_mutex);
+                    
+                    CaptureBuffer *frame = grab_camera_frame();
+                    if (frame) {
+                        printf("Envoi de la frame %u (%u octets) au client %d...\n",
+                               frame->sequence, frame->bytesused, client_idx + 1);
+                        send_camera_frame(&client_addr, addr_len, frame);
+                        capture_release(&camera, frame);
+                    }
+                } else {
+                    pthread_mutex_unlock(&clients_mutex);
+                    printf("Index client invalide ou client inactif\n");
+                }
+            } else {
+                printf("Syntaxe incorrecte. Usage: send_camera [client_idx]\n");
+            }
+        }
+        else if (strcmp(cmd_buffer, "broadcast_camera") == 0) {
+            CaptureBuffer *frame = grab_camera_frame();
+            if (frame) {
+                // Une seule capture, la même frame part vers tous les clients
+                pthread_mutex_lock(&clients_mutex);
+                int sent_count = 0;
+                for (int i = 0; i < MAX_CLIENTS; i++) {
+                    if (clients[i].last_seen > 0) {
+                        send_camera_frame(&clients[i].addr, clients[i].addr_len, frame);
+                        sent_count++;
+                    }
+                }
+                pthread_mutex_unlock(&clients_mutex);
+                capture_release(&camera, frame);
+                printf("Frame de la caméra diffusée à %d clients\n", sent_count);
+            }
+        }
         else if (strcmp(cmd_buffer, "quit") == 0) {
             printf("Arrêt du serveur...\n");
             running = 0;
@@ -524,67 +687,89 @@ int main() {
         // Mettre à jour les informations du client
         update_client(&client_addr, client_len);
         
-        if (n <= sizeof(ImageFragmentHeader)) {
-            printf("Paquet trop petit reçu, ignoré\n");
+        // Extraction de l'en-tête
+        FragmentHeader header;
+        int header_len = decode_fragment_header(&header, (uint8_t *)buffer, n);
+        if (header_len < 0 || n <= header_len) {
+            printf("Paquet invalide ou trop petit reçu, ignoré\n");
             continue;
         }
+        uint32_t frag_size = n - header_len;
         
-        // Extraction de l'en-tête
-        ImageFragmentHeader header;
-        memcpy(&header, buffer, sizeof(header));
+        // Vérification de l'intégrité du fragment
+        if (!check_fragment_crc((uint8_t *)buffer, n)) {
+            corrupted_frags++;
+            printf("Fragment corrompu (CRC invalide), ignoré (%u au total)\n", corrupted_frags);
+            continue;
+        }
         
         // Affichage des informations du fragment
         printf("Fragment reçu de %s:%d: ID=%u, Seq=%u/%u, Taille=%u\n", 
                inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port),
-               header.image_id, header.seq_num + 1, header.total_frags, header.frag_size);
+               header.transfer_id, header.seq_num + 1, header.total_frags, frag_size);
         
         // Initialiser un nouveau récepteur si nécessaire
-        if (!current_receiver || current_receiver->image_id != header.image_id) {
+        if (!current_receiver || current_receiver->image_id != header.transfer_id) {
             if (current_receiver) {
                 printf("Nouvelle image détectée, abandon de l'image précédente\n");
                 free_image_receiver(current_receiver);
             }
             
-            current_receiver = init_image_receiver(header.image_id, header.total_frags);
+            current_receiver = init_image_receiver(header.transfer_id, header.total_frags);
             if (!current_receiver) {
                 perror("Erreur d'allocation mémoire");
                 continue;
             }
             
             printf("Démarrage de la réception de l'image ID %u (%u fragments)\n", 
-                   header.image_id, header.total_frags);
+                   header.transfer_id, header.total_frags);
         }
         
         // Mettre à jour le timestamp
         current_receiver->last_update = time(NULL);
         
+        // Ignorer un fragment hors du bitmap alloué pour cette image
+        if (header.seq_num >= current_receiver->total_frags) {
+            printf("Numéro de fragment invalide, ignoré\n");
+            continue;
+        }
+        
         // Si ce fragment a déjà été reçu, l'ignorer
         if (is_fragment_received(current_receiver, header.seq_num)) {
             printf("Fragment déjà reçu, ignoré\n");
             continue;
         }
         
-        // Calculer l'offset pour ce fragment
-        uint32_t offset = header.seq_num * 8192;  // Basé sur MAX_FRAG_SIZE du côté émetteur
+        // L'offset du fragment est transmis dans l'en-tête
+        uint32_t offset = header.offset;
         
-        // Vérifier si l'offset est valide
-        if (offset + header.frag_size > MAX_IMAGE_SIZE) {
+        // Vérifier si l'offset est valide (valeurs lues sur le réseau : pas d'addition qui déborde)
+        if (frag_size > MAX_IMAGE_SIZE || offset > MAX_IMAGE_SIZE - frag_size ||
+            header.total_size > MAX_IMAGE_SIZE || offset + frag_size > header.total_size) {
             printf("Offset invalide, fragment ignoré\n");
             continue;
         }
         
         // Copier les données du fragment
         memcpy(current_receiver->data + offset, 
-               buffer + sizeof(header), 
-               header.frag_size);
+               buffer + header_len, 
+               frag_size);
         
         // Mettre à jour les compteurs et marquer comme reçu
-        current_receiver->received_size += header.frag_size;
+        current_receiver->received_size += frag_size;
         mark_fragment_received(current_receiver, header.seq_num);
         
         // Mettre à jour la taille totale si c'est le dernier fragment
-        if (header.is_last) {
-            current_receiver->total_size = offset + header.frag_size;
+        if (header.flags & FRAG_FLAG_LAST) {
+            current_receiver->total_size = offset + frag_size;
+        }
+        if (header.has_image_crc) {
+            current_receiver->has_image_crc = 1;
+            current_receiver->image_crc = header.image_crc;
+        }
+        if (header.compression) {
+            current_receiver->compression = header.compression;
+            current_receiver->original_size = header.original_size;
         }
         
         // Vérifier si l'image est complète
@@ -592,6 +777,26 @@ int main() {
             printf("Image complète reçue! ID=%u, Taille=%u octets\n", 
                    current_receiver->image_id, current_receiver->total_size);
             
+            // Décompression si l'émetteur a compressé l'image
+            if (current_receiver->compression && decompress_image(current_receiver) < 0) {
+                printf("Échec de la décompression de l'image ID %u, non sauvegardée\n", 
+                       current_receiver->image_id);
+                free_image_receiver(current_receiver);
+                current_receiver = NULL;
+                continue;
+            }
+            
+            // Vérification de l'intégrité de l'image reconstituée
+            if (current_receiver->has_image_crc &&
+                crc32c(current_receiver->data, current_receiver->total_size) != current_receiver->image_crc) {
+                corrupted_images++;
+                printf("Image ID %u corrompue (CRC invalide), non sauvegardée (%u au total)\n", 
+                       current_receiver->image_id, corrupted_images);
+                free_image_receiver(current_receiver);
+                current_receiver = NULL;
+                continue;
+            }
+            
             // Générer un nom de fichier unique basé sur l'heure
             sprintf(filename, "received_images/image_%u_%ld.jpg", 
                     current_receiver->image_id, time(NULL));
@@ -612,6 +817,9 @@ int main() {
     if (current_receiver) {
         free_image_receiver(current_receiver);
     }
+    if (camera_ready) {
+        capture_close(&camera);
+    }
     
     close(sockfd);
     printf("Serveur arrêté\n");
@@ -7,20 +7,14 @@
 #include <arpa/inet.h>
 #include <stdint.h>
 #include <time.h>
+#include "../com_udp.h"
+#include "../crc32c.h"
+
 
 #define PORT 12345
 #define SERVER_IP "127.0.0.1"
 #define MAX_FRAG_SIZE 8192  // 8 Ko par fragment
 
-// Structure pour l'en-tête des fragments
-typedef struct {
-    uint32_t image_id;     // Identifiant unique de l'image
-    uint32_t seq_num;      // Numéro de séquence du fragment
-    uint32_t total_frags;  // Nombre total de fragments
-    uint32_t frag_size;    // Taille du fragment en octets
-    uint8_t is_last;       // Indique si c'est le dernier fragment
-} ImageFragmentHeader;
-
 // Envoie une image JPEG via UDP
 void send_jpeg_image(int sockfd, struct sockaddr_in *dest_addr, const char *image_path) {
     // Ouvrir et lire l'image
@@ -58,12 +52,13 @@ void send_jpeg_image(int sockfd, struct sockaddr_in *dest_addr, const char *imag
     // Paramètres de fragmentation
     uint32_t total_frags = (image_size + MAX_FRAG_SIZE - 1) / MAX_FRAG_SIZE;
     uint32_t image_id = (uint32_t)time(NULL);  // Utiliser le timestamp comme ID
+    uint32_t image_crc = crc32c(image_data, image_size);  // Vérifié par le récepteur
     
     printf("Fragmentation de l'image en %u fragments de %u octets max\n", 
            total_frags, MAX_FRAG_SIZE);
     
     // Buffer pour stocker l'en-tête + les données
-    uint8_t *packet = malloc(sizeof(ImageFragmentHeader) + MAX_FRAG_SIZE);
+    uint8_t *packet = malloc(FRAG_HEADER_MAX_SIZE + MAX_FRAG_SIZE);
     if (!packet) {
         perror("Erreur d'allocation mémoire pour le packet");
         free(image_data);
@@ -77,22 +72,30 @@ void send_jpeg_image(int sockfd, struct sockaddr_in *dest_addr, const char *imag
             (image_size - offset) : MAX_FRAG_SIZE;
         
         // Préparer l'en-tête
-        ImageFragmentHeader header = {
-            .image_id = image_id,
+        FragmentHeader header = {
+            .flags = FRAG_FLAG_CRC | ((i == total_frags - 1) ? FRAG_FLAG_LAST : 0),
+            .transfer_id = image_id,
             .seq_num = i,
             .total_frags = total_frags,
-            .frag_size = current_frag_size,
-            .is_last = (i == total_frags - 1) ? 1 : 0
+            .offset = offset,
+            .total_size = image_size,
+            .has_image_crc = (i == total_frags - 1),
+            .image_crc = image_crc
         };
         
-        // Copier l'en-tête dans le packet
-        memcpy(packet, &header, sizeof(header));
+        // Encoder l'en-tête dans le packet
+        int header_len = encode_fragment_header(&header, packet, FRAG_HEADER_MAX_SIZE);
+        if (header_len < 0) {
+            fprintf(stderr, "Erreur d'encodage de l'en-tête du fragment %u\n", i);
+            continue;
+        }
         
         // Copier les données dans le packet
-        memcpy(packet + sizeof(header), image_data + offset, current_frag_size);
+        memcpy(packet + header_len, image_data + offset, current_frag_size);
+        seal_fragment_crc(packet, header_len + current_frag_size);
         
         // Envoyer le fragment
-        ssize_t sent_bytes = sendto(sockfd, packet, sizeof(header) + current_frag_size, 0,
+        ssize_t sent_bytes = sendto(sockfd, packet, header_len + current_frag_size, 0,
                                    (struct sockaddr *)dest_addr, sizeof(*dest_addr));
         
         if (sent_bytes < 0) {
@@ -7,20 +7,17 @@
 #include <arpa/inet.h>
 #include <stdint.h>
 #include <time.h>
+#include "../com_udp.h"
+#include "../crc32c.h"
+#include "../compression.h"
+#include "../latency.h"
+
 
 #define PORT 12345
 #define BUFFER_SIZE 9000  // Pour accueillir l'en-tête + données (8Ko + marge)
 #define MAX_IMAGE_SIZE 10485760  // 10 Mo max par image
 #define TIMEOUT_SECONDS 10  // Timeout pour une image complète
-
-// Structure pour l'en-tête des fragments
-typedef struct {
-    uint32_t image_id;     // Identifiant unique de l'image
-    uint32_t seq_num;      // Numéro de séquence du fragment
-    uint32_t total_frags;  // Nombre total de fragments
-    uint32_t frag_size;    // Taille du fragment en octets
-    uint8_t is_last;       // Indique si c'est le dernier fragment
-} ImageFragmentHeader;
+#define MAX_STREAMS 8  // Flux multiplexés (extension STREAM_ID, 0 si absente)
 
 // Structure pour stocker une image en cours de réception
 typedef struct {
@@ -31,8 +28,21 @@ typedef struct {
     uint8_t *received_frags;  // Tableau de bits pour suivre les fragments reçus
     uint32_t total_frags;
     time_t last_update;
+    uint8_t has_image_crc;    // CRC de l'image reçu avec le dernier fragment
+    uint32_t image_crc;
+    uint8_t compression;      // CompressionType annoncé par l'émetteur
+    uint32_t original_size;   // Taille après décompression
+    uint8_t has_capture_time; // Date de capture transmise par l'émetteur (frames vidéo)
+    uint64_t capture_time_us;
 } ImageReceiver;
 
+// Compteurs d'intégrité
+uint32_t corrupted_frags = 0;   // Fragments rejetés (CRC invalide)
+uint32_t corrupted_images = 0;  // Images complètes dont le CRC ne correspond pas
+
+// Latence de bout en bout des frames horodatées, par flux
+LatencyStats latency[MAX_STREAMS];
+
 // Initialise la structure de réception d'image
 ImageReceiver* init_image_receiver(uint32_t image_id, uint32_t total_frags) {
     ImageReceiver *receiver = malloc(sizeof(ImageReceiver));
@@ -45,6 +55,12 @@ ImageReceiver* init_image_receiver(uint32_t image_id, uint32_t total_frags) {
     receiver->received_frags = calloc((total_frags + 7) / 8, 1);  // Bitmap pour les fragments reçus
     receiver->total_frags = total_frags;
     receiver->last_update = time(NULL);
+    receiver->has_image_crc = 0;
+    receiver->image_crc = 0;
+    receiver->compression = COMPRESSION_NONE;
+    receiver->original_size = 0;
+    receiver->has_capture_time = 0;
+    receiver->capture_time_us = 0;
     
     return receiver;
 }
@@ -82,6 +98,34 @@ void free_image_receiver(ImageReceiver *receiver) {
     }
 }
 
+// Remplace les données compressées de l'image par les données d'origine
+int decompress_image(ImageReceiver *receiver) {
+    if (!compression_supported(receiver->compression)) {
+        printf("Compression %u non supportée par ce serveur\n", receiver->compression);
+        return -1;
+    }
+    if (receiver->original_size > MAX_IMAGE_SIZE) {
+        printf("Taille décompressée invalide (%u octets)\n", receiver->original_size);
+        return -1;
+    }
+    
+    uint8_t *original = malloc(receiver->original_size);
+    if (!original) return -1;
+    
+    CompressionStats stats;
+    if (decompress_buffer(receiver->compression, receiver->data, receiver->total_size,
+                          original, receiver->original_size, &stats) < 0) {
+        free(original);
+        return -1;
+    }
+    print_compression_stats("Décompression", &stats);
+    
+    free(receiver->data);
+    receiver->data = original;
+    receiver->total_size = receiver->original_size;
+    return 0;
+}
+
 // Sauvegarde l'image complète dans un fichier
 void save_image(ImageReceiver *receiver, const char* filename) {
     FILE *fp = fopen(filename, "wb");
@@ -100,7 +144,7 @@ int main() {
     struct sockaddr_in server_addr, client_addr;
     char buffer[BUFFER_SIZE];
     socklen_t client_len = sizeof(client_addr);
-    ImageReceiver *current_receiver = NULL;
+    ImageReceiver *receivers[MAX_STREAMS] = {NULL};  // Image en cours pour chaque flux (caméra)
     char filename[100];
     
     // Création du socket UDP
@@ -123,6 +167,7 @@ int main() {
     }
     
     printf("Serveur UDP démarré sur le port %d, en attente d'images...\n", PORT);
+    for (int s = 0; s < MAX_STREAMS; s++) latency_init(&latency[s]);
     
     while (1) {
         // Configuration du timeout pour la fonction select
@@ -136,16 +181,18 @@ int main() {
         // Vérifier si des données sont disponibles
         int ready = select(sockfd + 1, &read_fds, NULL, NULL, &tv);
         
-        // Vérifier le timeout pour l'image en cours
+        // Vérifier le timeout pour l'image en cours de chaque flux
         time_t current_time = time(NULL);
-        if (current_receiver && 
-            difftime(current_time, current_receiver->last_update) > TIMEOUT_SECONDS) {
-            printf("Timeout pour l'image ID %u, %u/%u fragments reçus\n", 
-                   current_receiver->image_id, 
-                   current_receiver->received_size / 8192, 
-                   current_receiver->total_frags);
-            free_image_receiver(current_receiver);
-            current_receiver = NULL;
+        for (int s = 0; s < MAX_STREAMS; s++) {
+            if (receivers[s] && 
+                difftime(current_time, receivers[s]->last_update) > TIMEOUT_SECONDS) {
+                printf("Timeout pour l'image ID %u (flux %d), %u/%u fragments reçus\n", 
+                       receivers[s]->image_id, s,
+                       receivers[s]->received_size / 8192, 
+                       receivers[s]->total_frags);
+                free_image_receiver(receivers[s]);
+                receivers[s] = NULL;
+            }
         }
         
         if (ready <= 0) continue;  // Timeout ou erreur, continuer la boucle
@@ -154,82 +201,149 @@ int main() {
         int n = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, 
                         (struct sockaddr *)&client_addr, &client_len);
         
-        if (n <= sizeof(ImageFragmentHeader)) {
-            printf("Paquet trop petit reçu, ignoré\n");
+        // Extraction de l'en-tête
+        FragmentHeader header;
+        int header_len = decode_fragment_header(&header, (uint8_t *)buffer, n);
+        if (header_len < 0 || n <= header_len) {
+            printf("Paquet invalide ou trop petit reçu, ignoré\n");
             continue;
         }
+        uint32_t frag_size = n - header_len;
         
-        // Extraction de l'en-tête
-        ImageFragmentHeader header;
-        memcpy(&header, buffer, sizeof(header));
+        // Chaque flux a sa propre image en cours
+        uint8_t stream = header.has_stream_id ? header.stream_id : 0;
+        if (stream >= MAX_STREAMS) {
+            printf("Flux %u non géré, fragment ignoré\n", stream);
+            continue;
+        }
+        ImageReceiver **current = &receivers[stream];
+        
+        // Vérification de l'intégrité du fragment
+        if (!check_fragment_crc((uint8_t *)buffer, n)) {
+            corrupted_frags++;
+            printf("Fragment corrompu (CRC invalide), ignoré (%u au total)\n", corrupted_frags);
+            continue;
+        }
         
         // Affichage des informations du fragment
         printf("Fragment reçu: ID=%u, Seq=%u/%u, Taille=%u\n", 
-               header.image_id, header.seq_num + 1, header.total_frags, header.frag_size);
+               header.transfer_id, header.seq_num + 1, header.total_frags, frag_size);
         
         // Initialiser un nouveau récepteur si nécessaire
-        if (!current_receiver || current_receiver->image_id != header.image_id) {
-            if (current_receiver) {
+        if (!*current || (*current)->image_id != header.transfer_id) {
+            if (*current) {
                 printf("Nouvelle image détectée, abandon de l'image précédente\n");
-                free_image_receiver(current_receiver);
+                free_image_receiver(*current);
             }
             
-            current_receiver = init_image_receiver(header.image_id, header.total_frags);
-            if (!current_receiver) {
+            *current = init_image_receiver(header.transfer_id, header.total_frags);
+            if (!*current) {
                 perror("Erreur d'allocation mémoire");
                 continue;
             }
             
             printf("Démarrage de la réception de l'image ID %u (%u fragments)\n", 
-                   header.image_id, header.total_frags);
+                   header.transfer_id, header.total_frags);
         }
         
         // Mettre à jour le timestamp
-        current_receiver->last_update = time(NULL);
+        (*current)->last_update = time(NULL);
+        
+        // Ignorer un fragment hors du bitmap alloué pour cette image
+        if (header.seq_num >= (*current)->total_frags) {
+            printf("Numéro de fragment invalide, ignoré\n");
+            continue;
+        }
         
         // Si ce fragment a déjà été reçu, l'ignorer
-        if (is_fragment_received(current_receiver, header.seq_num)) {
+        if (is_fragment_received(*current, header.seq_num)) {
             printf("Fragment déjà reçu, ignoré\n");
             continue;
         }
         
-        // Calculer l'offset pour ce fragment
-        uint32_t offset = header.seq_num * 8192;  // Basé sur MAX_FRAG_SIZE du côté émetteur
+        // L'offset du fragment est transmis dans l'en-tête
+        uint32_t offset = header.offset;
         
-        // Vérifier si l'offset est valide
-        if (offset + header.frag_size > MAX_IMAGE_SIZE) {
+        // Vérifier si l'offset est valide (valeurs lues sur le réseau : pas d'addition qui déborde)
+        if (frag_size > MAX_IMAGE_SIZE || offset > MAX_IMAGE_SIZE - frag_size ||
+            header.total_size > MAX_IMAGE_SIZE || offset + frag_size > header.total_size) {
             printf("Offset invalide, fragment ignoré\n");
             continue;
         }
         
         // Copier les données du fragment
-        memcpy(current_receiver->data + offset, 
-               buffer + sizeof(header), 
-               header.frag_size);
+        memcpy((*current)->data + offset, 
+               buffer + header_len, 
+               frag_size);
         
         // Mettre à jour les compteurs et marquer comme reçu
-        current_receiver->received_size += header.frag_size;
-        mark_fragment_received(current_receiver, header.seq_num);
+        (*current)->received_size += frag_size;
+        mark_fragment_received(*current, header.seq_num);
         
         // Mettre à jour la taille totale si c'est le dernier fragment
-        if (header.is_last) {
-            current_receiver->total_size = offset + header.frag_size;
+        if (header.flags & FRAG_FLAG_LAST) {
+            (*current)->total_size = offset + frag_size;
+        }
+        if (header.has_image_crc) {
+            (*current)->has_image_crc = 1;
+            (*current)->image_crc = header.image_crc;
+        }
+        if (header.compression) {
+            (*current)->compression = header.compression;
+            (*current)->original_size = header.original_size;
+        }
+        if (header.has_capture_time) {
+            (*current)->has_capture_time = 1;
+            (*current)->capture_time_us = header.capture_time_us;
         }
         
         // Vérifier si l'image est complète
-        if (is_image_complete(current_receiver)) {
+        if (is_image_complete(*current)) {
             printf("Image complète reçue! ID=%u, Taille=%u octets\n", 
-                   current_receiver->image_id, current_receiver->total_size);
+                   (*current)->image_id, (*current)->total_size);
+            
+            // Latence capture -> dernier fragment reçu
+            if ((*current)->has_capture_time) {
+                double latency_ms = latency_update(&latency[stream], (*current)->capture_time_us,
+                                                   frag_clock_us());
+                printf("Flux %u, latence: %.2f ms, gigue: %.2f ms\n", stream, latency_ms,
+                       latency[stream].jitter_ms);
+                if (latency[stream].frames % 100 == 0) latency_print(&latency[stream]);
+            }
+            
+            // Décompression si l'émetteur a compressé l'image
+            if ((*current)->compression && decompress_image(*current) < 0) {
+                printf("Échec de la décompression de l'image ID %u, non sauvegardée\n", 
+                       (*current)->image_id);
+                free_image_receiver(*current);
+                *current = NULL;
+                continue;
+            }
+            
+            // Vérification de l'intégrité de l'image reconstituée
+            if ((*current)->has_image_crc &&
+                crc32c((*current)->data, (*current)->total_size) != (*current)->image_crc) {
+                corrupted_images++;
+                printf("Image ID %u corrompue (CRC invalide), non sauvegardée (%u au total)\n", 
+                       (*current)->image_id, corrupted_images);
+                free_image_receiver(*current);
+                *current = NULL;
+                continue;
+            }
             
             // Générer un nom de fichier unique
-            sprintf(filename, "received_image_%u.jpg", current_receiver->image_id);
+            if (header.has_stream_id) {
+                sprintf(filename, "received_s%u_%u.jpg", stream, (*current)->image_id);
+            } else {
+                sprintf(filename, "received_image_%u.jpg", (*current)->image_id);
+            }
             
             // Sauvegarder l'image
-            save_image(current_receiver, filename);
+            save_image(*current, filename);
             
             // Libérer les ressources
-            free_image_receiver(current_receiver);
-            current_receiver = NULL;
+            free_image_receiver(*current);
+            *current = NULL;
         }
     }
     
@@ -5,6 +5,10 @@
 #include <arpa/inet.h>
 #include <stdint.h>
 #include <time.h>
+#include "../com_udp.h"
+#include "../crc32c.h"
+#include "../compression.h"
+
 
 #define PORT 12345
 #define BUFFER_SIZE 9000  // Pour accueillir l'en-tête + données (8Ko + marge)
@@ -12,45 +16,54 @@
 #define MAX_FRAG_SIZE 8192  // Taille maximale d'un fragment (8 Ko)
 #define TIMEOUT_SECONDS 10  // Timeout pour une image complète
 
-// Structure pour l'en-tête des fragments
-typedef struct {
-    uint32_t image_id;     // Identifiant unique de l'image
-    uint32_t seq_num;      // Numéro de séquence du fragment
-    uint32_t total_frags;  // Nombre total de fragments
-    uint32_t frag_size;    // Taille du fragment en octets
-    uint8_t is_last;       // Indique si c'est le dernier fragment
-} ImageFragmentHeader;
-
 // Structure pour stocker une image
 typedef struct {
     uint32_t image_id;
     uint8_t *data;
     uint32_t size;
     uint32_t total_frags;
+    uint32_t crc;          // CRC32C de l'image complète (avant compression)
+    uint8_t compression;   // CompressionType appliqué à data
+    uint32_t original_size; // Taille avant compression
 } ImageToSend;
 
 // Fonction pour envoyer un fragment
 int send_image_fragment(int sockfd, struct sockaddr_in *client_addr, ImageToSend *image, uint32_t seq_num) {
     // Calculer l'offset du fragment
+    if (seq_num >= image->total_frags || (uint64_t)seq_num * MAX_FRAG_SIZE >= image->size) {
+        printf("Fragment %u hors de l'image, ignoré\n", seq_num);
+        return -1;
+    }
     uint32_t offset = seq_num * MAX_FRAG_SIZE;
-    uint32_t frag_size = (offset + MAX_FRAG_SIZE <= image->size) ? MAX_FRAG_SIZE : (image->size - offset);
+    uint32_t frag_size = (image->size - offset < MAX_FRAG_SIZE) ? (image->size - offset) : MAX_FRAG_SIZE;
     
     // Créer l'en-tête du fragment
-    ImageFragmentHeader header;
-    header.image_id = image->image_id;
-    header.seq_num = seq_num;
-    header.total_frags = image->total_frags;
-    header.frag_size = frag_size;
-    header.is_last = (offset + frag_size >= image->size);
+    FragmentHeader header = {
+        .flags = FRAG_FLAG_CRC | ((offset + frag_size >= image->size) ? FRAG_FLAG_LAST : 0),
+        .transfer_id = image->image_id,
+        .seq_num = seq_num,
+        .total_frags = image->total_frags,
+        .offset = offset,
+        .total_size = image->size,
+        .has_image_crc = (offset + frag_size >= image->size),
+        .image_crc = image->crc,
+        .compression = (offset + frag_size >= image->size) ? image->compression : 0,
+        .original_size = image->original_size
+    };
     
     // Créer un tampon pour le fragment (en-tête + données)
     uint8_t buffer[BUFFER_SIZE];
-    memcpy(buffer, &header, sizeof(header));
-    memcpy(buffer + sizeof(header), image->data + offset, frag_size);
+    int header_len = encode_fragment_header(&header, buffer, sizeof(buffer));
+    if (header_len < 0 || header_len + frag_size > sizeof(buffer)) {
+        printf("Erreur lors de l'encodage de l'en-tête\n");
+        return -1;
+    }
+    memcpy(buffer + header_len, image->data + offset, frag_size);
+    seal_fragment_crc(buffer, header_len + frag_size);
     
     // Envoyer le fragment
     socklen_t client_len = sizeof(*client_addr);
-    ssize_t sent_size = sendto(sockfd, buffer, sizeof(header) + frag_size, 0, 
+    ssize_t sent_size = sendto(sockfd, buffer, header_len + frag_size, 0, 
                                (struct sockaddr *)client_addr, client_len);
     if (sent_size < 0) {
         perror("Erreur lors de l'envoi du fragment");
@@ -58,13 +71,13 @@ int send_image_fragment(int sockfd, struct sockaddr_in *client_addr, ImageToSend
     }
     
     printf("Fragment envoyé: ID=%u, Seq=%u/%u, Taille=%u\n", 
-           header.image_id, header.seq_num + 1, header.total_frags, frag_size);
+           header.transfer_id, header.seq_num + 1, header.total_frags, frag_size);
     
     return 0;
 }
 
-// Fonction pour charger l'image depuis un fichier
-ImageToSend* load_image(const char *filename) {
+// Fonction pour charger l'image depuis un fichier, compressée si c'est utile
+ImageToSend* load_image(const char *filename, CompressionType wanted) {
     FILE *fp = fopen(filename, "rb");
     if (!fp) {
         perror("Erreur lors de l'ouverture du fichier");
@@ -97,13 +110,40 @@ ImageToSend* load_image(const char *filename) {
     fclose(fp);
     
     image->size = size;
-    image->total_frags = (size + MAX_FRAG_SIZE - 1) / MAX_FRAG_SIZE;  // Nombre de fragments
+    image->crc = crc32c(image->data, size);
+    image->compression = COMPRESSION_NONE;
+    image->original_size = size;
+    
+    // Compression avant fragmentation (ignorée pour les formats déjà compressés)
+    CompressionType type = choose_compression(image->data, size, wanted);
+    uint8_t *compressed;
+    size_t compressed_size;
+    CompressionStats stats;
+    if (type != COMPRESSION_NONE &&
+        compress_buffer(type, image->data, size, &compressed, &compressed_size, &stats) == 0) {
+        free(image->data);
+        image->data = compressed;
+        image->size = compressed_size;
+        image->compression = type;
+        print_compression_stats("Compression", &stats);
+    } else if (wanted != COMPRESSION_NONE) {
+        printf("Compression %s ignorée pour %s\n", compression_name(wanted), filename);
+    }
+    // Nombre de fragments, calculé sur les données réellement envoyées (compressées ou non)
+    image->total_frags = (image->size + MAX_FRAG_SIZE - 1) / MAX_FRAG_SIZE;
     
     return image;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     int sockfd;
+    
+    // Compression optionnelle : none (par défaut), lz4 ou zstd
+    int compression = (argc > 1) ? parse_compression(argv[1]) : COMPRESSION_NONE;
+    if (compression < 0 || !compression_supported(compression)) {
+        fprintf(stderr, "Usage: %s [none|lz4|zstd] (compression non disponible dans ce binaire)\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
     struct sockaddr_in server_addr, client_addr;
     
     // Création du socket UDP
@@ -141,7 +181,7 @@ int main() {
     printf("Client connecté, envoi de l'image...\n");
     
     // Charger l'image depuis le fichier
-    ImageToSend *image = load_image("image.png");  // Remplacer par le chemin de votre image
+    ImageToSend *image = load_image("image.png", compression);  // Remplacer par le chemin de votre image
     if (!image) {
         printf("Échec du chargement de l'image\n");
         close(sockfd);
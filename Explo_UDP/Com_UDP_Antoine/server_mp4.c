@@ -13,18 +13,14 @@
 #include <libavcodec/avcodec.h>
 #include <libswscale/swscale.h>
 
+#include "../com_udp.h"
+#include "../crc32c.h"
+
 #define PORT 12345
 #define SERVER_IP "172.14.1.16"
 #define MAX_UDP_SIZE 8192  // Taille maximale sécurisée pour UDP
-
-// Structure d'en-tête pour les fragments
-typedef struct {
-    int frame_id;      // ID de la frame
-    int fragment_id;   // ID du fragment dans la frame
-    int fragment_count; // Nombre total de fragments pour cette frame
-    int data_size;     // Taille des données dans ce fragment
-    int original_size; // Taille originale de la frame complète
-} PacketHeader;
+// En-tête le plus long envoyé : champs fixes, CRC, varints et extension IMAGE_CRC du dernier fragment
+#define HEADER_SIZE (FRAG_HEADER_BASE_MAX_SIZE + (1 + 1 + 4) + 1)
 
 int main() {
     int sockfd;
@@ -139,35 +135,45 @@ int main() {
 
             // Calculer le nombre de fragments nécessaires
             int data_size = packet->size;
-            int max_data_per_packet = MAX_UDP_SIZE - sizeof(PacketHeader);
+            int max_data_per_packet = MAX_UDP_SIZE - HEADER_SIZE;
             int num_fragments = (data_size + max_data_per_packet - 1) / max_data_per_packet;
+            uint32_t frame_crc = crc32c(packet->data, data_size);
             
             printf("Fragmentation en %d parties...\n", num_fragments); fflush(stdout);
             
             // Envoyer chaque fragment
             for (int i = 0; i < num_fragments; i++) {
-                // Préparer l'en-tête
-                PacketHeader header;
-                header.frame_id = frame_count;
-                header.fragment_id = i;
-                header.fragment_count = num_fragments;
-                header.original_size = data_size;
-                
                 // Calculer la taille de ce fragment
                 int offset = i * max_data_per_packet;
                 int fragment_size = (i == num_fragments - 1) ? 
                                     (data_size - offset) : max_data_per_packet;
-                header.data_size = fragment_size;
                 
-                // Copier l'en-tête dans le buffer
-                memcpy(fragment_buffer, &header, sizeof(PacketHeader));
+                // Préparer l'en-tête
+                FragmentHeader header = {
+                    .flags = FRAG_FLAG_CRC | ((i == num_fragments - 1) ? FRAG_FLAG_LAST : 0),
+                    .transfer_id = frame_count,
+                    .seq_num = i,
+                    .total_frags = num_fragments,
+                    .offset = offset,
+                    .total_size = data_size,
+                    .has_image_crc = (i == num_fragments - 1),
+                    .image_crc = frame_crc
+                };
+                
+                // Encoder l'en-tête dans le buffer
+                int header_len = encode_fragment_header(&header, fragment_buffer, MAX_UDP_SIZE);
+                if (header_len < 0 || header_len + fragment_size > MAX_UDP_SIZE) {
+                    fprintf(stderr, "Erreur d'encodage de l'en-tête du fragment %d\n", i);
+                    break;
+                }
                 
                 // Copier les données dans le buffer
-                memcpy(fragment_buffer + sizeof(PacketHeader), 
+                memcpy(fragment_buffer + header_len, 
                        packet->data + offset, fragment_size);
+                seal_fragment_crc(fragment_buffer, header_len + fragment_size);
                 
                 // Taille totale du paquet à envoyer
-                int total_size = sizeof(PacketHeader) + fragment_size;
+                int total_size = header_len + fragment_size;
                 
                 // Envoyer le fragment
                 if (sendto(sockfd, fragment_buffer, total_size, 0, 
@@ -5,21 +5,16 @@
 #include <arpa/inet.h>
 #include <stdint.h>
 #include <time.h>
+#include "../com_udp.h"
+#include "../crc32c.h"
+#include "../compression.h"
+
 
 #define PORT 12345  // Port d'écoute pour le serveur
 #define BUFFER_SIZE 9000  // Taille du buffer UDP (maximum par paquet)
 #define MAX_IMAGE_SIZE 10485760  // Taille maximale de l'image (10 Mo)
 #define TIMEOUT_SECONDS 10  // Timeout pour chaque fragment
 
-// Structure pour l'en-tête des fragments
-typedef struct {
-    uint32_t image_id;     // Identifiant unique de l'image
-    uint32_t seq_num;      // Numéro de séquence du fragment
-    uint32_t total_frags;  // Nombre total de fragments
-    uint32_t frag_size;    // Taille du fragment en octets
-    uint8_t is_last;       // Indique si c'est le dernier fragment
-} ImageFragmentHeader;
-
 // Structure pour stocker une image en cours de réception
 typedef struct {
     uint32_t image_id;
@@ -29,8 +24,16 @@ typedef struct {
     uint8_t *received_frags;  // Tableau de bits pour suivre les fragments reçus
     uint32_t total_frags;
     time_t last_update;
+    uint8_t has_image_crc;    // CRC de l'image reçu avec le dernier fragment
+    uint32_t image_crc;
+    uint8_t compression;      // CompressionType annoncé par l'émetteur
+    uint32_t original_size;   // Taille après décompression
 } ImageReceiver;
 
+// Compteurs d'intégrité
+uint32_t corrupted_frags = 0;   // Fragments rejetés (CRC invalide)
+uint32_t corrupted_images = 0;  // Images complètes dont le CRC ne correspond pas
+
 // Initialise la structure de réception d'image
 ImageReceiver* init_image_receiver(uint32_t image_id, uint32_t total_frags) {
     ImageReceiver *receiver = malloc(sizeof(ImageReceiver));
@@ -43,6 +46,10 @@ ImageReceiver* init_image_receiver(uint32_t image_id, uint32_t total_frags) {
     receiver->received_frags = calloc((total_frags + 7) / 8, 1);  // Bitmap pour les fragments reçus
     receiver->total_frags = total_frags;
     receiver->last_update = time(NULL);
+    receiver->has_image_crc = 0;
+    receiver->image_crc = 0;
+    receiver->compression = COMPRESSION_NONE;
+    receiver->original_size = 0;
     
     return receiver;
 }
@@ -80,6 +87,34 @@ void free_image_receiver(ImageReceiver *receiver) {
     }
 }
 
+// Remplace les données compressées de l'image par les données d'origine
+int decompress_image(ImageReceiver *receiver) {
+    if (!compression_supported(receiver->compression)) {
+        printf("Compression %u non supportée par ce serveur\n", receiver->compression);
+        return -1;
+    }
+    if (receiver->original_size > MAX_IMAGE_SIZE) {
+        printf("Taille décompressée invalide (%u octets)\n", receiver->original_size);
+        return -1;
+    }
+    
+    uint8_t *original = malloc(receiver->original_size);
+    if (!original) return -1;
+    
+    CompressionStats stats;
+    if (decompress_buffer(receiver->compression, receiver->data, receiver->total_size,
+                          original, receiver->original_size, &stats) < 0) {
+        free(original);
+        return -1;
+    }
+    print_compression_stats("Décompression", &stats);
+    
+    free(receiver->data);
+    receiver->data = original;
+    receiver->total_size = receiver->original_size;
+    return 0;
+}
+
 // Sauvegarde l'image complète dans un fichier
 void save_image(ImageReceiver *receiver, const char* filename) {
     FILE *fp = fopen(filename, "wb");
@@ -152,66 +187,88 @@ int main() {
         int n = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, 
                         (struct sockaddr *)&client_addr, &client_len);
         
-        if (n <= sizeof(ImageFragmentHeader)) {
-            printf("Paquet trop petit reçu, ignoré\n");
+        // Extraction de l'en-tête
+        FragmentHeader header;
+        int header_len = decode_fragment_header(&header, (uint8_t *)buffer, n);
+        if (header_len < 0 || n <= header_len) {
+            printf("Paquet invalide ou trop petit reçu, ignoré\n");
             continue;
         }
+        uint32_t frag_size = n - header_len;
         
-        // Extraction de l'en-tête
-        ImageFragmentHeader header;
-        memcpy(&header, buffer, sizeof(header));
+        // Vérification de l'intégrité du fragment
+        if (!check_fragment_crc((uint8_t *)buffer, n)) {
+            corrupted_frags++;
+            printf("Fragment corrompu (CRC invalide), ignoré (%u au total)\n", corrupted_frags);
+            continue;
+        }
         
         // Affichage des informations du fragment
         printf("Fragment reçu: ID=%u, Seq=%u/%u, Taille=%u\n", 
-               header.image_id, header.seq_num + 1, header.total_frags, header.frag_size);
+               header.transfer_id, header.seq_num + 1, header.total_frags, frag_size);
         
         // Initialiser un nouveau récepteur si nécessaire
-        if (!current_receiver || current_receiver->image_id != header.image_id) {
+        if (!current_receiver || current_receiver->image_id != header.transfer_id) {
             if (current_receiver) {
                 printf("Nouvelle image détectée, abandon de l'image précédente\n");
                 free_image_receiver(current_receiver);
             }
             
-            current_receiver = init_image_receiver(header.image_id, header.total_frags);
+            current_receiver = init_image_receiver(header.transfer_id, header.total_frags);
             if (!current_receiver) {
                 perror("Erreur d'allocation mémoire");
                 continue;
             }
             
             printf("Démarrage de la réception de l'image ID %u (%u fragments)\n", 
-                   header.image_id, header.total_frags);
+                   header.transfer_id, header.total_frags);
         }
         
         // Mettre à jour le timestamp
         current_receiver->last_update = time(NULL);
         
+        // Ignorer un fragment hors du bitmap alloué pour cette image
+        if (header.seq_num >= current_receiver->total_frags) {
+            printf("Numéro de fragment invalide, ignoré\n");
+            continue;
+        }
+        
         // Si ce fragment a déjà été reçu, l'ignorer
         if (is_fragment_received(current_receiver, header.seq_num)) {
             printf("Fragment déjà reçu, ignoré\n");
             continue;
         }
         
-        // Calculer l'offset pour ce fragment
-        uint32_t offset = header.seq_num * 8192;  // Basé sur MAX_FRAG_SIZE du côté émetteur
+        // L'offset du fragment est transmis dans l'en-tête
+        uint32_t offset = header.offset;
         
-        // Vérifier si l'offset est valide
-        if (offset + header.frag_size > MAX_IMAGE_SIZE) {
+        // Vérifier si l'offset est valide (valeurs lues sur le réseau : pas d'addition qui déborde)
+        if (frag_size > MAX_IMAGE_SIZE || offset > MAX_IMAGE_SIZE - frag_size ||
+            header.total_size > MAX_IMAGE_SIZE || offset + frag_size > header.total_size) {
             printf("Offset invalide, fragment ignoré\n");
             continue;
         }
         
         // Copier les données du fragment
         memcpy(current_receiver->data + offset, 
-               buffer + sizeof(header), 
-               header.frag_size);
+               buffer + header_len, 
+               frag_size);
         
         // Mettre à jour les compteurs et marquer comme reçu
-        current_receiver->received_size += header.frag_size;
+        current_receiver->received_size += frag_size;
         mark_fragment_received(current_receiver, header.seq_num);
         
         // Mettre à jour la taille totale si c'est le dernier fragment
-        if (header.is_last) {
-            current_receiver->total_size = offset + header.frag_size;
+        if (header.flags & FRAG_FLAG_LAST) {
+            current_receiver->total_size = offset + frag_size;
+        }
+        if (header.has_image_crc) {
+            current_receiver->has_image_crc = 1;
+            current_receiver->image_crc = header.image_crc;
+        }
+        if (header.compression) {
+            current_receiver->compression = header.compression;
+            current_receiver->original_size = header.original_size;
         }
         
         // Vérifier si l'image est complète
@@ -219,6 +276,26 @@ int main() {
             printf("Image complète reçue! ID=%u, Taille=%u octets\n", 
                    current_receiver->image_id, current_receiver->total_size);
             
+            // Décompression si l'émetteur a compressé l'image
+            if (current_receiver->compression && decompress_image(current_receiver) < 0) {
+                printf("Échec de la décompression de l'image ID %u, non sauvegardée\n", 
+                       current_receiver->image_id);
+                free_image_receiver(current_receiver);
+                current_receiver = NULL;
+                continue;
+            }
+            
+            // Vérification de l'intégrité de l'image reconstituée
+            if (current_receiver->has_image_crc &&
+                crc32c(current_receiver->data, current_receiver->total_size) != current_receiver->image_crc) {
+                corrupted_images++;
+                printf("Image ID %u corrompue (CRC invalide), non sauvegardée (%u au total)\n", 
+                       current_receiver->image_id, corrupted_images);
+                free_image_receiver(current_receiver);
+                current_receiver = NULL;
+                continue;
+            }
+            
             // Générer un nom de fichier unique
             sprintf(filename, "received_image_%u.jpg", current_receiver->image_id);
             
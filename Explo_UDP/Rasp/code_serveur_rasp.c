@@ -4,13 +4,16 @@
 #include <signal.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <time.h>
 
 // ====== Video4Linux ======
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <linux/videodev2.h>
 #include <errno.h>
-#include <sys/mman.h>  // Ajout de l'en-tête pour mmap
+#include "../capture_v4l2.h"
+#include "../encoder_h264.h"
+#include "../event_loop.h"
 // =========================
 
 // Test d'un serveur pouvanr gérer l'UDP et le TCP au choix en utilisant Video4Linux
@@ -19,6 +22,8 @@
 #define PORT_UDP 12345
 #define BUFFER_SIZE 1024
 #define VIDEO_FILE "IMG_5362.mp4"
+#define NB_FRAMES 100              // Frames envoyées par flux
+#define STATS_INTERVAL_MS 1000     // Période du bilan dans le journal
 
 void communicationUDP();
 void communicationTCP();
@@ -26,8 +31,6 @@ void envoyerVideoUDP(FILE* video);
 void envoyerFluxVideoUDP();
 
 // Déclaration des variables globales
-struct buffer *buffers;
-unsigned int n_buffers = 0;
 static int sockfd;
 static int server_fd;
 static char buffer[BUFFER_SIZE];
@@ -35,12 +38,6 @@ static struct sockaddr_in clientAddr;
 static socklen_t addr_size;
 volatile int serveurActif = 1;  // Indique si le serveur doit continuer à tourner
 
-// Structure pour stocker les buffers mmap
-struct buffer {
-    void* start;
-    size_t length;
-};
-
 // Tableau de pointeurs de fonctions
 void (*choixCommunicationServeur[])() = {communicationUDP, communicationTCP};
 
@@ -177,30 +174,106 @@ void envoyerVideoUDP(FILE* video) {
 
 /*------------------------------------------------------------------------------------------*/
 
-// Fonction pour lancer FFmpeg en utilisant la commande donnée
-void lancerFFmpeg() {
-    char command[256];
-    
-    // Crée la commande pour lancer FFmpeg
-    snprintf(command, sizeof(command),
-             "ffmpeg -f rawvideo -pix_fmt yuyv422 -s 640x480 -i - -c:v libx264 -f mpegts udp://192.168.1.1:12345");
-    
-    // Exécute la commande FFmpeg
-    if (system(command) == -1) {
-        perror("Erreur lors du lancement de FFmpeg");
+// État du flux partagé par les callbacks de la boucle d'événements
+typedef struct {
+    CaptureDevice *dev;
+    H264Encoder *encoder;
+    EventLoop *loop;
+    FILE *log;
+    int frames;                // Frames encodées et envoyées
+    uint64_t captured;         // Frames sorties du driver
+    uint64_t dropped;          // Frames remplacées par une plus récente avant l'encodage
+    int frames_periode;        // Frames envoyées depuis le dernier bilan
+    double glass_to_wire_total_ms;
+    double glass_to_wire_max_ms;
+} FluxVideo;
+
+// Caméra prête : seule la frame la plus récente est encodée, les autres sont rendues au driver
+static void surFrame(int fd, uint32_t events, void *opaque) {
+    FluxVideo *flux = (FluxVideo *)opaque;
+    CaptureBuffer *derniere = NULL;
+    CaptureBuffer *frame;
+
+    while ((frame = capture_acquire(flux->dev)) != NULL) {
+        flux->captured++;
+        if (derniere) {
+            capture_release(flux->dev, derniere);
+            flux->dropped++;
+        }
+        derniere = frame;
     }
+    if (errno != EAGAIN) {
+        fprintf(flux->log, "ERREUR: Impossible de déqueue le buffer, errno: %d (%s)\n", errno, strerror(errno));
+        if (derniere) capture_release(flux->dev, derniere);
+        event_loop_stop(flux->loop);
+        return;
+    }
+    if (derniere == NULL) return;
+
+    // L'encodeur lit la frame dans le buffer du driver et la rend quand il a fini
+    uint32_t bytesused = derniere->bytesused;
+    double captured_ms = capture_frame_time_ms(derniere);
+    if (encoder_encode(flux->encoder, derniere) == -1) {
+        fprintf(flux->log, "ERREUR: Échec de l'encodage de la frame %d\n", flux->frames + 1);
+        event_loop_stop(flux->loop);
+        return;
+    }
+    double glass_to_wire_ms = capture_now_ms() - captured_ms;
+    flux->glass_to_wire_total_ms += glass_to_wire_ms;
+    if (glass_to_wire_ms > flux->glass_to_wire_max_ms) flux->glass_to_wire_max_ms = glass_to_wire_ms;
+    flux->frames++;
+    flux->frames_periode++;
+
+    const EncoderStats *stats = encoder_stats(flux->encoder);
+    fprintf(flux->log, "Frame %d envoyée, taille: %u bytes, encodage: %.2f ms, H.264: %d octets, "
+            "glass-to-wire: %.2f ms\n", flux->frames, bytesused, stats->last_ms, stats->last_size,
+            glass_to_wire_ms);
+
+    if (flux->frames >= NB_FRAMES) event_loop_stop(flux->loop);
 }
 
-/*------------------------------------------------------------------------------------------*/
+// Commandes du client sur la socket UDP pendant le flux ("STOP" arrête le flux)
+static void surCommande(int fd, uint32_t events, void *opaque) {
+    FluxVideo *flux = (FluxVideo *)opaque;
+    char commande[BUFFER_SIZE];
+    ssize_t n;
+
+    while ((n = recvfrom(fd, commande, sizeof(commande) - 1, MSG_DONTWAIT, NULL, NULL)) > 0) {
+        commande[n] = '\0';
+        fprintf(flux->log, "Commande reçue pendant le flux: %s\n", commande);
+        if (strncmp(commande, "STOP", 4) == 0) event_loop_stop(flux->loop);
+    }
+}
+
+// Entrée standard : 'q' arrête le flux
+static void surClavier(int fd, uint32_t events, void *opaque) {
+    FluxVideo *flux = (FluxVideo *)opaque;
+    char ligne[64];
+    ssize_t n = read(fd, ligne, sizeof(ligne));
+    if (n <= 0 || ligne[0] == 'q') {
+        // Fin de l'entrée standard : plus rien à lire, elle sort de la boucle
+        event_loop_remove(flux->loop, fd);
+        if (n > 0) event_loop_stop(flux->loop);
+    }
+}
+
+// Bilan périodique dans le journal
+static void surTimer(int fd, uint32_t events, void *opaque) {
+    FluxVideo *flux = (FluxVideo *)opaque;
+    fprintf(flux->log, "Bilan: %.1f fps, %llu capturées, %llu remplacées, %llu réveils de la boucle\n",
+            flux->frames_periode * 1000.0 / STATS_INTERVAL_MS, (unsigned long long)flux->captured,
+            (unsigned long long)flux->dropped, (unsigned long long)flux->loop->wakeups);
+    flux->frames_periode = 0;
+    fflush(flux->log);
+}
 
-// Fonction pour envoyer un flux vidéo via UDP en utilisant la webcam et l'encodage H.264
+// Fonction pour envoyer un flux vidéo via UDP en utilisant la webcam et l'encodage H.264.
+// Un seul thread : la caméra (non bloquante), la socket de commande, le clavier et le
+// timer de bilan sont servis par la même boucle epoll.
 void envoyerFluxVideoUDP() {
-    int fd;
-    struct v4l2_format fmt;
-    struct v4l2_requestbuffers req;
-    struct v4l2_buffer buf;
-    enum v4l2_buf_type type;
-    FILE *ffmpeg_pipe = NULL;
+    CaptureDevice dev;
+    EventLoop loop;
+    H264Encoder *encoder = NULL;
 
     // Journal de débogage complet
     FILE *debug_log = fopen("/tmp/video_streaming_debug.log", "w");
@@ -216,10 +289,9 @@ void envoyerFluxVideoUDP() {
     t = localtime(&now);
     fprintf(debug_log, "Début de la capture vidéo: %s\n", asctime(t));
 
-    // Ouvrir la webcam avec des informations détaillées
-    fd = open("/dev/video0", O_RDWR);
-    if (fd == -1) {
-        fprintf(debug_log, "ERREUR CRITIQUE: Impossible d'ouvrir /dev/video0\n");
+    // Ouvrir la webcam, configurer le format et mapper les buffers (exportés en DMABUF si possible)
+    if (capture_open(&dev, "/dev/video0", 640, 480, V4L2_PIX_FMT_YUYV, 4) == -1) {
+        fprintf(debug_log, "ERREUR CRITIQUE: Impossible d'initialiser la capture sur /dev/video0\n");
         fprintf(debug_log, "Détails errno: %d (%s)\n", errno, strerror(errno));
         
         // Lister les périphériques vidéo disponibles
@@ -228,144 +300,56 @@ void envoyerFluxVideoUDP() {
         fclose(debug_log);
         return;
     }
-    fprintf(debug_log, "✓ Webcam /dev/video0 ouverte avec succès\n");
-
-    // Vérification détaillée des capacités
-    struct v4l2_capability cap;
-    if (ioctl(fd, VIDIOC_QUERYCAP, &cap) == -1) {
-        fprintf(debug_log, "ERREUR: Impossible de vérifier les capacités\n");
-        fprintf(debug_log, "Détails errno: %d (%s)\n", errno, strerror(errno));
-        
-        close(fd);
-        fclose(debug_log);
-        return;
-    }
-
-    // Configuration du format vidéo
-    memset(&fmt, 0, sizeof(fmt));
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = 640;
-    fmt.fmt.pix.height = 480;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-    fmt.fmt.pix.field = V4L2_FIELD_NONE;
-
-    if (ioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
-        fprintf(debug_log, "ERREUR: Configuration du format impossible\n");
-        fprintf(debug_log, "Détails errno: %d (%s)\n", errno, strerror(errno));
-        
-        close(fd);
-        fclose(debug_log);
-        return;
-    }
-
-    // Demande de buffers
-    memset(&req, 0, sizeof(req));
-    req.count = 4;
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-
-    if (ioctl(fd, VIDIOC_REQBUFS, &req) == -1) {
-        fprintf(debug_log, "ERREUR: Impossible de demander les buffers\n");
-        fprintf(debug_log, "Détails errno: %d (%s)\n", errno, strerror(errno));
-        
-        close(fd);
-        fclose(debug_log);
-        return;
-    }
-
-    // Allocation et mappage des buffers
-    buffers = calloc(req.count, sizeof(*buffers));
-    if (!buffers) {
-        fprintf(debug_log, "ERREUR: Allocation mémoire impossible\n");
-        close(fd);
-        fclose(debug_log);
-        return;
-    }
-
-    for (n_buffers = 0; n_buffers < req.count; ++n_buffers) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = n_buffers;
-
-        if (ioctl(fd, VIDIOC_QUERYBUF, &buf) == -1) {
-            fprintf(debug_log, "ERREUR: Impossible de requêter le buffer %d\n", n_buffers);
-            fprintf(debug_log, "Détails errno: %d (%s)\n", errno, strerror(errno));
-            goto cleanup;
-        }
-
-        buffers[n_buffers].length = buf.length;
-        buffers[n_buffers].start = mmap(NULL, buf.length, 
-                                        PROT_READ | PROT_WRITE, 
-                                        MAP_SHARED, fd, buf.m.offset);
-
-        if (buffers[n_buffers].start == MAP_FAILED) {
-            fprintf(debug_log, "ERREUR: Mappage mémoire impossible pour le buffer %d\n", n_buffers);
-            fprintf(debug_log, "Détails errno: %d (%s)\n", errno, strerror(errno));
-            goto cleanup;
-        }
-
-        if (ioctl(fd, VIDIOC_QBUF, &buf) == -1) {
-            fprintf(debug_log, "ERREUR: Impossible de mettre le buffer %d en file d'attente\n", n_buffers);
-            fprintf(debug_log, "Détails errno: %d (%s)\n", errno, strerror(errno));
-            goto cleanup;
-        }
-    }
+    fprintf(debug_log, "✓ Webcam /dev/video0 ouverte avec succès (%u buffers, DMABUF: %s)\n",
+            dev.n_buffers, dev.buffers[0].dmabuf_fd >= 0 ? "oui" : "non");
 
     // Démarrage du streaming
-    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(fd, VIDIOC_STREAMON, &type) == -1) {
+    if (capture_start(&dev) == -1) {
         fprintf(debug_log, "ERREUR: Impossible de démarrer le streaming\n");
         fprintf(debug_log, "Détails errno: %d (%s)\n", errno, strerror(errno));
         goto cleanup;
     }
 
-    // Préparation du pipe FFmpeg
-    ffmpeg_pipe = popen(
-        "ffmpeg -f rawvideo -pix_fmt yuyv422 -s 640x480 -i - "
-        "-c:v libx264 -f mpegts udp://192.168.1.1:12345", "w"
-    );
-    
-    if (!ffmpeg_pipe) {
-        fprintf(debug_log, "ERREUR: Impossible de créer le pipe FFmpeg\n");
+    // Encodeur H.264 dans le processus (MPEG-TS sur UDP, comme l'ancienne commande ffmpeg)
+    encoder = encoder_open(&dev, 25, 2000000, "udp://192.168.1.1:12345");
+    if (!encoder) {
+        fprintf(debug_log, "ERREUR: Impossible d'initialiser l'encodeur H.264\n");
         goto cleanup;
     }
+    fprintf(debug_log, "✓ Encodeur %s initialisé\n", encoder_name(encoder));
 
-    // Capture et envoi des frames
-    for (int i = 0; i < 100; i++) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-
-        if (ioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
-            fprintf(debug_log, "ERREUR: Impossible de déqueue le buffer\n");
-            fprintf(debug_log, "Frame %d, Détails errno: %d (%s)\n", i, errno, strerror(errno));
-            break;
-        }
-
-        fwrite(buffers[buf.index].start, 1, buf.bytesused, ffmpeg_pipe);
-        fprintf(debug_log, "Frame %d envoyée, taille: %d bytes\n", i + 1, buf.bytesused);
-
-        if (ioctl(fd, VIDIOC_QBUF, &buf) == -1) {
-            fprintf(debug_log, "ERREUR: Impossible de requeue le buffer\n");
-            break;
-        }
+    // Boucle d'événements : capture et envoi des frames, commandes et bilan
+    if (event_loop_init(&loop) == -1) {
+        fprintf(debug_log, "ERREUR: Impossible de créer la boucle d'événements\n");
+        goto cleanup;
     }
-
-cleanup:
-    // Libération des ressources
-    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    ioctl(fd, VIDIOC_STREAMOFF, &type);
-
-    for (unsigned int i = 0; i < n_buffers; ++i) {
-        if (buffers[i].start != MAP_FAILED && buffers[i].start != NULL) {
-            munmap(buffers[i].start, buffers[i].length);
-        }
+    FluxVideo flux = { .dev = &dev, .encoder = encoder, .loop = &loop, .log = debug_log };
+    if (event_loop_add(&loop, dev.fd, EPOLLIN, surFrame, &flux) == -1 ||
+        event_loop_add(&loop, sockfd, EPOLLIN, surCommande, &flux) == -1 ||
+        event_loop_add(&loop, STDIN_FILENO, EPOLLIN, surClavier, &flux) == -1 ||
+        event_loop_add_timer(&loop, STATS_INTERVAL_MS, surTimer, &flux) == -1) {
+        fprintf(debug_log, "ERREUR: Impossible de configurer la boucle d'événements\n");
+        event_loop_close(&loop);
+        goto cleanup;
+    }
+    event_loop_run(&loop);
+    event_loop_close(&loop);
+
+    fprintf(debug_log, "Frames capturées: %llu, remplacées: %llu, glass-to-wire moyen: %.2f ms (max %.2f ms)\n",
+            (unsigned long long)flux.captured, (unsigned long long)flux.dropped,
+            flux.frames ? flux.glass_to_wire_total_ms / flux.frames : 0.0,
+            flux.glass_to_wire_max_ms);
+
+    if (encoder_stats(encoder)->frames > 0) {
+        const EncoderStats *stats = encoder_stats(encoder);
+        fprintf(debug_log, "Encodage moyen: %.2f ms, max: %.2f ms\n",
+                stats->total_ms / stats->frames, stats->max_ms);
     }
-    free(buffers);
 
-    if (ffmpeg_pipe) pclose(ffmpeg_pipe);
-    close(fd);
+cleanup:
+    // Libération des ressources (l'encodeur rend ses dernières frames avant la fermeture de la capture)
+    encoder_close(encoder);
+    capture_close(&dev);
 
     // Fin du log
     time(&now);
@@ -0,0 +1,350 @@
+#define _GNU_SOURCE  // pthread_setaffinity_np, sendmmsg
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+// ====== Video4Linux ======
+#include <linux/videodev2.h>
+#include "../capture_v4l2.h"
+#include "../event_loop.h"
+#include "../com_udp.h"
+#include "../crc32c.h"
+// =========================
+
+// Serveur multi-caméras : chaque caméra configurée est capturée par son propre
+// thread (une boucle d'événements, épinglé sur un cœur) et ses frames partent telles
+// que capturées sur une socket UDP commune. Sans format imposé, le MJPEG natif est
+// choisi quand la caméra le propose (frames compressées, aucun encodage), sinon YUYV. L'extension STREAM_ID de
+// l'en-tête indique la caméra, le récepteur sépare les flux avec.
+//
+// Usage : serveur_multicam [-d ip:port] [périphérique[:LxH[:FMT[:fps]]] ...]
+//   ex.   serveur_multicam -d 192.168.1.1:12345 /dev/video0:1280x720:MJPG:30 /dev/video2:640x480:YUYV:15
+
+#define MAX_CAMERAS 8
+#define NUM_BUFFERS 4
+#define DEFAULT_DEST_IP "192.168.1.1"
+#define DEFAULT_DEST_PORT 12345
+#define DEFAULT_WIDTH 640
+#define DEFAULT_HEIGHT 480
+#define DEFAULT_FPS 30
+#define CHUNK_SIZE 1400         // Taille d'un datagramme (pas de fragmentation IP)
+#define HEADER_SIZE (FRAG_HEADER_BASE_MAX_SIZE + (1 + 1 + 4) + (1 + 1 + 8) + (1 + 1 + 1) + 1)  // CRC image + date + flux
+#define DATA_SIZE (CHUNK_SIZE - HEADER_SIZE)
+#define SEND_BATCH 32           // Datagrammes envoyés par appel à sendmmsg
+#define STATS_INTERVAL_MS 1000
+
+typedef struct {
+    // Configuration
+    const char *path;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixelformat;
+    unsigned int fps;
+    uint8_t stream_id;
+    int core;
+
+    // Exécution
+    CaptureDevice dev;
+    EventLoop loop;
+    pthread_t thread;
+    uint64_t frames;           // Frames envoyées
+    uint64_t bytes;
+    uint64_t dropped;          // Frames remplacées par une plus récente avant l'envoi
+    uint64_t errors;
+    uint64_t frames_periode;
+} Camera;
+
+static Camera cameras[MAX_CAMERAS];
+static int nb_cameras;
+static int sockfd = -1;
+static struct sockaddr_in dest;
+static int stop_fd = -1;  // eventfd partagé : lisible quand le serveur doit s'arrêter
+
+// "périphérique[:LxH[:FMT[:fps]]]", les champs absents gardent leur valeur par défaut
+// (format 0 : choisi à l'ouverture)
+static int parse_camera(char *spec, Camera *cam) {
+    cam->path = spec;
+    cam->width = DEFAULT_WIDTH;
+    cam->height = DEFAULT_HEIGHT;
+    cam->pixelformat = 0;
+    cam->fps = DEFAULT_FPS;
+
+    char *field = strchr(spec, ':');
+    if (field == NULL) return 0;
+    *field++ = '\0';
+
+    char *next = strchr(field, ':');
+    if (next) *next++ = '\0';
+    if (*field && sscanf(field, "%ux%u", &cam->width, &cam->height) != 2) return -1;
+    if (next == NULL) return 0;
+
+    field = next;
+    next = strchr(field, ':');
+    if (next) *next++ = '\0';
+    if (*field) {
+        if (strlen(field) != 4) return -1;
+        cam->pixelformat = v4l2_fourcc(field[0], field[1], field[2], field[3]);
+    }
+    if (next && *next && sscanf(next, "%u", &cam->fps) != 1) return -1;
+    return 0;
+}
+
+// Envoie une frame en datagrammes (en-tête + données pointant dans le buffer du driver)
+static int envoyer_frame(Camera *cam, const CaptureBuffer *frame) {
+    struct mmsghdr messages[SEND_BATCH];
+    struct iovec iovs[SEND_BATCH][2];
+    uint8_t headers[SEND_BATCH][HEADER_SIZE];
+    uint32_t size = frame->bytesused;
+    uint32_t total_frags = (size + DATA_SIZE - 1) / DATA_SIZE;
+    uint64_t capture_us = capture_epoch_us(capture_frame_time_ms(frame));
+    uint32_t frame_crc = crc32c(frame->start, size);
+
+    uint32_t offset = 0;
+    while (offset < size) {
+        int n = 0;
+        while (n < SEND_BATCH && offset < size) {
+            uint32_t len = size - offset > DATA_SIZE ? DATA_SIZE : size - offset;
+            int last = offset + len == size;
+            FragmentHeader header = {
+                .flags = FRAG_FLAG_CRC | (last ? FRAG_FLAG_LAST : 0),
+                .transfer_id = frame->sequence,
+                .seq_num = offset / DATA_SIZE,
+                .total_frags = total_frags,
+                .offset = offset,
+                .total_size = size,
+                .has_image_crc = last,
+                .image_crc = frame_crc,
+                .has_capture_time = 1,
+                .capture_time_us = capture_us,
+                .has_stream_id = 1,
+                .stream_id = cam->stream_id
+            };
+            int header_len = encode_fragment_header(&header, headers[n], HEADER_SIZE);
+            if (header_len < 0) return -1;
+            // Les données restent dans le buffer du driver : le CRC couvre les deux iovecs
+            seal_fragment_crc_split(headers[n], header_len, (const uint8_t *)frame->start + offset, len);
+
+            iovs[n][0].iov_base = headers[n];
+            iovs[n][0].iov_len = header_len;
+            iovs[n][1].iov_base = (uint8_t *)frame->start + offset;
+            iovs[n][1].iov_len = len;
+            memset(&messages[n], 0, sizeof(messages[n]));
+            messages[n].msg_hdr.msg_name = &dest;
+            messages[n].msg_hdr.msg_namelen = sizeof(dest);
+            messages[n].msg_hdr.msg_iov = iovs[n];
+            messages[n].msg_hdr.msg_iovlen = 2;
+            offset += len;
+            n++;
+        }
+
+        // La socket est partagée : chaque datagramme part en entier, sans verrou
+        int sent = 0;
+        while (sent < n) {
+            int ret = sendmmsg(sockfd, messages + sent, n - sent, 0);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                perror("Erreur envoi vidéo");
+                return -1;
+            }
+            sent += ret;
+        }
+    }
+    return 0;
+}
+
+// Caméra prête : seule la frame la plus récente est envoyée
+static void sur_frame(int fd, uint32_t events, void *opaque) {
+    Camera *cam = (Camera *)opaque;
+    CaptureBuffer *latest = NULL;
+    CaptureBuffer *frame;
+
+    while ((frame = capture_acquire(&cam->dev)) != NULL) {
+        if (latest) {
+            capture_release(&cam->dev, latest);
+            cam->dropped++;
+        }
+        latest = frame;
+    }
+    if (errno != EAGAIN) {
+        printf("Caméra %u (%s) : erreur de capture, arrêt du flux\n", cam->stream_id, cam->path);
+        if (latest) capture_release(&cam->dev, latest);
+        event_loop_stop(&cam->loop);
+        return;
+    }
+    if (latest == NULL) return;
+
+    if (envoyer_frame(cam, latest) == 0) {
+        cam->frames++;
+        cam->frames_periode++;
+        cam->bytes += latest->bytesused;
+    } else {
+        cam->errors++;
+    }
+    capture_release(&cam->dev, latest);
+}
+
+static void sur_arret(int fd, uint32_t events, void *opaque) {
+    Camera *cam = (Camera *)opaque;
+    event_loop_stop(&cam->loop);
+}
+
+static void sur_timer(int fd, uint32_t events, void *opaque) {
+    Camera *cam = (Camera *)opaque;
+    printf("Caméra %u: %.1f fps, %llu envoyées, %llu remplacées\n", cam->stream_id,
+           cam->frames_periode * 1000.0 / STATS_INTERVAL_MS, (unsigned long long)cam->frames,
+           (unsigned long long)cam->dropped);
+    cam->frames_periode = 0;
+}
+
+// Thread d'une caméra, épinglé sur son cœur
+static void *camera_thread(void *arg) {
+    Camera *cam = (Camera *)arg;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cam->core, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        printf("Caméra %u : impossible d'épingler le thread sur le cœur %d\n", cam->stream_id, cam->core);
+    }
+
+    if (event_loop_init(&cam->loop) == -1) return NULL;
+    if (event_loop_add(&cam->loop, cam->dev.fd, EPOLLIN, sur_frame, cam) == 0 &&
+        event_loop_add(&cam->loop, stop_fd, EPOLLIN, sur_arret, cam) == 0 &&
+        event_loop_add_timer(&cam->loop, STATS_INTERVAL_MS, sur_timer, cam) != -1) {
+        event_loop_run(&cam->loop);
+    }
+    event_loop_close(&cam->loop);
+    return NULL;
+}
+
+static void arreter_serveur(int sig) {
+    // Réveille toutes les boucles ; personne ne lit l'eventfd, il reste lisible
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) < 0) _exit(1);
+}
+
+static int parse_dest(const char *arg) {
+    char ip[64];
+    int port;
+    if (sscanf(arg, "%63[^:]:%d", ip, &port) != 2 || port <= 0 || port > 65535) return -1;
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(port);
+    return inet_pton(AF_INET, ip, &dest.sin_addr) == 1 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(DEFAULT_DEST_PORT);
+    dest.sin_addr.s_addr = inet_addr(DEFAULT_DEST_IP);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:")) != -1) {
+        if (opt != 'd' || parse_dest(optarg) == -1) {
+            printf("Usage: %s [-d ip:port] [périphérique[:LxH[:FMT[:fps]]] ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Caméras configurées (par défaut /dev/video0)
+    static char default_camera[] = "/dev/video0";
+    char **specs = argv + optind;
+    int nb_specs = argc - optind;
+    char *default_specs[] = { default_camera };
+    if (nb_specs == 0) {
+        specs = default_specs;
+        nb_specs = 1;
+    }
+    if (nb_specs > MAX_CAMERAS) {
+        printf("Au plus %d caméras\n", MAX_CAMERAS);
+        return 1;
+    }
+
+    int ret = 1;
+    long nb_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nb_cores < 1) nb_cores = 1;
+
+    for (int i = 0; i < nb_specs; i++) {
+        Camera *cam = &cameras[nb_cameras];
+        if (parse_camera(specs[i], cam) == -1) {
+            printf("Configuration de caméra invalide: %s\n", specs[i]);
+            goto cleanup;
+        }
+        cam->stream_id = i;
+        cam->core = i % nb_cores;
+
+        // Négociation : format (ENUM_FMT), résolution (S_FMT) puis cadence (S_PARM)
+        if (cam->pixelformat == 0) {
+            cam->pixelformat = capture_probe_format(cam->path, V4L2_PIX_FMT_MJPEG) == 1 ?
+                               V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV;
+        }
+        if (capture_open(&cam->dev, cam->path, cam->width, cam->height, cam->pixelformat, NUM_BUFFERS) == -1) {
+            printf("Caméra %s ignorée\n", cam->path);
+            continue;
+        }
+        if (capture_set_fps(&cam->dev, cam->fps) == -1) {
+            printf("Caméra %s : cadence par défaut du driver\n", cam->path);
+        }
+        printf("Caméra %u: %s %ux%u %.4s %.1f fps, cœur %d\n", cam->stream_id, cam->path,
+               cam->dev.width, cam->dev.height, (const char *)&cam->dev.pixelformat, cam->dev.fps,
+               cam->core);
+        nb_cameras++;
+    }
+    if (nb_cameras == 0) {
+        printf("Aucune caméra disponible\n");
+        return 1;
+    }
+
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (sockfd < 0 || stop_fd < 0) {
+        perror("Erreur de création de la socket");
+        goto cleanup;
+    }
+    // File d'émission assez grande pour les lots de toutes les caméras
+    int sndbuf = 4 * 1024 * 1024;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
+        perror("Erreur de configuration du buffer d'émission");
+    }
+    signal(SIGINT, arreter_serveur);
+
+    int started = 0;
+    for (int i = 0; i < nb_cameras; i++) {
+        if (capture_start(&cameras[i].dev) == -1 ||
+            pthread_create(&cameras[i].thread, NULL, camera_thread, &cameras[i]) != 0) {
+            printf("Impossible de démarrer la caméra %s\n", cameras[i].path);
+            arreter_serveur(0);
+            break;
+        }
+        started++;
+    }
+    printf("%d caméra(s) -> %s:%d, Ctrl+C pour arrêter\n", started,
+           inet_ntoa(dest.sin_addr), ntohs(dest.sin_port));
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(cameras[i].thread, NULL);
+    }
+
+    for (int i = 0; i < nb_cameras; i++) {
+        Camera *cam = &cameras[i];
+        printf("Caméra %u (%s): %llu frames, %.1f Mo, %llu remplacées, %llu erreurs d'envoi\n",
+               cam->stream_id, cam->path, (unsigned long long)cam->frames, cam->bytes / 1e6,
+               (unsigned long long)cam->dropped, (unsigned long long)cam->errors);
+    }
+    ret = 0;
+
+cleanup:
+    for (int i = 0; i < nb_cameras; i++) {
+        capture_close(&cameras[i].dev);
+    }
+    if (sockfd >= 0) close(sockfd);
+    if (stop_fd >= 0) close(stop_fd);
+    return ret;
+}
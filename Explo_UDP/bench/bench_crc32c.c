@@ -0,0 +1,71 @@
+/* bench_crc32c.c - Mesure du coût du CRC32C (Go/s) selon la taille des buffers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../crc32c.h"
+
+#define TOTAL_BYTES (1ULL << 30)  // Volume traité par mesure (1 Go)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Traite TOTAL_BYTES octets par blocs de block_size, retourne le débit en Go/s.
+// Chaque bloc prolonge le CRC du précédent : le résultat dépend de tous les calculs.
+static double measure(uint32_t (*fn)(uint32_t, const void *, size_t),
+                      const uint8_t *data, size_t block_size, uint32_t *result) {
+    size_t iterations = TOTAL_BYTES / block_size;
+    uint32_t crc = 0;
+    double start = now_sec();
+    for (size_t i = 0; i < iterations; i++) {
+        crc = fn(crc, data, block_size);
+    }
+    double elapsed = now_sec() - start;
+    *result = crc;
+    return (double)iterations * block_size / elapsed / 1e9;
+}
+
+int main(void) {
+    // Tailles typiques : petit paquet, fragment de 8 Ko, image JPEG, frame YUYV 640x480
+    const size_t sizes[] = {64, 1024, 8192, 65536, 614400};
+    const size_t max_size = 614400;
+
+    uint8_t *data = malloc(max_size);
+    if (!data) {
+        perror("Erreur d'allocation mémoire");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < max_size; i++) data[i] = (uint8_t)rand();
+
+    // Vérification : les deux implémentations doivent donner le même résultat
+    if (crc32c("123456789", 9) != 0xE3069283 ||
+        crc32c_update(0, data, max_size) != crc32c_update_sw(0, data, max_size)) {
+        printf("Erreur: résultats CRC32C incohérents\n");
+        free(data);
+        return EXIT_FAILURE;
+    }
+
+    printf("Implémentation matérielle: %s\n", crc32c_impl_name());
+    printf("%10s %14s %14s\n", "Taille", "Choisie Go/s", "Tables Go/s");
+
+    uint32_t sink = 0;
+    int mismatch = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t hw_crc, sw_crc;
+        double hw = measure(crc32c_update, data, sizes[i], &hw_crc);
+        double sw = measure(crc32c_update_sw, data, sizes[i], &sw_crc);
+        printf("%10zu %14.2f %14.2f\n", sizes[i], hw, sw);
+        if (hw_crc != sw_crc) mismatch = 1;
+        sink ^= hw_crc;
+    }
+
+    // Affiché pour empêcher le compilateur d'éliminer les calculs
+    printf("Contrôle: %08x%s\n", sink, mismatch ? " (résultats différents !)" : "");
+
+    free(data);
+    return mismatch ? EXIT_FAILURE : 0;
+}
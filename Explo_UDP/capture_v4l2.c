@@ -0,0 +1,331 @@
+#include "capture_v4l2.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+// ioctl relancé s'il est interrompu par un signal
+static int xioctl(int fd, unsigned long request, void *arg) {
+    int ret;
+    do {
+        ret = ioctl(fd, request, arg);
+    } while (ret == -1 && errno == EINTR);
+    return ret;
+}
+
+static int queue_buffer(CaptureDevice *dev, CaptureBuffer *buffer) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = buffer->index;
+
+    if (xioctl(dev->fd, VIDIOC_QBUF, &buf) == -1) {
+        perror("Erreur de remise en file d'attente du buffer");
+        return -1;
+    }
+    return 0;
+}
+
+// Vérifie que le driver propose le format (VIDIOC_ENUM_FMT)
+static int has_format(int fd, uint32_t pixelformat) {
+    struct v4l2_fmtdesc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    for (desc.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &desc) == 0; desc.index++) {
+        if (desc.pixelformat == pixelformat) return 1;
+    }
+    // Driver qui n'énumère rien : le format est laissé à VIDIOC_S_FMT
+    return desc.index == 0;
+}
+
+// Comme has_format, en listant les formats proposés si celui demandé est absent
+static int format_supported(int fd, uint32_t pixelformat) {
+    if (has_format(fd, pixelformat)) return 1;
+
+    struct v4l2_fmtdesc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    printf("Format %.4s non proposé, formats disponibles :\n", (const char *)&pixelformat);
+    for (desc.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &desc) == 0; desc.index++) {
+        printf("  %.4s (%s)\n", (const char *)&desc.pixelformat, desc.description);
+    }
+    return 0;
+}
+
+double capture_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+double capture_frame_time_ms(const CaptureBuffer *buffer) {
+    // Timestamp du driver sur CLOCK_MONOTONIC : date réelle de capture
+    if ((buffer->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        return buffer->timestamp.tv_sec * 1000.0 + buffer->timestamp.tv_usec / 1e3;
+    }
+    // Sinon, date de sortie de la file du driver
+    return buffer->dequeue_ms;
+}
+
+uint64_t capture_epoch_us(double monotonic_ms) {
+    // Écart entre les deux horloges mesuré maintenant : l'âge de la frame est conservé
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    double realtime_us = ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+    return (uint64_t)(realtime_us - (capture_now_ms() - monotonic_ms) * 1000.0);
+}
+
+int capture_open(CaptureDevice *dev, const char *path, uint32_t width, uint32_t height,
+                 uint32_t pixelformat, unsigned int n_buffers) {
+    memset(dev, 0, sizeof(*dev));
+    pthread_mutex_init(&dev->lock, NULL);
+    for (int i = 0; i < CAPTURE_MAX_BUFFERS; i++) {
+        dev->buffers[i].dmabuf_fd = -1;
+    }
+
+    dev->fd = open(path, O_RDWR | O_NONBLOCK);
+    if (dev->fd == -1) {
+        perror("Erreur d'ouverture du périphérique");
+        pthread_mutex_destroy(&dev->lock);  // capture_close() ignore un périphérique non ouvert
+        return -1;
+    }
+
+    if (!format_supported(dev->fd, pixelformat)) {
+        capture_close(dev);
+        return -1;
+    }
+
+    // Configuration du format
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = width;
+    fmt.fmt.pix.height = height;
+    fmt.fmt.pix.pixelformat = pixelformat;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+
+    if (xioctl(dev->fd, VIDIOC_S_FMT, &fmt) == -1) {
+        perror("Erreur de configuration du format");
+        capture_close(dev);
+        return -1;
+    }
+    dev->width = fmt.fmt.pix.width;
+    dev->height = fmt.fmt.pix.height;
+    dev->pixelformat = fmt.fmt.pix.pixelformat;
+    dev->bytesperline = fmt.fmt.pix.bytesperline;
+    dev->sizeimage = fmt.fmt.pix.sizeimage;
+
+    // Demande de buffers
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = n_buffers > CAPTURE_MAX_BUFFERS ? CAPTURE_MAX_BUFFERS : n_buffers;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(dev->fd, VIDIOC_REQBUFS, &req) == -1 || req.count == 0) {
+        perror("Erreur de demande de buffers");
+        capture_close(dev);
+        return -1;
+    }
+    if (req.count > CAPTURE_MAX_BUFFERS) req.count = CAPTURE_MAX_BUFFERS;
+
+    int dmabuf_supported = 1;
+    for (dev->n_buffers = 0; dev->n_buffers < req.count; dev->n_buffers++) {
+        CaptureBuffer *buffer = &dev->buffers[dev->n_buffers];
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = dev->n_buffers;
+
+        if (xioctl(dev->fd, VIDIOC_QUERYBUF, &buf) == -1) {
+            perror("Erreur de requête de buffer");
+            capture_close(dev);
+            return -1;
+        }
+
+        buffer->index = buf.index;
+        buffer->length = buf.length;
+        buffer->start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, dev->fd, buf.m.offset);
+        if (buffer->start == MAP_FAILED) {
+            buffer->start = NULL;
+            perror("Erreur de mappage de buffer");
+            capture_close(dev);
+            return -1;
+        }
+
+        // Export DMABUF pour un encodeur matériel ou un autre périphérique
+        if (dmabuf_supported) {
+            struct v4l2_exportbuffer expbuf;
+            memset(&expbuf, 0, sizeof(expbuf));
+            expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            expbuf.index = buf.index;
+            expbuf.flags = O_RDONLY | O_CLOEXEC;
+            if (xioctl(dev->fd, VIDIOC_EXPBUF, &expbuf) == 0) {
+                buffer->dmabuf_fd = expbuf.fd;
+            } else {
+                dmabuf_supported = 0;
+                printf("Export DMABUF non supporté par le driver, mappage mémoire seul\n");
+            }
+        }
+    }
+
+    return 0;
+}
+
+int capture_probe_format(const char *path, uint32_t pixelformat) {
+    int fd = open(path, O_RDWR | O_NONBLOCK);
+    if (fd == -1) return -1;
+    int supported = has_format(fd, pixelformat);
+    close(fd);
+    return supported;
+}
+
+int capture_set_fps(CaptureDevice *dev, unsigned int fps) {
+    struct v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    if (xioctl(dev->fd, VIDIOC_G_PARM, &parm) == -1 ||
+        !(parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+        printf("Cadence non réglable sur ce périphérique\n");
+        return -1;
+    }
+
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = fps;
+    if (xioctl(dev->fd, VIDIOC_S_PARM, &parm) == -1) {
+        perror("Erreur de configuration de la cadence");
+        return -1;
+    }
+
+    // Le driver arrondit à la cadence la plus proche qu'il sait produire
+    struct v4l2_fract *tpf = &parm.parm.capture.timeperframe;
+    dev->fps = tpf->numerator ? (double)tpf->denominator / tpf->numerator : 0;
+    return 0;
+}
+
+int capture_start(CaptureDevice *dev) {
+    for (unsigned int i = 0; i < dev->n_buffers; i++) {
+        if (dev->buffers[i].owned) continue;
+        if (queue_buffer(dev, &dev->buffers[i]) == -1) return -1;
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(dev->fd, VIDIOC_STREAMON, &type) == -1) {
+        perror("Erreur de démarrage du flux vidéo");
+        return -1;
+    }
+    dev->streaming = 1;
+    return 0;
+}
+
+CaptureBuffer *capture_acquire(CaptureDevice *dev) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(dev->fd, VIDIOC_DQBUF, &buf) == -1) {
+        if (errno != EAGAIN) perror("Erreur de récupération de buffer");
+        return NULL;
+    }
+    if (buf.index >= dev->n_buffers) {
+        printf("Index de buffer invalide: %u\n", buf.index);
+        return NULL;
+    }
+
+    CaptureBuffer *buffer = &dev->buffers[buf.index];
+    buffer->bytesused = buf.bytesused;
+    buffer->sequence = buf.sequence;
+    buffer->timestamp = buf.timestamp;
+    buffer->flags = buf.flags;
+    buffer->dequeue_ms = capture_now_ms();
+
+    pthread_mutex_lock(&dev->lock);
+    buffer->owned = 1;
+    dev->owned_count++;
+    pthread_mutex_unlock(&dev->lock);
+    return buffer;
+}
+
+int capture_wait(CaptureDevice *dev, int timeout_ms) {
+    struct pollfd pfd = { .fd = dev->fd, .events = POLLIN };
+    int ret;
+    do {
+        ret = poll(&pfd, 1, timeout_ms);
+    } while (ret == -1 && errno == EINTR);
+    if (ret == -1) {
+        perror("Erreur d'attente de frame");
+        return -1;
+    }
+    if (ret > 0 && (pfd.revents & (POLLERR | POLLHUP))) {
+        printf("Périphérique de capture en erreur\n");
+        return -1;
+    }
+    return ret > 0;
+}
+
+int capture_release(CaptureDevice *dev, CaptureBuffer *buffer) {
+    pthread_mutex_lock(&dev->lock);
+    if (!buffer->owned) {
+        pthread_mutex_unlock(&dev->lock);
+        printf("Buffer %u relâché alors qu'il n'est pas possédé\n", buffer->index);
+        return -1;
+    }
+    buffer->owned = 0;
+    dev->owned_count--;
+
+    // Après l'arrêt du flux, le buffer sera remis en file par capture_start()
+    int ret = dev->streaming ? queue_buffer(dev, buffer) : 0;
+    pthread_mutex_unlock(&dev->lock);
+    return ret;
+}
+
+int capture_stop(CaptureDevice *dev) {
+    if (!dev->streaming) return 0;
+
+    // STREAMOFF retire de la file du driver les buffers qui y étaient : capture_start()
+    // les y remettra. Les buffers possédés (file de frames, encodeur) le restent
+    // jusqu'à leur capture_release(), qui ne les remet alors pas en file.
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(dev->fd, VIDIOC_STREAMOFF, &type) == -1) {
+        perror("Erreur d'arrêt du flux vidéo");
+        return -1;
+    }
+    pthread_mutex_lock(&dev->lock);
+    dev->streaming = 0;
+    pthread_mutex_unlock(&dev->lock);
+    return 0;
+}
+
+void capture_close(CaptureDevice *dev) {
+    // Jamais ouvert ou déjà fermé : le verrou est déjà détruit
+    if (dev->fd < 0) return;
+    capture_stop(dev);
+    if (dev->owned_count > 0) {
+        printf("%u buffers de capture encore possédés à la fermeture\n", dev->owned_count);
+    }
+
+    for (unsigned int i = 0; i < CAPTURE_MAX_BUFFERS; i++) {
+        CaptureBuffer *buffer = &dev->buffers[i];
+        if (buffer->dmabuf_fd >= 0) close(buffer->dmabuf_fd);
+        if (buffer->start != NULL) munmap(buffer->start, buffer->length);
+        buffer->dmabuf_fd = -1;
+        buffer->start = NULL;
+    }
+    dev->n_buffers = 0;
+
+    close(dev->fd);
+    dev->fd = -1;
+    pthread_mutex_destroy(&dev->lock);
+}
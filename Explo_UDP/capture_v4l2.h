@@ -0,0 +1,99 @@
+#ifndef CAPTURE_V4L2_H
+#define CAPTURE_V4L2_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+// Capture V4L2 sans copie : les buffers du driver sont mappés une seule fois et
+// exportés en DMABUF (VIDIOC_EXPBUF) quand le driver le permet. Une frame est
+// passée par référence à l'étape suivante (encodeur, envoi) :
+//   capture_acquire() : le buffer sort de la file du driver, l'application le possède
+//   capture_release() : le buffer est remis dans la file du driver (requeue)
+// Entre les deux, le driver n'écrit pas dans le buffer. Chaque buffer acquis doit
+// être relâché, sinon le driver finit par manquer de buffers et la capture s'arrête.
+// capture_release() peut être appelée depuis un autre thread que la capture.
+//
+// Le périphérique est ouvert en O_NONBLOCK : capture_acquire() n'attend jamais.
+// dev.fd devient lisible (poll/epoll) quand une frame est prête, ce qui permet de
+// servir plusieurs caméras et les sockets depuis une même boucle d'événements.
+
+#define CAPTURE_MAX_BUFFERS 8
+
+typedef struct {
+    unsigned int index;       // Index V4L2 du buffer
+    void *start;              // Mappage mémoire (lecture CPU)
+    size_t length;
+    int dmabuf_fd;            // Descripteur DMABUF, -1 si l'export n'est pas supporté
+    uint32_t bytesused;       // Taille de la dernière frame
+    uint32_t sequence;        // Numéro de frame donné par le driver
+    struct timeval timestamp; // Horodatage donné par le driver
+    uint32_t flags;           // Flags V4L2 (type d'horloge de timestamp)
+    double dequeue_ms;        // Date de sortie de la file du driver (CLOCK_MONOTONIC)
+    int owned;                // 1 tant que l'application possède le buffer
+} CaptureBuffer;
+
+typedef struct {
+    int fd;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixelformat;
+    uint32_t bytesperline;
+    uint32_t sizeimage;
+    double fps;                // Cadence négociée (capture_set_fps), 0 si inconnue
+    CaptureBuffer buffers[CAPTURE_MAX_BUFFERS];
+    unsigned int n_buffers;
+    unsigned int owned_count;  // Buffers actuellement hors de la file du driver
+    int streaming;
+    pthread_mutex_t lock;      // Protège owned / owned_count
+} CaptureDevice;
+
+// Date courante CLOCK_MONOTONIC en millisecondes
+double capture_now_ms(void);
+
+// Date de capture de la frame par le capteur (glass) sur CLOCK_MONOTONIC, en ms.
+// À lire avant de rendre le buffer : ses champs changent à la frame suivante.
+double capture_frame_time_ms(const CaptureBuffer *buffer);
+
+// Convertit une date CLOCK_MONOTONIC (ms) dans l'horloge commune du réseau
+// (CLOCK_REALTIME, µs depuis l'epoch Unix, voir FRAG_EXT_CAPTURE_TIME)
+uint64_t capture_epoch_us(double monotonic_ms);
+
+// Ouvre le périphérique, configure le format et prépare n_buffers buffers.
+// Échoue si le driver ne propose pas pixelformat (VIDIOC_ENUM_FMT, formats listés).
+// La résolution réellement acceptée par le driver est disponible dans dev.
+int capture_open(CaptureDevice *dev, const char *path, uint32_t width, uint32_t height,
+                 uint32_t pixelformat, unsigned int n_buffers);
+
+// Indique si le périphérique propose pixelformat sans le configurer (ex. MJPEG natif) :
+// 1 si oui, 0 sinon, -1 si le périphérique ne peut pas être ouvert
+int capture_probe_format(const char *path, uint32_t pixelformat);
+
+// Demande une cadence (VIDIOC_S_PARM) avant capture_start(), la cadence retenue
+// par le driver est dans dev->fps. Retourne -1 si le driver ne la règle pas.
+int capture_set_fps(CaptureDevice *dev, unsigned int fps);
+
+// Met tous les buffers libres en file et démarre le flux
+int capture_start(CaptureDevice *dev);
+
+// Récupère la prochaine frame sans attendre, NULL si aucune n'est prête
+// (errno = EAGAIN) ou en cas d'erreur
+CaptureBuffer *capture_acquire(CaptureDevice *dev);
+
+// Attend qu'une frame soit prête, retourne 1 si prête, 0 après timeout_ms, -1 en cas d'erreur
+int capture_wait(CaptureDevice *dev, int timeout_ms);
+
+// Rend le buffer au driver, retourne -1 s'il n'était pas possédé ou en cas d'erreur
+int capture_release(CaptureDevice *dev, CaptureBuffer *buffer);
+
+// Arrête le flux. Les buffers encore possédés restent valides et doivent toujours
+// être rendus par capture_release().
+int capture_stop(CaptureDevice *dev);
+
+// Arrête le flux si besoin, libère les mappages et les descripteurs DMABUF.
+// Tous les buffers doivent avoir été rendus (file de frames vidée, encodeur fermé).
+// Sans effet sur un périphérique dont l'ouverture a échoué ou déjà fermé.
+void capture_close(CaptureDevice *dev);
+
+#endif // CAPTURE_V4L2_H
@@ -3,38 +3,201 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
-#include <time.h>
+#include <poll.h>
+
+#include "../com_udp.h"
+#include "../crc32c.h"
+#include "../compression.h"
+#include "../resume.h"
 
 #define SERVER_IP "127.0.0.1"  // Adresse IP du serveur à modifier selon vos besoins
 #define PORT 8080              // Port du serveur
 #define BUFFER_SIZE 8192       // Taille du buffer pour les fragments d'image
-#define MAX_FILENAME_LEN 256
-#define MAX_RETRIES 5          // Nombre maximum de tentatives de renvoi
-#define TIMEOUT_SEC 2          // Délai d'attente en secondes pour les ACKs
+#define MAX_RETRIES 5          // Un fragment sans ACK après MAX_RETRIES * TIMEOUT_SEC fait échouer l'envoi
+#define TIMEOUT_SEC 2          // Délai d'attente maximal en secondes pour l'ACK d'un fragment
+#define RTO_INITIAL_MS 250     // Délai avant renvoi tant qu'aucun aller-retour n'a été mesuré
+#define RTO_MIN_MS 50
+#define RESUME_RETRIES 2       // Tentatives de la requête de reprise avant un envoi complet
+#define DEFAULT_FLOWS 4        // Nombre de flux (threads) d'envoi parallèles par défaut
+#define MAX_FLOWS 64
+#define DEFAULT_WINDOW 16      // Fragments en vol sans ACK par flux par défaut (réduite en cas de pertes)
+#define MAX_WINDOW 256
+#define FAST_RETRANSMIT_ACKS 3 // ACKs de fragments envoyés après un fragment avant de le considérer perdu
 
-// Structure pour les en-têtes de paquet
+// Budget de débit global partagé par tous les flux
 typedef struct {
-    uint32_t packet_id;    // Identifiant de paquet
-    uint32_t total_size;   // Taille totale de l'image
-    uint32_t chunk_size;   // Taille du fragment actuel
-    uint32_t offset;       // Position du fragment dans l'image
-    uint8_t is_last;       // Indique si c'est le dernier fragment
-    char filename[MAX_FILENAME_LEN]; // Nom du fichier
-} packet_header;
+    pthread_mutex_t lock;
+    double bytes_per_ms;  // 0 : pas de limite
+    double next_ms;       // Date à partir de laquelle le prochain paquet peut partir
+} RateLimiter;
+
+static RateLimiter rate_limiter = { PTHREAD_MUTEX_INITIALIZER, 0, 0 };
+
+// Fragment envoyé, gardé jusqu'à son ACK pour pouvoir le renvoyer
+typedef struct {
+    int used;
+    uint32_t seq_num;
+    int resent;               // Renvois du fragment (son aller-retour n'est alors plus mesuré)
+    int timeouts;             // Délais dépassés : le délai de renvoi double à chacun
+    int later_acks;           // Fragments envoyés après celui-ci et déjà acquittés
+    double first_ms;          // Date du premier envoi
+    double sent_ms;           // Date du dernier envoi
+    uint8_t *packet;          // En-tête + données, dans buffer
+    size_t len;
+    uint8_t buffer[FRAG_HEADER_MAX_SIZE + BUFFER_SIZE];
+} WindowSlot;
+
+// Délai de renvoi estimé à partir des allers-retours mesurés (méthode de Jacobson)
+typedef struct {
+    double srtt;    // Aller-retour lissé, 0 avant la première mesure
+    double rttvar;
+    double rto;
+} RttEstimator;
+
+// File des fichiers à envoyer, partagée par les flux
+typedef struct {
+    char **files;
+    int count;
+    int next;            // Prochain fichier à prendre
+    int sent;
+    int failed;
+    uint64_t bytes_sent;
+    CompressionType compression;
+    int window;          // Fragments en vol sans ACK par flux
+    struct sockaddr_in server_addr;
+    pthread_mutex_t lock;
+} SendQueue;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Réserve len octets dans le budget global et attend le créneau correspondant
+static void rate_limit(size_t len) {
+    if (rate_limiter.bytes_per_ms <= 0) return;
+    
+    pthread_mutex_lock(&rate_limiter.lock);
+    double now = now_ms();
+    if (rate_limiter.next_ms < now) rate_limiter.next_ms = now;  // Pas de rattrapage après une pause
+    double slot = rate_limiter.next_ms;
+    rate_limiter.next_ms += len / rate_limiter.bytes_per_ms;
+    pthread_mutex_unlock(&rate_limiter.lock);
+    
+    if (slot > now) usleep((useconds_t)((slot - now) * 1000));
+}
+
+// Envoie (ou renvoie) un fragment de la fenêtre
+static int send_slot(int sockfd, struct sockaddr_in *server_addr, WindowSlot *slot) {
+    rate_limit(slot->len);
+    if (sendto(sockfd, slot->packet, slot->len, 0, (struct sockaddr *)server_addr, sizeof(*server_addr)) < 0) {
+        perror("Erreur lors de l'envoi du paquet");
+        return -1;
+    }
+    slot->sent_ms = now_ms();
+    slot->later_acks = 0;
+    return 0;
+}
+
+static void rtt_update(RttEstimator *rtt, double sample_ms) {
+    if (rtt->srtt == 0) {
+        rtt->srtt = sample_ms;
+        rtt->rttvar = sample_ms / 2;
+    } else {
+        double delta = sample_ms - rtt->srtt;
+        rtt->rttvar += ((delta < 0 ? -delta : delta) - rtt->rttvar) / 4;
+        rtt->srtt += delta / 8;
+    }
+    rtt->rto = rtt->srtt + 4 * rtt->rttvar;
+    if (rtt->rto < RTO_MIN_MS) rtt->rto = RTO_MIN_MS;
+    if (rtt->rto > TIMEOUT_SEC * 1000.0) rtt->rto = TIMEOUT_SEC * 1000.0;
+}
+
+// Échéance du fragment : le délai de renvoi double à chaque délai dépassé, jusqu'à TIMEOUT_SEC
+static double slot_deadline(const WindowSlot *slot, const RttEstimator *rtt) {
+    double timeout = rtt->rto * (1 << (slot->timeouts < 10 ? slot->timeouts : 10));
+    if (timeout > TIMEOUT_SEC * 1000.0) timeout = TIMEOUT_SEC * 1000.0;
+    return slot->sent_ms + timeout;
+}
+
+// Charge le fichier en mémoire et le compresse, retourne NULL si la compression n'est pas utile
+static uint8_t *load_compressed(FILE *fp, uint32_t file_size, CompressionType wanted,
+                                CompressionType *type, size_t *compressed_size, uint32_t *file_crc) {
+    uint8_t *file_data = malloc(file_size);
+    if (file_data == NULL) return NULL;
+    if (fread(file_data, 1, file_size, fp) != file_size) {
+        free(file_data);
+        return NULL;
+    }
+    
+    uint8_t *compressed = NULL;
+    CompressionStats stats;
+    *type = choose_compression(file_data, file_size, wanted);
+    if (*type != COMPRESSION_NONE &&
+        compress_buffer(*type, file_data, file_size, &compressed, compressed_size, &stats) == 0) {
+        *file_crc = crc32c(file_data, file_size);
+        print_compression_stats("Compression", &stats);
+    } else {
+        printf("Compression %s ignorée (format déjà compressé ou gain nul)\n", compression_name(wanted));
+    }
+    
+    free(file_data);
+    return compressed;
+}
+
+// Demande au serveur les fragments déjà reçus lors d'une session précédente.
+// Retourne la carte des fragments à ne pas renvoyer (vide si le serveur ne répond pas).
+static uint8_t *query_resume(int sockfd, struct sockaddr_in *server_addr, uint32_t transfer_id,
+                             uint32_t total_size, uint32_t total_frags, const char *basename) {
+    uint8_t *received = calloc(total_frags / 8 + 1, 1);
+    if (received == NULL) return NULL;
+    
+    char query[RESUME_MAX_MESSAGE];
+    snprintf(query, sizeof(query), RESUME_QUERY "%u:%u:%u:%s", transfer_id, total_size, total_frags, basename);
+    char expected[32];
+    snprintf(expected, sizeof(expected), RESUME_REPLY "%u:", transfer_id);
+    
+    for (int retry = 0; retry < RESUME_RETRIES; retry++) {
+        if (sendto(sockfd, query, strlen(query), 0, (struct sockaddr *)server_addr, sizeof(*server_addr)) < 0) {
+            perror("Erreur lors de l'envoi de la requête de reprise");
+            break;
+        }
+        
+        // Les ACKs en retard d'un transfert précédent sont ignorés
+        char reply[RESUME_MAX_MESSAGE + 1];
+        ssize_t reply_len;
+        while ((reply_len = recvfrom(sockfd, reply, sizeof(reply) - 1, 0, NULL, NULL)) > 0) {
+            reply[reply_len] = '\0';
+            if (strncmp(reply, expected, strlen(expected)) != 0) continue;
+            if (parse_ranges(reply + strlen(expected), received, total_frags) < 0) {
+                printf("Réponse de reprise invalide, envoi complet\n");
+                memset(received, 0, total_frags / 8 + 1);
+            }
+            return received;
+        }
+    }
+    
+    printf("Pas de réponse à la requête de reprise, envoi complet\n");
+    return received;
+}
 
 // Fonction pour envoyer un fichier image
-int send_image(int sockfd, struct sockaddr_in *server_addr, const char *filename) {
+int send_image(int sockfd, struct sockaddr_in *server_addr, const char *filename, CompressionType wanted,
+               int window) {
     FILE *fp;
-    char buffer[BUFFER_SIZE + sizeof(packet_header)];
-    uint32_t packet_id = 0;
+    uint8_t *payload = NULL;  // Fichier compressé en mémoire, NULL si envoyé tel quel
+    uint32_t packet_id = 0;   // Prochain fragment à préparer
     struct stat file_stat;
-    socklen_t addr_len = sizeof(struct sockaddr_in);
     
     // Ouvrir le fichier image
     fp = fopen(filename, "rb");
@@ -47,15 +210,18 @@ int send_image(int sockfd, struct sockaddr_in *server_addr, const char *filename
     if (stat(filename, &file_stat) != 0) {
         perror("Erreur lors de l'obtention de la taille du fichier");
         fclose(fp);
+        free(payload);
         return -1;
     }
     
     // Extraire le nom de base du fichier (sans le chemin)
     const char *basename = strrchr(filename, '/');
+    basename = basename ? basename + 1 : filename;
     if (stat(filename, &file_stat) != 0) {
         perror("Erreur lors de l'obtention de la taille du fichier");
         printf("Code d'erreur: %d, Message: %s\n", errno, strerror(errno));
         fclose(fp);
+        free(payload);
         return -1;
     }   
     
@@ -69,102 +235,237 @@ int send_image(int sockfd, struct sockaddr_in *server_addr, const char *filename
         perror("Erreur lors de la configuration du timeout");
     }
     
+    uint32_t file_crc = 0;  // CRC32C du fichier, calculé au fil de la lecture
+    
+    // Compression optionnelle du fichier complet avant la fragmentation
+    CompressionType compression = COMPRESSION_NONE;
+    size_t payload_size = file_stat.st_size;
+    if (wanted != COMPRESSION_NONE) {
+        payload = load_compressed(fp, file_stat.st_size, wanted, &compression, &payload_size, &file_crc);
+        if (payload == NULL) {
+            compression = COMPRESSION_NONE;
+            payload_size = file_stat.st_size;
+        }
+    }
+    
     uint32_t offset = 0;
-    uint32_t bytes_left = file_stat.st_size;
-    
-    // Envoyer le fichier par fragments
-    while (bytes_left > 0) {
-        // Préparer l'en-tête du paquet
-        packet_header *header = (packet_header *)buffer;
-        header->packet_id = packet_id++;
-        header->total_size = file_stat.st_size;
-        header->offset = offset;
-        header->chunk_size = (bytes_left > BUFFER_SIZE) ? BUFFER_SIZE : bytes_left;
-        header->is_last = (bytes_left <= BUFFER_SIZE) ? 1 : 0;
-        strncpy(header->filename, basename, MAX_FILENAME_LEN - 1);
-        header->filename[MAX_FILENAME_LEN - 1] = '\0';  // Assure la terminaison
-        
-        // Positionner le pointeur de fichier
-        fseek(fp, offset, SEEK_SET);
-        
-        // Lire les données du fichier
-        size_t bytes_read = fread(buffer + sizeof(packet_header), 1, header->chunk_size, fp);
-        if (bytes_read != header->chunk_size) {
-            if (feof(fp)) {
-                // Fin du fichier atteinte, ajuster la taille du chunk
-                header->chunk_size = bytes_read;
-                header->is_last = 1;
+    uint32_t bytes_left = payload_size;
+    uint32_t total_frags = (bytes_left + BUFFER_SIZE - 1) / BUFFER_SIZE;
+    size_t basename_len = strlen(basename);
+    if (basename_len > FRAG_MAX_FILENAME_LEN) basename_len = FRAG_MAX_FILENAME_LEN;
+    
+    // Identifiant stable : un client relancé sur le même fichier reprend le même transfert
+    char transfer_name[FRAG_MAX_FILENAME_LEN + 1];
+    snprintf(transfer_name, sizeof(transfer_name), "%.*s", (int)basename_len, basename);
+    uint32_t transfer_id = make_transfer_id(transfer_name, file_stat.st_size, file_stat.st_mtime,
+                                            BUFFER_SIZE, compression);
+    
+    // Fragments déjà reçus par le serveur lors d'une session précédente
+    uint8_t *received = query_resume(sockfd, server_addr, transfer_id, payload_size, total_frags, transfer_name);
+    if (received == NULL) {
+        printf("Erreur d'allocation de la carte de reprise\n");
+        fclose(fp);
+        free(payload);
+        return -1;
+    }
+    uint32_t skipped_frags = 0;
+    for (uint32_t i = 0; i < total_frags; i++) {
+        skipped_frags += RESUME_BIT(received, i);
+    }
+    if (skipped_frags > 0) {
+        printf("Reprise du transfert: %u/%u fragments déjà reçus par le serveur\n", skipped_frags, total_frags);
+    }
+    
+    // Fenêtre glissante : jusqu'à window fragments partent sans attendre leur ACK, le débit
+    // est fixé par rate_limit() et non plus par un aller-retour réseau par fragment.
+    // Une perte (buffer du serveur plein) divise la fenêtre par deux, chaque ACK la fait
+    // grandir d'un fragment par aller-retour jusqu'à window.
+    WindowSlot *slots = calloc(window, sizeof(WindowSlot));
+    if (slots == NULL) {
+        printf("Erreur d'allocation de la fenêtre d'envoi\n");
+        fclose(fp);
+        free(payload);
+        free(received);
+        return -1;
+    }
+    uint32_t pending = total_frags - skipped_frags;  // Fragments pas encore acquittés
+    int in_flight = 0;
+    double cwnd = window;         // Fenêtre courante
+    uint32_t recovery_end = 0;    // Les pertes des fragments avant celui-ci ne réduisent plus la fenêtre
+    RttEstimator rtt = { 0, 0, RTO_INITIAL_MS };
+    int complete = 0;  // TRANSFER_COMPLETE déjà reçu
+    int ret = 0;
+    
+    while (pending > 0) {
+        // Remplir la fenêtre avec les fragments suivants, dans l'ordre du fichier
+        while (in_flight < (int)cwnd && packet_id < total_frags) {
+            WindowSlot *slot = slots;
+            while (slot->used) slot++;
+            
+            uint32_t seq_num = packet_id++;
+            uint32_t chunk_size = (bytes_left > BUFFER_SIZE) ? BUFFER_SIZE : bytes_left;
+            uint32_t chunk_offset = offset;
+            offset += chunk_size;
+            bytes_left -= chunk_size;
+            
+            // Lire les données (après la place maximale de l'en-tête)
+            uint8_t *chunk = slot->buffer + FRAG_HEADER_MAX_SIZE;
+            if (payload != NULL) {
+                memcpy(chunk, payload + chunk_offset, chunk_size);
             } else {
-                perror("Erreur lors de la lecture du fichier");
-                fclose(fp);
-                return -1;
+                fseek(fp, chunk_offset, SEEK_SET);
+                size_t bytes_read = fread(chunk, 1, chunk_size, fp);
+                if (bytes_read != chunk_size) {
+                    perror("Erreur lors de la lecture du fichier");
+                    ret = -1;
+                    goto cleanup;
+                }
+                file_crc = crc32c_update(file_crc, chunk, chunk_size);
             }
-        }
-        
-        int retry_count = 0;
-        int ack_received = 0;
-        
-        // Boucle de tentatives d'envoi avec accusé de réception
-        while (!ack_received && retry_count < MAX_RETRIES) {
-            // Envoyer le paquet
-            if (sendto(sockfd, buffer, sizeof(packet_header) + header->chunk_size, 0,
-                      (struct sockaddr *)server_addr, addr_len) < 0) {
-                perror("Erreur lors de l'envoi du paquet");
-                fclose(fp);
-                return -1;
+            
+            // Fragment déjà reçu : lu uniquement pour le CRC du fichier
+            if (RESUME_BIT(received, seq_num)) continue;
+            
+            // Préparer l'en-tête du paquet (le nom du fichier n'est envoyé que dans le premier)
+            FragmentHeader header = {
+                .flags = FRAG_FLAG_CRC,
+                .transfer_id = transfer_id,
+                .seq_num = seq_num,
+                .total_frags = total_frags,
+                .offset = chunk_offset,
+                .total_size = payload_size,
+                .filename = (chunk_offset == 0) ? basename : NULL,
+                .filename_len = (chunk_offset == 0) ? basename_len : 0,
+            };
+            
+            // Le dernier fragment transporte le CRC du fichier complet et la compression utilisée
+            if (bytes_left == 0) {
+                header.flags |= FRAG_FLAG_LAST;
+                header.has_image_crc = 1;
+                header.image_crc = file_crc;
+                header.compression = compression;
+                header.original_size = file_stat.st_size;
             }
             
-            printf("Paquet %u envoyé (offset: %u, taille: %u, dernier: %d)\n", 
-                   header->packet_id, header->offset, header->chunk_size, header->is_last);
+            uint8_t header_buf[FRAG_HEADER_MAX_SIZE];
+            int header_len = encode_fragment_header(&header, header_buf, sizeof(header_buf));
+            if (header_len < 0) {
+                printf("Erreur lors de l'encodage de l'en-tête\n");
+                ret = -1;
+                goto cleanup;
+            }
             
-            // Attendre l'accusé de réception
-            char ack_buffer[256];
-            ssize_t ack_len = recvfrom(sockfd, ack_buffer, sizeof(ack_buffer), 0, NULL, NULL);
+            // Coller l'en-tête juste devant les données, le paquet est gardé pour un renvoi
+            slot->packet = chunk - header_len;
+            slot->len = header_len + chunk_size;
+            memcpy(slot->packet, header_buf, header_len);
+            seal_fragment_crc(slot->packet, slot->len);
+            slot->seq_num = seq_num;
+            slot->resent = 0;
+            slot->timeouts = 0;
+            slot->used = 1;
+            in_flight++;
             
-            if (ack_len > 0) {
-                ack_buffer[ack_len] = '\0';
-                
-                // Vérifier si c'est l'ACK attendu
-                char expected_ack[64];
-                snprintf(expected_ack, sizeof(expected_ack), "ACK:%u", header->packet_id);
+            if (send_slot(sockfd, server_addr, slot) < 0) {
+                ret = -1;
+                goto cleanup;
+            }
+            slot->first_ms = slot->sent_ms;
+            printf("Paquet %u envoyé (offset: %u, taille: %u, dernier: %d)\n",
+                   seq_num, chunk_offset, chunk_size, bytes_left == 0);
+        }
+        
+        // Attendre un ACK jusqu'à la première échéance des fragments en vol
+        double now = now_ms();
+        double deadline = now + TIMEOUT_SEC * 1000.0;
+        for (int i = 0; i < window; i++) {
+            if (slots[i].used && slot_deadline(&slots[i], &rtt) < deadline) {
+                deadline = slot_deadline(&slots[i], &rtt);
+            }
+        }
+        struct pollfd pfd = { .fd = sockfd, .events = POLLIN };
+        int ready = poll(&pfd, 1, deadline > now ? (int)(deadline - now) + 1 : 0);
+        if (ready < 0 && errno != EINTR) {
+            perror("Erreur lors de l'attente des ACKs");
+            ret = -1;
+            goto cleanup;
+        }
+        
+        // Traiter tous les ACKs arrivés ; ceux des fragments déjà acquittés sont ignorés
+        char ack_buffer[256];
+        ssize_t ack_len;
+        while (ready > 0 && (ack_len = recv(sockfd, ack_buffer, sizeof(ack_buffer) - 1, MSG_DONTWAIT)) > 0) {
+            ack_buffer[ack_len] = '\0';
+            unsigned int ack_seq;
+            if (strncmp(ack_buffer, "TRANSFER_COMPLETE", 17) == 0) {
+                printf("Transfert terminé: %s\n", ack_buffer);
+                complete = 1;
+            } else if (sscanf(ack_buffer, "ACK:%u", &ack_seq) == 1) {
+                WindowSlot *acked = NULL;
+                for (int i = 0; i < window && acked == NULL; i++) {
+                    if (slots[i].used && slots[i].seq_num == ack_seq) acked = &slots[i];
+                }
+                if (acked == NULL) continue;  // Doublon ou ACK d'un autre transfert
+                if (acked->resent == 0) rtt_update(&rtt, now_ms() - acked->sent_ms);
+                acked->used = 0;
+                in_flight--;
+                pending--;
+                received[ack_seq / 8] |= 1 << (ack_seq % 8);
+                printf("ACK reçu pour le paquet %u\n", ack_seq);
+                if (cwnd < window) cwnd += 1.0 / cwnd;
                 
-                if (strncmp(ack_buffer, expected_ack, strlen(expected_ack)) == 0) {
-                    ack_received = 1;
-                    printf("ACK reçu pour le paquet %u\n", header->packet_id);
-                } else if (strncmp(ack_buffer, "TRANSFER_COMPLETE", 17) == 0) {
-                    printf("Transfert terminé: %s\n", ack_buffer);
-                    if (header->is_last) {
-                        ack_received = 1;
+                // Renvoi rapide : un fragment doublé par plusieurs fragments envoyés après lui
+                // est perdu (le serveur traite les fragments dans l'ordre d'arrivée)
+                for (int i = 0; i < window; i++) {
+                    WindowSlot *slot = &slots[i];
+                    if (!slot->used || slot->sent_ms >= acked->sent_ms) continue;
+                    if (++slot->later_acks < FAST_RETRANSMIT_ACKS) continue;
+                    // Une seule réduction par salve de pertes
+                    if (slot->seq_num >= recovery_end) {
+                        cwnd = cwnd / 2 < 1 ? 1 : cwnd / 2;
+                        recovery_end = packet_id;
+                    }
+                    printf("Paquet %u perdu, renvoi (fenêtre %d)\n", slot->seq_num, (int)cwnd);
+                    slot->resent++;
+                    if (send_slot(sockfd, server_addr, slot) < 0) {
+                        ret = -1;
+                        goto cleanup;
                     }
                 }
-            } else {
-                retry_count++;
-                printf("Délai d'attente dépassé, nouvelle tentative %d/%d\n", 
-                       retry_count, MAX_RETRIES);
             }
         }
         
-        if (!ack_received) {
-            printf("Échec de l'envoi du paquet après %d tentatives\n", MAX_RETRIES);
-            fclose(fp);
-            return -1;
+        // Renvoyer les fragments dont l'ACK n'est pas arrivé à temps
+        now = now_ms();
+        for (int i = 0; i < window; i++) {
+            WindowSlot *slot = &slots[i];
+            if (!slot->used || now < slot_deadline(slot, &rtt)) continue;
+            if (now - slot->first_ms >= MAX_RETRIES * TIMEOUT_SEC * 1000.0) {
+                printf("Échec de l'envoi du paquet %u après %d tentatives\n", slot->seq_num, slot->resent + 1);
+                ret = -1;
+                goto cleanup;
+            }
+            cwnd = 1;  // Plus aucun ACK : on repart d'un fragment à la fois
+            recovery_end = packet_id;
+            slot->timeouts++;
+            slot->resent++;
+            printf("Délai d'attente dépassé pour le paquet %u, nouvelle tentative %d\n",
+                   slot->seq_num, slot->timeouts);
+            if (send_slot(sockfd, server_addr, slot) < 0) {
+                ret = -1;
+                goto cleanup;
+            }
         }
-        
-        // Mettre à jour les compteurs
-        offset += header->chunk_size;
-        bytes_left -= header->chunk_size;
     }
     
-    fclose(fp);
-    
-    // Attendre l'ACK final si nécessaire
-    if (packet_id > 0) {
+    // Attendre l'ACK final si des fragments ont été envoyés
+    if (packet_id > skipped_frags && !complete) {
         char final_ack[256];
         int retry_count = 0;
         int final_ack_received = 0;
         
         while (!final_ack_received && retry_count < MAX_RETRIES) {
-            ssize_t ack_len = recvfrom(sockfd, final_ack, sizeof(final_ack), 0, NULL, NULL);
+            ssize_t ack_len = recvfrom(sockfd, final_ack, sizeof(final_ack) - 1, 0, NULL, NULL);
             
             if (ack_len > 0) {
                 final_ack[ack_len] = '\0';
@@ -184,44 +485,190 @@ int send_image(int sockfd, struct sockaddr_in *server_addr, const char *filename
         }
     }
     
+cleanup:
+    fclose(fp);
+    free(payload);
+    free(received);
+    free(slots);
+    if (ret < 0) return -1;
+    
     printf("Image envoyée avec succès: %s\n", basename);
     return 0;
 }
 
 
+// Ajoute un fichier à la liste, ou le contenu d'un dossier (sans sous-dossiers)
+static int add_path(const char *path, char ***files, int *count) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return -1;
+    }
+    
+    if (!S_ISDIR(st.st_mode)) {
+        char **grown = realloc(*files, (*count + 1) * sizeof(char *));
+        if (grown == NULL) return -1;
+        *files = grown;
+        (*files)[(*count)++] = strdup(path);
+        return 0;
+    }
+    
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        perror(path);
+        return -1;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;  // Fichiers cachés, "." et ".."
+        
+        char full_path[4096];
+        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+        if (stat(full_path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        
+        char **grown = realloc(*files, (*count + 1) * sizeof(char *));
+        if (grown == NULL) break;
+        *files = grown;
+        (*files)[(*count)++] = strdup(full_path);
+    }
+    closedir(dir);
+    return 0;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+// Flux d'envoi : un socket par thread, les ACKs de chaque flux arrivent sur son port
+static void *send_worker(void *arg) {
+    SendQueue *queue = (SendQueue *)arg;
+    
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("Erreur lors de la création du socket");
+        return NULL;
+    }
+    
+    while (1) {
+        pthread_mutex_lock(&queue->lock);
+        int index = queue->next < queue->count ? queue->next++ : -1;
+        pthread_mutex_unlock(&queue->lock);
+        if (index < 0) break;
+        
+        const char *filename = queue->files[index];
+        struct stat st;
+        int ok = send_image(sockfd, &queue->server_addr, filename, queue->compression, queue->window) == 0 &&
+                 stat(filename, &st) == 0;
+        
+        pthread_mutex_lock(&queue->lock);
+        if (ok) {
+            queue->sent++;
+            queue->bytes_sent += st.st_size;
+        } else {
+            queue->failed++;
+            printf("Échec de l'envoi de l'image %s\n", filename);
+        }
+        pthread_mutex_unlock(&queue->lock);
+    }
+    
+    close(sockfd);
+    return NULL;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [-j flux] [-w fenêtre] [-r Mbit/s] [-c none|lz4|zstd] <fichier|dossier>...\n", prog);
+    printf("  -j  nombre de transferts simultanés (défaut: %d)\n", DEFAULT_FLOWS);
+    printf("  -w  fragments envoyés sans attendre leur ACK, par flux (défaut: %d)\n", DEFAULT_WINDOW);
+    printf("  -r  débit total maximum partagé par les flux (défaut: illimité)\n");
+    printf("  -c  compression appliquée avant la fragmentation\n");
+}
+
 int main(int argc, char *argv[]) {
-    int sockfd;
-    struct sockaddr_in server_addr;
+    int flows = DEFAULT_FLOWS;
+    int window = DEFAULT_WINDOW;
+    double rate_mbps = 0;
+    int compression = COMPRESSION_NONE;
     
     // Vérifier les arguments
-    if (argc != 2) {
-        printf("Usage: %s <nom_du_fichier_image>\n", argv[0]);
+    int opt;
+    while ((opt = getopt(argc, argv, "j:w:r:c:")) != -1) {
+        switch (opt) {
+            case 'j':
+                flows = atoi(optarg);
+                break;
+            case 'w':
+                window = atoi(optarg);
+                break;
+            case 'r':
+                rate_mbps = atof(optarg);
+                break;
+            case 'c':
+                // Compression optionnelle du transfert
+                compression = parse_compression(optarg);
+                if (compression < 0 || !compression_supported(compression)) {
+                    printf("Compression %s non disponible dans ce binaire\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || flows < 1 || flows > MAX_FLOWS || window < 1 || window > MAX_WINDOW || rate_mbps < 0) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
     
-    // Création du socket UDP
-    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-        perror("Erreur lors de la création du socket");
+    // Liste des fichiers à envoyer
+    SendQueue queue = { .compression = compression, .window = window, .lock = PTHREAD_MUTEX_INITIALIZER };
+    for (int i = optind; i < argc; i++) {
+        add_path(argv[i], &queue.files, &queue.count);
+    }
+    if (queue.count == 0) {
+        printf("Aucun fichier à envoyer\n");
         return EXIT_FAILURE;
     }
+    qsort(queue.files, queue.count, sizeof(char *), compare_paths);
+    if (flows > queue.count) flows = queue.count;
     
     // Configuration de l'adresse du serveur
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(PORT);
+    memset(&queue.server_addr, 0, sizeof(queue.server_addr));
+    queue.server_addr.sin_family = AF_INET;
+    queue.server_addr.sin_port = htons(PORT);
     
     // Convertir l'adresse IP en format binaire
-    if (inet_pton(AF_INET, SERVER_IP, &server_addr.sin_addr) <= 0) {
+    if (inet_pton(AF_INET, SERVER_IP, &queue.server_addr.sin_addr) <= 0) {
         perror("Erreur lors de la conversion de l'adresse IP");
-        close(sockfd);
         return EXIT_FAILURE;
     }
     
-    // Envoyer l'image
-    if (send_image(sockfd, &server_addr, argv[1]) < 0) {
-        printf("Échec de l'envoi de l'image\n");
+    rate_limiter.bytes_per_ms = rate_mbps * 1e6 / 8 / 1000;
+    printf("Envoi de %d fichier(s) sur %d flux%s\n", queue.count, flows,
+           rate_mbps > 0 ? " (débit limité)" : "");
+    
+    // Envoyer les images en parallèle
+    double start = now_ms();
+    pthread_t threads[MAX_FLOWS];
+    int started = 0;
+    for (int i = 0; i < flows; i++) {
+        if (pthread_create(&threads[started], NULL, send_worker, &queue) != 0) {
+            perror("Erreur lors de la création du thread");
+            break;
+        }
+        started++;
     }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed_s = (now_ms() - start) / 1000.0;
     
-    close(sockfd);
-    return 0;
-}
\ No newline at end of file
+    printf("%d/%d fichier(s) envoyé(s) en %.2f s (%.2f Mo/s)\n", queue.sent, queue.count, elapsed_s,
+           elapsed_s > 0 ? queue.bytes_sent / 1e6 / elapsed_s : 0.0);
+    
+    for (int i = 0; i < queue.count; i++) {
+        free(queue.files[i]);
+    }
+    free(queue.files);
+    return queue.failed ? EXIT_FAILURE : 0;
+}
@@ -2,218 +2,170 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <linux/videodev2.h>
 #include <errno.h>
-#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <linux/videodev2.h>
 
+#include "../capture_v4l2.h"
+#include "../encoder_h264.h"
+#include "../frame_queue.h"
+#include "../com_udp.h"
+#include "../crc32c.h"
 
 #define WIDTH 640
 #define HEIGHT 480
 #define NUM_BUFFERS 4
-
-// Nous avons des problèmes avec le format H264 alors que ce serait le plus 
-// optimisé pour notre cas
-
-// Structure pour les buffers en mémoire MMap
-struct buffer {
-    void *start;
-    size_t length;
-};
-
-// Fonction pour ouvrir le périphérique vidéo
-int open_video_device(const char *dev_name) {
-    int fd = open(dev_name, O_RDWR);
-    if (fd == -1) {
-        perror("Erreur d'ouverture du périphérique");
-        return -1;
-    }
-    return fd;
-}
-
-// Fonction pour configurer le format vidéo 
-int set_video_format(int fd) {
-    struct v4l2_format fmt;
-    memset(&fmt, 0, sizeof(fmt));
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = WIDTH;
-    fmt.fmt.pix.height = HEIGHT;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-    fmt.fmt.pix.field = V4L2_FIELD_INTERLACED;
-
-    if (ioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
-        perror("Erreur de configuration du format");
-        return -1;
-    }
-    return 0;
-}
-
-// Fonction pour allouer les buffers en mémoire MMap
-int allocate_buffers(int fd, struct buffer *buffers) {
-    struct v4l2_requestbuffers req;
-    memset(&req, 0, sizeof(req));
-    req.count = NUM_BUFFERS;
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-
-    if (ioctl(fd, VIDIOC_REQBUFS, &req) == -1) {
-        perror("Erreur de demande de buffers");
-        return -1;
-    }
-
-    for (int i = 0; i < NUM_BUFFERS; i++) {
-        struct v4l2_buffer buf;
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-
-        if (ioctl(fd, VIDIOC_QUERYBUF, &buf) == -1) {
-            perror("Erreur de requête de buffer");
-            return -1;
-        }
-
-        buffers[i].length = buf.length;
-        buffers[i].start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
-        if (buffers[i].start == MAP_FAILED) {
-            perror("Erreur de mappage de buffer");
-            return -1;
-        }
-    }
-
-    return 0;
-}
-
-// Fonction pour mettre les buffers en file d'attente
-int enqueue_buffers(int fd) {
-    for (int i = 0; i < NUM_BUFFERS; i++) {
-        struct v4l2_buffer buf;
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-
-        if (ioctl(fd, VIDIOC_QBUF, &buf) == -1) {
-            perror("Erreur d'enfilement de buffer");
-            return -1;
+#define FPS 25
+#define BITRATE 2000000
+#define OUTPUT_URL "udp://192.168.1.1:12345"
+#define DEST_IP "192.168.1.1"
+#define DEST_PORT 12345
+#define QUEUE_DEPTH 1  // Seule la frame la plus récente attend l'encodeur
+#define FRAG_DATA_SIZE 1400  // Données H.264 par datagramme en mode frag
+
+// L'encodage H.264 se fait dans le processus (libavcodec) au lieu d'un ffmpeg
+// lancé par popen : pas de copie dans un pipe et une latence maîtrisée.
+// Mode ts : flux MPEG-TS (lisible par ffplay). Mode frag : chaque frame H.264 est
+// fragmentée avec l'en-tête commun, qui porte la date de capture de la frame
+// (reçu par Com_UDP_Antoine/server, qui mesure latence et gigue).
+
+typedef struct {
+    int sockfd;
+    struct sockaddr_in dest;
+    uint32_t frame_id;
+    uint8_t packet[FRAG_HEADER_MAX_SIZE + FRAG_DATA_SIZE];
+} FragmentSender;
+
+// Callback de l'encodeur : envoie une frame H.264 en fragments horodatés
+static void send_fragments(const uint8_t *data, int size, uint64_t capture_us, void *opaque) {
+    FragmentSender *sender = (FragmentSender *)opaque;
+    uint32_t total_frags = (size + FRAG_DATA_SIZE - 1) / FRAG_DATA_SIZE;
+    uint32_t frame_crc = crc32c(data, size);
+    sender->frame_id++;
+
+    for (uint32_t i = 0; i < total_frags; i++) {
+        uint32_t offset = i * FRAG_DATA_SIZE;
+        uint32_t len = size - offset < FRAG_DATA_SIZE ? size - offset : FRAG_DATA_SIZE;
+        int last = (i == total_frags - 1);
+        FragmentHeader header = {
+            .flags = FRAG_FLAG_CRC | (last ? FRAG_FLAG_LAST : 0),
+            .transfer_id = sender->frame_id,
+            .seq_num = i,
+            .total_frags = total_frags,
+            .offset = offset,
+            .total_size = size,
+            .has_image_crc = last,
+            .image_crc = frame_crc,
+            .has_capture_time = 1,  // Dans chaque fragment : la latence reste mesurable en cas de perte
+            .capture_time_us = capture_us
+        };
+        int header_len = encode_fragment_header(&header, sender->packet, FRAG_HEADER_MAX_SIZE);
+        memcpy(sender->packet + header_len, data + offset, len);
+        seal_fragment_crc(sender->packet, header_len + len);
+
+        if (sendto(sender->sockfd, sender->packet, header_len + len, 0,
+                   (struct sockaddr *)&sender->dest, sizeof(sender->dest)) < 0) {
+            perror("Erreur d'envoi du fragment UDP");
+            return;
         }
     }
-    return 0;
 }
 
-// Fonction pour démarrer la capture vidéo
-int start_capture(int fd) {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(fd, VIDIOC_STREAMON, &type) == -1) {
-        perror("Erreur de démarrage du flux vidéo");
-        return -1;
-    }
-    return 0;
-}
-
-// Fonction pour capturer et envoyer les frames à FFmpeg via un pipe
-int capture_and_stream(int fd, struct buffer *buffers, FILE *ffmpeg_pipe) {
+// Fonction pour encoder les frames fournies par le thread de capture
+int capture_and_stream(FrameQueue *queue, H264Encoder *encoder) {
     for (int i = 0; i < 100; i++) {
-        struct v4l2_buffer buf;
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-
-        if (ioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
-            perror("Erreur de récupération de buffer");
+        // La frame reste dans le buffer du driver jusqu'à ce que l'encodeur la rende
+        CaptureBuffer *frame = frame_queue_pop(queue);
+        if (frame == NULL) {
             return -1;
         }
 
-        // Debugging de la taille de la frame
-        printf("Frame %d: %d bytes used\n", i + 1, buf.bytesused);
-
         // Vérification de la validité des données
-        if (buf.bytesused > 0) {
-            fwrite(buffers[buf.index].start, 1, buf.bytesused, ffmpeg_pipe);
-            fflush(ffmpeg_pipe);  // S'assurer que les données sont envoyées au pipe
-        } else {
+        if (frame->bytesused == 0) {
             printf("Aucune donnée valide pour la frame %d\n", i + 1);
+            capture_release(queue->dev, frame);
+            continue;
         }
 
-        // Remettre le buffer en file d'attente
-        if (ioctl(fd, VIDIOC_QBUF, &buf) == -1) {
-            perror("Erreur de remise en file d'attente du buffer");
+        // Lus avant que l'encodeur ne rende le buffer au driver
+        uint32_t bytesused = frame->bytesused;
+        double captured_ms = capture_frame_time_ms(frame);
+        if (encoder_encode(encoder, frame) == -1) {
             return -1;
         }
-    }
-    return 0;
-}
+        frame_queue_sent(queue, captured_ms);
 
-// Fonction pour arrêter la capture vidéo
-int stop_capture(int fd) {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(fd, VIDIOC_STREAMOFF, &type) == -1) {
-        perror("Erreur d'arrêt du flux vidéo");
-        return -1;
+        // Debugging de la taille de la frame et du temps d'encodage
+        const EncoderStats *stats = encoder_stats(encoder);
+        printf("Frame %d: %u bytes used, encodage %.2f ms, %d octets H.264\n",
+               i + 1, bytesused, stats->last_ms, stats->last_size);
     }
     return 0;
 }
 
-// Fonction pour libérer les ressources
-void free_buffers(struct buffer *buffers) {
-    for (int i = 0; i < NUM_BUFFERS; i++) {
-        munmap(buffers[i].start, buffers[i].length);
-    }
-}
-
-int main() {
-    int fd = open_video_device("/dev/video0");
-    if (fd == -1) return 1;
-
-    if (set_video_format(fd) == -1) {
-        perror("Erreur de convertisseur du format vidéo\n");
-        close(fd);
+int main(int argc, char *argv[]) {
+    // Politique de la file de capture quand l'encodeur prend du retard
+    int policy = argc > 1 ? parse_frame_policy(argv[1]) : FRAME_DROP_OLDEST;
+    int depth = argc > 2 ? atoi(argv[2]) : QUEUE_DEPTH;
+    const char *mode = argc > 3 ? argv[3] : "ts";
+    if (policy < 0 || depth < 1 || (strcmp(mode, "ts") != 0 && strcmp(mode, "frag") != 0)) {
+        printf("Usage: %s [drop-oldest|drop-newest|block] [profondeur] [ts|frag]\n", argv[0]);
         return 1;
     }
 
-    struct buffer buffers[NUM_BUFFERS];
-    if (allocate_buffers(fd, buffers) == -1) {
-        perror("Erreur d'allocations des buffers'\n");
-        close(fd);
-        return 1;
+    FragmentSender sender = { .sockfd = -1 };
+    if (strcmp(mode, "frag") == 0) {
+        sender.sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sender.sockfd < 0) {
+            perror("Erreur lors de la création du socket");
+            return 1;
+        }
+        sender.dest.sin_family = AF_INET;
+        sender.dest.sin_port = htons(DEST_PORT);
+        sender.dest.sin_addr.s_addr = inet_addr(DEST_IP);
     }
 
-    if (enqueue_buffers(fd) == -1) {
-        perror("Erreur dans la queue des buffers\n");
-        close(fd);
+    CaptureDevice dev;
+    if (capture_open(&dev, "/dev/video0", WIDTH, HEIGHT, V4L2_PIX_FMT_YUYV, NUM_BUFFERS) == -1) {
         return 1;
     }
 
-    if (start_capture(fd) == -1) {
+    if (capture_start(&dev) == -1) {
         perror("Erreur de capture de la vidéo\n");
-        close(fd);
+        capture_close(&dev);
         return 1;
     }
 
-    // Ouvrir le pipe FFmpeg pour l'encodage
-    FILE *ffmpeg_pipe = popen("ffmpeg -f rawvideo -pix_fmt yuyv422 -s 640x480 -r 25 -i pipe: -c:v libx264 -f mpegts udp://192.168.1.1:12345", "w");
-    if (!ffmpeg_pipe) {
-        perror("Erreur d'ouverture du pipe FFmpeg");
-        close(fd);
+    H264Encoder *encoder = encoder_open(&dev, FPS, BITRATE, sender.sockfd < 0 ? OUTPUT_URL : NULL);
+    if (encoder == NULL) {
+        capture_close(&dev);
         return 1;
     }
+    if (sender.sockfd >= 0) {
+        encoder_set_packet_callback(encoder, send_fragments, &sender);
+    }
 
-    if (capture_and_stream(fd, buffers, ffmpeg_pipe) == -1) {
-        fclose(ffmpeg_pipe);
-        close(fd);
-        return 1;
+    FrameQueue queue;
+    frame_queue_init(&queue, &dev, depth, policy);
+    int ret = -1;
+    if (frame_queue_start(&queue) == 0) {
+        ret = capture_and_stream(&queue, encoder);
+        frame_queue_stop(&queue);
     }
+    frame_queue_print_stats(&queue);
 
-    if (stop_capture(fd) == -1) {
-        fclose(ffmpeg_pipe);
-        close(fd);
-        return 1;
+    const EncoderStats *stats = encoder_stats(encoder);
+    if (stats->frames > 0) {
+        printf("%s: %llu frames, encodage moyen %.2f ms, max %.2f ms, %.1f ko/frame\n",
+               encoder_name(encoder), (unsigned long long)stats->frames,
+               stats->total_ms / stats->frames, stats->max_ms, stats->bytes / 1e3 / stats->frames);
     }
 
-    // Libérer les ressources
-    free_buffers(buffers);
-    fclose(ffmpeg_pipe);
-    close(fd);
-    return 0;
+    // Chaque détenteur rend ses buffers avant l'arrêt du flux : la file est déjà vidée
+    // par frame_queue_stop(), l'encodeur rend ses dernières frames en se fermant
+    encoder_close(encoder);
+    capture_stop(&dev);
+    capture_close(&dev);
+    if (sender.sockfd >= 0) close(sender.sockfd);
+    return ret == -1 ? 1 : 0;
 }
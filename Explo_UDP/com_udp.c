@@ -0,0 +1,238 @@
+#include "com_udp.h"
+#include "crc32c.h"
+
+#include <string.h>
+#include <time.h>
+
+#define FRAG_CRC_POS 4  // Position du CRC du fragment dans l'en-tête
+
+// Écrit un entier en varint LEB128, retourne le nombre d'octets écrits ou -1
+static int put_varint(uint8_t *buf, size_t buf_size, uint32_t value) {
+    size_t i = 0;
+    do {
+        if (i >= buf_size) return -1;
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        buf[i++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    return (int)i;
+}
+
+// Lit un varint LEB128 (5 octets max pour 32 bits), retourne le nombre d'octets lus ou -1
+static int get_varint(const uint8_t *buf, size_t len, uint32_t *value) {
+    uint32_t result = 0;
+    for (size_t i = 0; i < len && i < 5; i++) {
+        result |= (uint32_t)(buf[i] & 0x7F) << (7 * i);
+        if (!(buf[i] & 0x80)) {
+            *value = result;
+            return (int)(i + 1);
+        }
+    }
+    return -1;
+}
+
+// Écrit / lit un entier 32 bits en ordre réseau
+static void put_be32(uint8_t *buf, uint32_t value) {
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+static uint32_t get_be32(const uint8_t *buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+static void put_be64(uint8_t *buf, uint64_t value) {
+    put_be32(buf, value >> 32);
+    put_be32(buf + 4, (uint32_t)value);
+}
+
+static uint64_t get_be64(const uint8_t *buf) {
+    return ((uint64_t)get_be32(buf) << 32) | get_be32(buf + 4);
+}
+
+uint64_t frag_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int encode_fragment_header(const FragmentHeader *header, uint8_t *buf, size_t buf_size) {
+    int has_filename = header->filename && header->filename_len > 0;
+    uint8_t flags = header->flags & ~FRAG_FLAG_EXT;
+    if (has_filename || header->has_image_crc || header->compression || header->has_capture_time ||
+        header->has_stream_id) {
+        flags |= FRAG_FLAG_EXT;
+    }
+
+    if (buf_size < 4) return -1;
+    buf[0] = FRAG_MAGIC_0;
+    buf[1] = FRAG_MAGIC_1;
+    buf[2] = FRAG_VERSION;
+    buf[3] = flags;
+    size_t pos = 4;
+
+    // Place réservée au CRC, rempli par seal_fragment_crc() une fois les données copiées
+    if (flags & FRAG_FLAG_CRC) {
+        if (pos + 4 > buf_size) return -1;
+        put_be32(buf + pos, 0);
+        pos += 4;
+    }
+
+    const uint32_t fields[] = {
+        header->transfer_id, header->seq_num, header->total_frags,
+        header->offset, header->total_size
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        int n = put_varint(buf + pos, buf_size - pos, fields[i]);
+        if (n < 0) return -1;
+        pos += n;
+    }
+
+    if (flags & FRAG_FLAG_EXT) {
+        // Extension FILENAME
+        if (has_filename) {
+            if (pos + 1 > buf_size) return -1;
+            buf[pos++] = FRAG_EXT_FILENAME;
+            int n = put_varint(buf + pos, buf_size - pos, header->filename_len);
+            if (n < 0 || pos + n + header->filename_len > buf_size) return -1;
+            pos += n;
+            memcpy(buf + pos, header->filename, header->filename_len);
+            pos += header->filename_len;
+        }
+
+        // Extension IMAGE_CRC
+        if (header->has_image_crc) {
+            if (pos + 2 + 4 > buf_size) return -1;
+            buf[pos++] = FRAG_EXT_IMAGE_CRC;
+            buf[pos++] = 4;
+            put_be32(buf + pos, header->image_crc);
+            pos += 4;
+        }
+
+        // Extension COMPRESSION
+        if (header->compression) {
+            uint8_t value[1 + 5];
+            value[0] = header->compression;
+            int n = put_varint(value + 1, sizeof(value) - 1, header->original_size);
+            if (pos + 2 + 1 + n > buf_size) return -1;
+            buf[pos++] = FRAG_EXT_COMPRESSION;
+            buf[pos++] = 1 + n;
+            memcpy(buf + pos, value, 1 + n);
+            pos += 1 + n;
+        }
+
+        // Extension CAPTURE_TIME
+        if (header->has_capture_time) {
+            if (pos + 2 + 8 > buf_size) return -1;
+            buf[pos++] = FRAG_EXT_CAPTURE_TIME;
+            buf[pos++] = 8;
+            put_be64(buf + pos, header->capture_time_us);
+            pos += 8;
+        }
+
+        // Extension STREAM_ID
+        if (header->has_stream_id) {
+            if (pos + 2 + 1 > buf_size) return -1;
+            buf[pos++] = FRAG_EXT_STREAM_ID;
+            buf[pos++] = 1;
+            buf[pos++] = header->stream_id;
+        }
+
+        // Fin de la liste d'extensions
+        if (pos + 1 > buf_size) return -1;
+        buf[pos++] = FRAG_EXT_END;
+    }
+
+    return (int)pos;
+}
+
+int decode_fragment_header(FragmentHeader *header, const uint8_t *buf, size_t len) {
+    if (len < 4 || buf[0] != FRAG_MAGIC_0 || buf[1] != FRAG_MAGIC_1) return -1;
+    if (buf[2] != FRAG_VERSION) return -1;
+
+    memset(header, 0, sizeof(*header));
+    header->version = buf[2];
+    header->flags = buf[3];
+    size_t pos = 4;
+
+    if (header->flags & FRAG_FLAG_CRC) {
+        if (pos + 4 > len) return -1;
+        header->frag_crc = get_be32(buf + pos);
+        pos += 4;
+    }
+
+    uint32_t *fields[] = {
+        &header->transfer_id, &header->seq_num, &header->total_frags,
+        &header->offset, &header->total_size
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        int n = get_varint(buf + pos, len - pos, fields[i]);
+        if (n < 0) return -1;
+        pos += n;
+    }
+
+    if (header->flags & FRAG_FLAG_EXT) {
+        while (1) {
+            if (pos >= len) return -1;
+            uint8_t type = buf[pos++];
+            if (type == FRAG_EXT_END) break;
+
+            uint32_t ext_len;
+            int n = get_varint(buf + pos, len - pos, &ext_len);
+            if (n < 0 || ext_len > len - pos - n) return -1;
+            pos += n;
+
+            if (type == FRAG_EXT_FILENAME && ext_len <= FRAG_MAX_FILENAME_LEN) {
+                header->filename = (const char *)(buf + pos);
+                header->filename_len = (uint8_t)ext_len;
+            } else if (type == FRAG_EXT_IMAGE_CRC && ext_len == 4) {
+                header->has_image_crc = 1;
+                header->image_crc = get_be32(buf + pos);
+            } else if (type == FRAG_EXT_COMPRESSION && ext_len >= 2) {
+                if (get_varint(buf + pos + 1, ext_len - 1, &header->original_size) < 0) return -1;
+                header->compression = buf[pos];
+            } else if (type == FRAG_EXT_CAPTURE_TIME && ext_len == 8) {
+                header->has_capture_time = 1;
+                header->capture_time_us = get_be64(buf + pos);
+            } else if (type == FRAG_EXT_STREAM_ID && ext_len == 1) {
+                header->has_stream_id = 1;
+                header->stream_id = buf[pos];
+            }
+            // Les extensions inconnues sont sautées
+            pos += ext_len;
+        }
+    }
+
+    // Un fragment doit rester dans les limites de l'objet annoncé
+    if (header->seq_num >= header->total_frags || header->offset > header->total_size) return -1;
+
+    return (int)pos;
+}
+
+// CRC32C du datagramme en considérant le champ CRC comme nul
+static uint32_t fragment_crc(const uint8_t *packet, size_t len) {
+    static const uint8_t zero[4] = {0};
+    uint32_t crc = crc32c(packet, FRAG_CRC_POS);
+    crc = crc32c_update(crc, zero, sizeof(zero));
+    return crc32c_update(crc, packet + FRAG_CRC_POS + 4, len - FRAG_CRC_POS - 4);
+}
+
+void seal_fragment_crc(uint8_t *packet, size_t len) {
+    if (len < FRAG_CRC_POS + 4 || !(packet[3] & FRAG_FLAG_CRC)) return;
+    put_be32(packet + FRAG_CRC_POS, fragment_crc(packet, len));
+}
+
+void seal_fragment_crc_split(uint8_t *header, size_t header_len, const uint8_t *data, size_t data_len) {
+    if (header_len < FRAG_CRC_POS + 4 || !(header[3] & FRAG_FLAG_CRC)) return;
+    put_be32(header + FRAG_CRC_POS, 0);
+    uint32_t crc = crc32c_update(crc32c(header, header_len), data, data_len);
+    put_be32(header + FRAG_CRC_POS, crc);
+}
+
+int check_fragment_crc(const uint8_t *packet, size_t len) {
+    if (len < 4 || !(packet[3] & FRAG_FLAG_CRC)) return 1;
+    if (len < FRAG_CRC_POS + 4) return 0;
+    return get_be32(packet + FRAG_CRC_POS) == fragment_crc(packet, len);
+}
@@ -0,0 +1,93 @@
+#ifndef COM_UDP_H
+#define COM_UDP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// En-tête commun à tous les fragments UDP (images, fichiers, frames vidéo).
+// Format v1, indépendant de l'architecture (ARM <-> x86) :
+//
+//   octet 0-1 : magic 'P' 'S'
+//   octet 2   : version du format
+//   octet 3   : flags (FRAG_FLAG_*)
+//   [4 octets : CRC32C du fragment si FRAG_FLAG_CRC]
+//   varints   : transfer_id, seq_num, total_frags, offset, total_size
+//   [extensions TLV si FRAG_FLAG_EXT : type (1 octet), longueur (varint), valeur,
+//    liste terminée par FRAG_EXT_END]
+//
+// Les varints sont en LEB128 (7 bits par octet, poids faible en premier), les
+// champs fixes sont en ordre réseau. La taille des données utiles n'est pas
+// transmise : c'est la taille du datagramme moins celle de l'en-tête.
+
+#define FRAG_MAGIC_0 'P'
+#define FRAG_MAGIC_1 'S'
+#define FRAG_VERSION 1
+
+// Flags de l'en-tête
+#define FRAG_FLAG_LAST 0x01  // Dernier fragment du transfert
+#define FRAG_FLAG_CRC  0x02  // CRC32C du datagramme (en-tête + données) présent
+#define FRAG_FLAG_EXT  0x80  // Des extensions suivent les champs fixes
+
+// Types d'extensions (les types inconnus sont ignorés au décodage)
+#define FRAG_EXT_END      0
+#define FRAG_EXT_FILENAME 1  // Nom du fichier, envoyé uniquement dans le premier fragment
+#define FRAG_EXT_IMAGE_CRC 2 // CRC32C de l'objet complet, envoyé dans le dernier fragment
+#define FRAG_EXT_COMPRESSION 3 // Algorithme (1 octet) + taille d'origine (varint), dernier fragment
+#define FRAG_EXT_CAPTURE_TIME 4 // Date de capture de la frame (8 octets), dans chaque fragment
+#define FRAG_EXT_STREAM_ID 5  // Flux (caméra) du fragment (1 octet), dans chaque fragment :
+                              // transfer_id est alors propre à chaque flux
+
+// Les dates de capture sont en microsecondes depuis l'epoch Unix (CLOCK_REALTIME) :
+// c'est l'horloge commune à l'émetteur et au récepteur, synchronisés par NTP ou PTP.
+// La latence de bout en bout est frag_clock_us() à la réception moins la date de capture.
+
+#define FRAG_MAX_FILENAME_LEN 255
+
+// Taille maximale d'un en-tête encodé sans extension (champs fixes + CRC + 5 varints)
+#define FRAG_HEADER_BASE_MAX_SIZE (4 + 4 + 5 * 5)
+// Taille maximale d'un en-tête encodé avec toutes les extensions
+#define FRAG_HEADER_MAX_SIZE (FRAG_HEADER_BASE_MAX_SIZE + (1 + 2 + FRAG_MAX_FILENAME_LEN) + \
+                              (1 + 1 + 4) + (1 + 1 + 1 + 5) + (1 + 1 + 8) + (1 + 1 + 1) + 1)
+
+// En-tête décodé
+typedef struct {
+    uint8_t version;
+    uint8_t flags;
+    uint32_t transfer_id;  // Identifiant du transfert (image, fichier, frame)
+    uint32_t seq_num;      // Numéro de séquence du fragment
+    uint32_t total_frags;  // Nombre total de fragments
+    uint32_t offset;       // Position des données dans l'objet transféré
+    uint32_t total_size;   // Taille totale de l'objet transféré
+    uint32_t frag_crc;     // CRC32C du datagramme, valide si FRAG_FLAG_CRC
+    const char *filename;  // Extension FILENAME (non terminée par '\0'), NULL si absente
+    uint8_t filename_len;
+    uint8_t has_image_crc; // Extension IMAGE_CRC présente
+    uint32_t image_crc;    // CRC32C de l'objet complet (avant compression)
+    uint8_t compression;   // Extension COMPRESSION : CompressionType, 0 si absente
+    uint32_t original_size; // Taille de l'objet avant compression
+    uint8_t has_capture_time; // Extension CAPTURE_TIME présente
+    uint64_t capture_time_us; // Date de capture (µs depuis l'epoch Unix)
+    uint8_t has_stream_id;    // Extension STREAM_ID présente
+    uint8_t stream_id;
+} FragmentHeader;
+
+// Encode l'en-tête dans buf, retourne le nombre d'octets écrits ou -1 si buf est trop petit
+int encode_fragment_header(const FragmentHeader *header, uint8_t *buf, size_t buf_size);
+
+// Décode l'en-tête depuis un datagramme, retourne la taille de l'en-tête ou -1 si invalide.
+// Les pointeurs d'extension pointent dans buf.
+int decode_fragment_header(FragmentHeader *header, const uint8_t *buf, size_t len);
+
+// Date courante dans l'horloge des dates de capture (µs depuis l'epoch Unix)
+uint64_t frag_clock_us(void);
+
+// Calcule et écrit le CRC32C d'un datagramme complet (en-tête encodé avec FRAG_FLAG_CRC + données)
+void seal_fragment_crc(uint8_t *packet, size_t len);
+
+// Idem quand l'en-tête encodé et les données sont dans deux buffers séparés (envoi par iovec)
+void seal_fragment_crc_split(uint8_t *header, size_t header_len, const uint8_t *data, size_t data_len);
+
+// Vérifie le CRC32C d'un datagramme, retourne 1 s'il est valide ou absent, 0 s'il est corrompu
+int check_fragment_crc(const uint8_t *packet, size_t len);
+
+#endif // COM_UDP_H
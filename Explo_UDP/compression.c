@@ -0,0 +1,162 @@
+#include "compression.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define ZSTD_LEVEL 3  // Bon compromis vitesse / ratio sur le Raspberry Pi
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int parse_compression(const char *name) {
+    if (strcmp(name, "none") == 0) return COMPRESSION_NONE;
+    if (strcmp(name, "lz4") == 0) return COMPRESSION_LZ4;
+    if (strcmp(name, "zstd") == 0) return COMPRESSION_ZSTD;
+    return -1;
+}
+
+const char *compression_name(CompressionType type) {
+    switch (type) {
+        case COMPRESSION_LZ4: return "lz4";
+        case COMPRESSION_ZSTD: return "zstd";
+        default: return "none";
+    }
+}
+
+int compression_supported(CompressionType type) {
+    switch (type) {
+        case COMPRESSION_NONE: return 1;
+#ifdef HAVE_LZ4
+        case COMPRESSION_LZ4: return 1;
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESSION_ZSTD: return 1;
+#endif
+        default: return 0;
+    }
+}
+
+// Reconnaît les formats déjà compressés à leurs premiers octets
+static int is_already_compressed(const uint8_t *d, size_t len) {
+    if (len >= 3 && d[0] == 0xFF && d[1] == 0xD8 && d[2] == 0xFF) return 1;              // JPEG
+    if (len >= 8 && memcmp(d, "\x89PNG\r\n\x1a\n", 8) == 0) return 1;                   // PNG
+    if (len >= 4 && d[0] == 0 && d[1] == 0 && (d[2] == 1 || (d[2] == 0 && d[3] == 1))) return 1; // H.264 Annex B
+    if (len >= 8 && memcmp(d + 4, "ftyp", 4) == 0) return 1;                            // MP4
+    if (len >= 2 && d[0] == 0x1F && d[1] == 0x8B) return 1;                             // gzip
+    if (len >= 4 && memcmp(d, "\x28\xB5\x2F\xFD", 4) == 0) return 1;                    // zstd
+    if (len >= 4 && memcmp(d, "\x04\x22\x4D\x18", 4) == 0) return 1;                    // lz4
+    return 0;
+}
+
+CompressionType choose_compression(const uint8_t *data, size_t len, CompressionType wanted) {
+    if (wanted == COMPRESSION_NONE || !compression_supported(wanted)) return COMPRESSION_NONE;
+    if (is_already_compressed(data, len)) return COMPRESSION_NONE;
+    return wanted;
+}
+
+int compress_buffer(CompressionType type, const uint8_t *data, size_t len,
+                    uint8_t **out, size_t *out_len, CompressionStats *stats) {
+    size_t bound;
+    switch (type) {
+#ifdef HAVE_LZ4
+        case COMPRESSION_LZ4: bound = LZ4_compressBound(len); break;
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESSION_ZSTD: bound = ZSTD_compressBound(len); break;
+#endif
+        default: return -1;
+    }
+    if (bound == 0) return -1;
+
+    uint8_t *dst = malloc(bound);
+    if (!dst) return -1;
+
+    double start = now_ms();
+    size_t result = 0;
+    switch (type) {
+#ifdef HAVE_LZ4
+        case COMPRESSION_LZ4: {
+            int n = LZ4_compress_default((const char *)data, (char *)dst, (int)len, (int)bound);
+            result = n > 0 ? (size_t)n : 0;
+            break;
+        }
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESSION_ZSTD: {
+            size_t n = ZSTD_compress(dst, bound, data, len, ZSTD_LEVEL);
+            result = ZSTD_isError(n) ? 0 : n;
+            break;
+        }
+#endif
+        default: break;
+    }
+    double elapsed = now_ms() - start;
+
+    if (stats) {
+        stats->type = type;
+        stats->original_size = len;
+        stats->compressed_size = result ? result : len;
+        stats->elapsed_ms = elapsed;
+    }
+
+    // Pas de gain : on envoie les données d'origine
+    if (result == 0 || result >= len) {
+        free(dst);
+        return -1;
+    }
+
+    *out = dst;
+    *out_len = result;
+    return 0;
+}
+
+int decompress_buffer(CompressionType type, const uint8_t *data, size_t len,
+                      uint8_t *out, size_t original_size, CompressionStats *stats) {
+    double start = now_ms();
+    int ok = 0;
+    switch (type) {
+#ifdef HAVE_LZ4
+        case COMPRESSION_LZ4:
+            ok = LZ4_decompress_safe((const char *)data, (char *)out, (int)len, (int)original_size)
+                 == (int)original_size;
+            break;
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESSION_ZSTD: {
+            size_t n = ZSTD_decompress(out, original_size, data, len);
+            ok = !ZSTD_isError(n) && n == original_size;
+            break;
+        }
+#endif
+        default:
+            break;
+    }
+
+    if (stats) {
+        stats->type = type;
+        stats->original_size = original_size;
+        stats->compressed_size = len;
+        stats->elapsed_ms = now_ms() - start;
+    }
+    return ok ? 0 : -1;
+}
+
+void print_compression_stats(const char *label, const CompressionStats *stats) {
+    double ratio = stats->compressed_size ? (double)stats->original_size / stats->compressed_size : 0.0;
+    double mb_per_s = stats->elapsed_ms > 0 ? stats->original_size / 1e3 / stats->elapsed_ms : 0.0;
+    printf("%s [%s] %zu -> %zu octets (ratio %.2f), %.2f ms (%.1f Mo/s)\n",
+           label, compression_name(stats->type), stats->original_size, stats->compressed_size,
+           ratio, stats->elapsed_ms, mb_per_s);
+}
@@ -0,0 +1,50 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Étape de compression optionnelle appliquée à un transfert complet avant la
+// fragmentation. LZ4 (rapide) et zstd (meilleur ratio) sont disponibles si le
+// programme est compilé avec HAVE_LZ4 / HAVE_ZSTD (détectés par les Makefiles).
+
+typedef enum {
+    COMPRESSION_NONE = 0,
+    COMPRESSION_LZ4 = 1,
+    COMPRESSION_ZSTD = 2,
+} CompressionType;
+
+// Statistiques d'un transfert compressé
+typedef struct {
+    CompressionType type;
+    size_t original_size;
+    size_t compressed_size;
+    double elapsed_ms;   // Temps de compression ou de décompression
+} CompressionStats;
+
+// Convertit "none", "lz4" ou "zstd" en type, retourne -1 si inconnu
+int parse_compression(const char *name);
+
+const char *compression_name(CompressionType type);
+
+// Indique si l'algorithme est disponible dans ce binaire
+int compression_supported(CompressionType type);
+
+// Retourne COMPRESSION_NONE pour les formats déjà compressés (JPEG, PNG, H.264, MP4,
+// gzip, zstd, lz4) ou si l'algorithme demandé n'est pas disponible, sinon wanted
+CompressionType choose_compression(const uint8_t *data, size_t len, CompressionType wanted);
+
+// Compresse data dans un buffer alloué (*out, à libérer avec free()).
+// Retourne 0 si la compression est utile, -1 sinon (erreur ou gain nul) : le
+// transfert doit alors se faire sans compression.
+int compress_buffer(CompressionType type, const uint8_t *data, size_t len,
+                    uint8_t **out, size_t *out_len, CompressionStats *stats);
+
+// Décompresse exactement original_size octets dans out, retourne 0 ou -1 si erreur
+int decompress_buffer(CompressionType type, const uint8_t *data, size_t len,
+                      uint8_t *out, size_t original_size, CompressionStats *stats);
+
+// Affiche ratio et débit d'un transfert
+void print_compression_stats(const char *label, const CompressionStats *stats);
+
+#endif // COMPRESSION_H
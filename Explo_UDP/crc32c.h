@@ -0,0 +1,24 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC32C (Castagnoli) utilisé pour vérifier les fragments et les images reçues.
+// Utilise les instructions SSE4.2 (x86) ou CRC32 ARMv8 (Raspberry Pi) quand le
+// processeur les supporte, sinon une version par tables.
+
+// Calcule le CRC32C d'un buffer
+uint32_t crc32c(const void *data, size_t len);
+
+// Continue un calcul de CRC32C : crc32c_update(crc32c(a), b) == crc32c(a + b).
+// Un calcul commence avec crc = 0.
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t len);
+
+// Même calcul en forçant la version logicielle par tables (repli, comparaison des performances)
+uint32_t crc32c_update_sw(uint32_t crc, const void *data, size_t len);
+
+// Nom de l'implémentation choisie au démarrage ("sse4.2", "armv8" ou "table")
+const char *crc32c_impl_name(void);
+
+#endif // CRC32C_H
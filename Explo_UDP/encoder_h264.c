@@ -0,0 +1,310 @@
+#include "encoder_h264.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <linux/videodev2.h>
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+
+// Encodeurs essayés dans l'ordre : matériel du Raspberry Pi puis logiciel
+static const char *encoder_names[] = { "h264_v4l2m2m", "libx264" };
+
+// Dates de capture des frames en cours d'encodage, indexées par pts
+#define CAPTURE_TIMES 32
+
+// Lien entre une frame donnée à l'encodeur et le buffer de capture à rendre
+typedef struct {
+    H264Encoder *enc;
+    CaptureBuffer *buffer;
+} FrameRef;
+
+struct H264Encoder {
+    CaptureDevice *dev;
+    AVCodecContext *ctx;
+    AVFormatContext *out;
+    AVStream *stream;
+    AVPacket *pkt;
+    AVFrame *frame;
+    AVFrame *converted;        // NULL si l'encodeur prend directement le YUYV
+    struct SwsContext *sws;
+    FrameRef refs[CAPTURE_MAX_BUFFERS];
+    uint64_t capture_us[CAPTURE_TIMES];
+    EncoderPacketCallback callback;
+    void *callback_opaque;
+    int64_t next_pts;
+    int ready;                 // Encodeur et sortie ouverts
+    int header_written;
+    EncoderStats stats;
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Appelée par libavcodec quand l'encodeur n'utilise plus la frame
+static void release_capture_buffer(void *opaque, uint8_t *data) {
+    FrameRef *ref = (FrameRef *)opaque;
+    capture_release(ref->enc->dev, ref->buffer);
+}
+
+static int supports_pix_fmt(const AVCodec *codec, enum AVPixelFormat pix_fmt) {
+    for (const enum AVPixelFormat *p = codec->pix_fmts; p && *p != AV_PIX_FMT_NONE; p++) {
+        if (*p == pix_fmt) return 1;
+    }
+    return 0;
+}
+
+static AVCodecContext *open_codec(const char *name, CaptureDevice *dev, int fps, int bitrate) {
+    const AVCodec *codec = avcodec_find_encoder_by_name(name);
+    if (codec == NULL) return NULL;
+
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    if (ctx == NULL) return NULL;
+
+    ctx->width = dev->width;
+    ctx->height = dev->height;
+    ctx->time_base = (AVRational){1, fps};
+    ctx->framerate = (AVRational){fps, 1};
+    ctx->bit_rate = bitrate;
+    ctx->gop_size = fps;
+    ctx->max_b_frames = 0;  // Pas de B-frames : chaque frame sort dès qu'elle est encodée
+    ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    ctx->pix_fmt = supports_pix_fmt(codec, AV_PIX_FMT_YUYV422) ? AV_PIX_FMT_YUYV422 : AV_PIX_FMT_YUV420P;
+
+    if (strcmp(name, "libx264") == 0) {
+        av_opt_set(ctx->priv_data, "preset", "ultrafast", 0);
+        av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+    }
+
+    if (avcodec_open2(ctx, codec, NULL) < 0) {
+        avcodec_free_context(&ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+// Envoie sur la sortie tous les paquets disponibles, retourne leur taille totale
+static int write_packets(H264Encoder *enc) {
+    int size = 0;
+    while (1) {
+        int ret = avcodec_receive_packet(enc->ctx, enc->pkt);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
+        if (ret < 0) return -1;
+
+        size += enc->pkt->size;
+
+        // Le pts du paquet est celui de la frame encodée (pas de B-frames)
+        if (enc->pkt->pts != AV_NOPTS_VALUE) {
+            enc->stats.last_capture_us = enc->capture_us[enc->pkt->pts % CAPTURE_TIMES];
+        }
+        if (enc->callback) {
+            enc->callback(enc->pkt->data, enc->pkt->size, enc->stats.last_capture_us,
+                          enc->callback_opaque);
+        }
+        if (enc->out == NULL) {
+            av_packet_unref(enc->pkt);
+            continue;
+        }
+
+        av_packet_rescale_ts(enc->pkt, enc->ctx->time_base, enc->stream->time_base);
+        enc->pkt->stream_index = enc->stream->index;
+        ret = av_write_frame(enc->out, enc->pkt);
+        av_packet_unref(enc->pkt);
+        if (ret < 0) return -1;
+    }
+    return size;
+}
+
+H264Encoder *encoder_open(CaptureDevice *dev, int fps, int bitrate, const char *output_url) {
+    if (dev->pixelformat != V4L2_PIX_FMT_YUYV) {
+        printf("Format de capture non supporté par l'encodeur (YUYV attendu)\n");
+        return NULL;
+    }
+
+    H264Encoder *enc = calloc(1, sizeof(H264Encoder));
+    if (enc == NULL) return NULL;
+    enc->dev = dev;
+
+    avformat_network_init();
+    if (output_url && avformat_alloc_output_context2(&enc->out, NULL, "mpegts", output_url) < 0) {
+        printf("Erreur de création de la sortie %s\n", output_url);
+        encoder_close(enc);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sizeof(encoder_names) / sizeof(encoder_names[0]) && !enc->ctx; i++) {
+        enc->ctx = open_codec(encoder_names[i], dev, fps, bitrate);
+    }
+    if (enc->ctx == NULL) {
+        printf("Aucun encodeur H.264 disponible\n");
+        encoder_close(enc);
+        return NULL;
+    }
+
+    enc->pkt = av_packet_alloc();
+    enc->frame = av_frame_alloc();
+    if (enc->pkt == NULL || enc->frame == NULL) {
+        encoder_close(enc);
+        return NULL;
+    }
+
+    // Conversion YUYV -> YUV420P si l'encodeur ne prend pas le YUYV
+    if (enc->ctx->pix_fmt != AV_PIX_FMT_YUYV422) {
+        enc->converted = av_frame_alloc();
+        enc->sws = sws_getContext(dev->width, dev->height, AV_PIX_FMT_YUYV422,
+                                  dev->width, dev->height, AV_PIX_FMT_YUV420P,
+                                  SWS_FAST_BILINEAR, NULL, NULL, NULL);
+        if (enc->converted == NULL || enc->sws == NULL) {
+            encoder_close(enc);
+            return NULL;
+        }
+        enc->converted->format = AV_PIX_FMT_YUV420P;
+        enc->converted->width = dev->width;
+        enc->converted->height = dev->height;
+        if (av_frame_get_buffer(enc->converted, 0) < 0) {
+            encoder_close(enc);
+            return NULL;
+        }
+    }
+
+    printf("Encodeur %s (%s) -> %s\n", enc->ctx->codec->name,
+           av_get_pix_fmt_name(enc->ctx->pix_fmt), output_url ? output_url : "callback");
+    if (output_url == NULL) {
+        enc->ready = 1;
+        return enc;
+    }
+
+    enc->stream = avformat_new_stream(enc->out, NULL);
+    if (enc->stream == NULL ||
+        avcodec_parameters_from_context(enc->stream->codecpar, enc->ctx) < 0) {
+        encoder_close(enc);
+        return NULL;
+    }
+    enc->stream->time_base = enc->ctx->time_base;
+
+    if (!(enc->out->oformat->flags & AVFMT_NOFILE) &&
+        avio_open(&enc->out->pb, output_url, AVIO_FLAG_WRITE) < 0) {
+        printf("Erreur d'ouverture de %s\n", output_url);
+        encoder_close(enc);
+        return NULL;
+    }
+    if (avformat_write_header(enc->out, NULL) < 0) {
+        printf("Erreur d'écriture de l'en-tête MPEG-TS\n");
+        encoder_close(enc);
+        return NULL;
+    }
+    enc->header_written = 1;
+    enc->ready = 1;
+    return enc;
+}
+
+void encoder_set_packet_callback(H264Encoder *enc, EncoderPacketCallback callback, void *opaque) {
+    enc->callback = callback;
+    enc->callback_opaque = opaque;
+}
+
+int encoder_encode(H264Encoder *enc, CaptureBuffer *buffer) {
+    double start = now_ms();
+    AVFrame *frame;
+
+    // Date de capture lue avant que le buffer puisse être rendu au driver
+    enc->capture_us[enc->next_pts % CAPTURE_TIMES] = capture_epoch_us(capture_frame_time_ms(buffer));
+
+    if (enc->converted) {
+        // L'encodeur peut encore référencer la frame précédente
+        if (av_frame_make_writable(enc->converted) < 0) {
+            capture_release(enc->dev, buffer);
+            return -1;
+        }
+        const uint8_t *src[1] = { buffer->start };
+        int src_stride[1] = { (int)enc->dev->bytesperline };
+        sws_scale(enc->sws, src, src_stride, 0, enc->dev->height,
+                  enc->converted->data, enc->converted->linesize);
+        capture_release(enc->dev, buffer);
+        frame = enc->converted;
+    } else {
+        // Frame passée par référence : rendue au driver quand l'encodeur la libère
+        FrameRef *ref = &enc->refs[buffer->index];
+        ref->enc = enc;
+        ref->buffer = buffer;
+        frame = enc->frame;
+        frame->buf[0] = av_buffer_create(buffer->start, buffer->length, release_capture_buffer,
+                                         ref, AV_BUFFER_FLAG_READONLY);
+        if (frame->buf[0] == NULL) {
+            capture_release(enc->dev, buffer);
+            return -1;
+        }
+        frame->data[0] = buffer->start;
+        frame->linesize[0] = enc->dev->bytesperline;
+        frame->format = AV_PIX_FMT_YUYV422;
+        frame->width = enc->dev->width;
+        frame->height = enc->dev->height;
+    }
+
+    frame->pts = enc->next_pts++;
+    int ret = avcodec_send_frame(enc->ctx, frame);
+    if (frame == enc->frame) {
+        // L'encodeur garde sa propre référence s'il en a besoin
+        av_frame_unref(frame);
+    }
+    if (ret < 0) {
+        printf("Erreur d'envoi de la frame à l'encodeur\n");
+        return -1;
+    }
+
+    int size = write_packets(enc);
+    if (size < 0) {
+        printf("Erreur d'écriture du flux H.264\n");
+        return -1;
+    }
+
+    // Métriques par frame
+    EncoderStats *stats = &enc->stats;
+    stats->last_ms = now_ms() - start;
+    stats->last_size = size;
+    stats->frames++;
+    stats->bytes += size;
+    stats->total_ms += stats->last_ms;
+    if (stats->last_ms > stats->max_ms) stats->max_ms = stats->last_ms;
+    return 0;
+}
+
+void encoder_close(H264Encoder *enc) {
+    if (enc == NULL) return;
+
+    // Vider l'encodeur : les dernières frames référencées sont rendues au driver
+    if (enc->ready) {
+        avcodec_send_frame(enc->ctx, NULL);
+        write_packets(enc);
+    }
+    if (enc->header_written) {
+        av_write_trailer(enc->out);
+    }
+
+    avcodec_free_context(&enc->ctx);
+    if (enc->out) {
+        if (!(enc->out->oformat->flags & AVFMT_NOFILE)) avio_closep(&enc->out->pb);
+        avformat_free_context(enc->out);
+    }
+    sws_freeContext(enc->sws);
+    av_frame_free(&enc->converted);
+    av_frame_free(&enc->frame);
+    av_packet_free(&enc->pkt);
+    free(enc);
+}
+
+const char *encoder_name(const H264Encoder *enc) {
+    return enc->ctx->codec->name;
+}
+
+const EncoderStats *encoder_stats(const H264Encoder *enc) {
+    return &enc->stats;
+}
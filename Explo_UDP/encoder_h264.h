@@ -0,0 +1,54 @@
+#ifndef ENCODER_H264_H
+#define ENCODER_H264_H
+
+#include <stdint.h>
+
+#include "capture_v4l2.h"
+
+// Encodeur H.264 intégré (libavcodec) qui remplace le ffmpeg lancé par popen.
+// L'encodeur matériel V4L2 M2M du Raspberry Pi (h264_v4l2m2m) est utilisé s'il
+// est présent, sinon libx264 en preset ultrafast / tune zerolatency. Le flux est
+// envoyé en MPEG-TS sur UDP comme le faisait la ligne de commande ffmpeg.
+//
+// Si l'encodeur accepte le YUYV, la frame lui est passée par référence : le
+// buffer de capture n'est rendu au driver (capture_release) que lorsque
+// l'encodeur libère la frame. Sinon la frame est convertie en YUV420P et le
+// buffer est rendu tout de suite après la conversion.
+//
+// La date de capture de chaque frame (horloge commune, voir capture_epoch_us)
+// suit la frame dans l'encodeur et est rendue avec chaque paquet H.264 produit.
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;          // Taille totale du flux H.264 produit
+    double last_ms;          // Temps d'encodage de la dernière frame
+    double total_ms;
+    double max_ms;
+    int last_size;           // Taille des paquets produits pour la dernière frame
+
+    uint64_t last_capture_us; // Date de capture de la frame du dernier paquet
+} EncoderStats;
+
+typedef struct H264Encoder H264Encoder;
+
+// Appelée pour chaque paquet H.264 (une frame encodée) avec sa date de capture
+typedef void (*EncoderPacketCallback)(const uint8_t *data, int size, uint64_t capture_us, void *opaque);
+
+// Ouvre l'encodeur et la sortie MPEG-TS (ex. "udp://192.168.1.1:12345"), NULL en cas
+// d'erreur. Sans output_url, les paquets ne sont remis qu'au callback.
+H264Encoder *encoder_open(CaptureDevice *dev, int fps, int bitrate, const char *output_url);
+
+// Les paquets sont passés au callback avant d'être écrits dans la sortie
+void encoder_set_packet_callback(H264Encoder *enc, EncoderPacketCallback callback, void *opaque);
+
+// Encode une frame acquise ; l'encodeur devient responsable de son capture_release()
+int encoder_encode(H264Encoder *enc, CaptureBuffer *frame);
+
+// Vide l'encodeur, termine le flux et libère tout
+void encoder_close(H264Encoder *enc);
+
+const char *encoder_name(const H264Encoder *enc);
+
+const EncoderStats *encoder_stats(const H264Encoder *enc);
+
+#endif // ENCODER_H264_H
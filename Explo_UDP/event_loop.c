@@ -0,0 +1,128 @@
+#include "event_loop.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/timerfd.h>
+
+int event_loop_init(EventLoop *loop) {
+    memset(loop, 0, sizeof(*loop));
+    for (int i = 0; i < EVENT_MAX_SOURCES; i++) {
+        loop->sources[i].fd = -1;
+    }
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epfd == -1) {
+        perror("Erreur de création de la boucle d'événements");
+        return -1;
+    }
+    return 0;
+}
+
+static EventSource *find_source(EventLoop *loop, int fd) {
+    for (int i = 0; i < EVENT_MAX_SOURCES; i++) {
+        if (loop->sources[i].fd == fd) return &loop->sources[i];
+    }
+    return NULL;
+}
+
+int event_loop_add(EventLoop *loop, int fd, uint32_t events, EventCallback callback, void *opaque) {
+    // Emplacement libre : les adresses des sources restent fixes pour epoll
+    EventSource *source = find_source(loop, -1);
+    if (source == NULL) {
+        printf("Trop de descripteurs dans la boucle d'événements\n");
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = source;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        perror("Erreur d'ajout à la boucle d'événements");
+        return -1;
+    }
+
+    source->fd = fd;
+    source->is_timer = 0;
+    source->callback = callback;
+    source->opaque = opaque;
+    return 0;
+}
+
+int event_loop_remove(EventLoop *loop, int fd) {
+    EventSource *source = find_source(loop, fd);
+    if (fd < 0 || source == NULL) return -1;
+
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+    // Le timerfd a été créé par la boucle, personne d'autre ne le fermera
+    if (source->is_timer) close(fd);
+    source->fd = -1;
+    source->is_timer = 0;
+    return 0;
+}
+
+int event_loop_add_timer(EventLoop *loop, int interval_ms, EventCallback callback, void *opaque) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd == -1) {
+        perror("Erreur de création du timer");
+        return -1;
+    }
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(fd, 0, &spec, NULL) == -1 ||
+        event_loop_add(loop, fd, EPOLLIN, callback, opaque) == -1) {
+        perror("Erreur de configuration du timer");
+        close(fd);
+        return -1;
+    }
+    find_source(loop, fd)->is_timer = 1;
+    return fd;
+}
+
+int event_loop_run(EventLoop *loop) {
+    struct epoll_event events[EVENT_MAX_SOURCES];
+    loop->running = 1;
+
+    while (loop->running) {
+        int n = epoll_wait(loop->epfd, events, EVENT_MAX_SOURCES, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("Erreur d'attente des événements");
+            return -1;
+        }
+        loop->wakeups++;
+
+        for (int i = 0; i < n && loop->running; i++) {
+            EventSource *source = (EventSource *)events[i].data.ptr;
+            // Source retirée par un callback précédent de ce tour
+            if (source->fd < 0) continue;
+
+            if (source->is_timer) {
+                uint64_t expirations;
+                if (read(source->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+            }
+            loop->dispatched++;
+            source->callback(source->fd, events[i].events, source->opaque);
+        }
+    }
+    return 0;
+}
+
+void event_loop_stop(EventLoop *loop) {
+    loop->running = 0;
+}
+
+void event_loop_close(EventLoop *loop) {
+    for (int i = 0; i < EVENT_MAX_SOURCES; i++) {
+        EventSource *source = &loop->sources[i];
+        if (source->fd >= 0 && source->is_timer) close(source->fd);
+        source->fd = -1;
+    }
+    if (loop->epfd >= 0) close(loop->epfd);
+    loop->epfd = -1;
+}
@@ -0,0 +1,51 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+// Boucle d'événements epoll : un seul thread sert les caméras (capture en
+// O_NONBLOCK), les sockets, l'entrée standard et des timers (timerfd), sans
+// attente active. Chaque descripteur est associé à un callback appelé quand il
+// est prêt ; le callback doit lire tout ce qui est disponible (mode niveau).
+
+#define EVENT_MAX_SOURCES 32
+
+typedef void (*EventCallback)(int fd, uint32_t events, void *opaque);
+
+typedef struct {
+    int fd;                 // -1 si l'emplacement est libre
+    int is_timer;           // timerfd géré par la boucle
+    EventCallback callback;
+    void *opaque;
+} EventSource;
+
+typedef struct {
+    int epfd;
+    int running;
+    EventSource sources[EVENT_MAX_SOURCES];
+    uint64_t wakeups;       // Retours de epoll_wait
+    uint64_t dispatched;    // Callbacks appelés
+} EventLoop;
+
+int event_loop_init(EventLoop *loop);
+
+// Surveille fd (EPOLLIN, EPOLLOUT...), retourne -1 en cas d'erreur
+int event_loop_add(EventLoop *loop, int fd, uint32_t events, EventCallback callback, void *opaque);
+
+// Ne ferme pas le descripteur, sauf pour un timer créé par event_loop_add_timer()
+int event_loop_remove(EventLoop *loop, int fd);
+
+// Timer périodique, retourne le descripteur du timer ou -1
+int event_loop_add_timer(EventLoop *loop, int interval_ms, EventCallback callback, void *opaque);
+
+// Traite les événements jusqu'à event_loop_stop(), retourne -1 en cas d'erreur
+int event_loop_run(EventLoop *loop);
+
+// Peut être appelée depuis un callback
+void event_loop_stop(EventLoop *loop);
+
+// Ferme epoll et les timers (les autres descripteurs restent à l'appelant)
+void event_loop_close(EventLoop *loop);
+
+#endif // EVENT_LOOP_H
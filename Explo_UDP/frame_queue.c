@@ -0,0 +1,177 @@
+#include "frame_queue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+// Attente maximale d'une frame avant de revérifier l'arrêt de la file
+#define CAPTURE_WAIT_MS 100
+
+int parse_frame_policy(const char *name) {
+    if (strcmp(name, "drop-oldest") == 0) return FRAME_DROP_OLDEST;
+    if (strcmp(name, "drop-newest") == 0) return FRAME_DROP_NEWEST;
+    if (strcmp(name, "block") == 0) return FRAME_BLOCK;
+    return -1;
+}
+
+const char *frame_policy_name(FramePolicy policy) {
+    switch (policy) {
+        case FRAME_DROP_NEWEST: return "drop-newest";
+        case FRAME_BLOCK: return "block";
+        default: return "drop-oldest";
+    }
+}
+
+void frame_queue_init(FrameQueue *q, CaptureDevice *dev, unsigned int depth, FramePolicy policy) {
+    memset(q, 0, sizeof(*q));
+    q->dev = dev;
+    q->policy = policy;
+
+    // Un buffer pour l'aval, au moins un dans la file du driver
+    unsigned int max_depth = dev->n_buffers > 2 ? dev->n_buffers - 2 : 1;
+    q->capacity = depth < 1 ? 1 : (depth > max_depth ? max_depth : depth);
+    q->stats.min_driver_depth = dev->n_buffers;
+
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+}
+
+// Retire la frame la plus ancienne (verrou tenu)
+static CaptureBuffer *take_oldest(FrameQueue *q) {
+    CaptureBuffer *frame = q->frames[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    return frame;
+}
+
+// Thread de capture : sort les frames du driver et applique la politique
+static void *capture_thread(void *arg) {
+    FrameQueue *q = (FrameQueue *)arg;
+
+    while (1) {
+        // Attente sans boucle active ; le timeout rend frame_queue_stop() réactif
+        CaptureBuffer *frame = NULL;
+        int ready = capture_wait(q->dev, CAPTURE_WAIT_MS);
+        if (ready > 0) {
+            frame = capture_acquire(q->dev);
+            if (frame == NULL && errno == EAGAIN) continue;
+        } else if (ready == 0) {
+            pthread_mutex_lock(&q->lock);
+            int running = q->running;
+            pthread_mutex_unlock(&q->lock);
+            if (running) continue;
+        }
+
+        pthread_mutex_lock(&q->lock);
+        if (!q->running || frame == NULL) {
+            q->running = 0;
+            pthread_cond_broadcast(&q->not_empty);
+            pthread_mutex_unlock(&q->lock);
+            if (frame) capture_release(q->dev, frame);
+            break;
+        }
+        q->stats.captured++;
+
+        unsigned int driver_depth = q->dev->n_buffers - q->dev->owned_count;
+        if (driver_depth < q->stats.min_driver_depth) q->stats.min_driver_depth = driver_depth;
+
+        CaptureBuffer *dropped = NULL;
+        if (q->count == q->capacity) {
+            if (q->policy == FRAME_DROP_OLDEST) {
+                dropped = take_oldest(q);
+            } else if (q->policy == FRAME_DROP_NEWEST) {
+                dropped = frame;
+                frame = NULL;
+            } else {
+                while (q->running && q->count == q->capacity) {
+                    pthread_cond_wait(&q->not_full, &q->lock);
+                }
+            }
+        }
+        if (frame && q->running) {
+            q->frames[(q->head + q->count) % q->capacity] = frame;
+            q->count++;
+            if (q->count > q->stats.max_depth) q->stats.max_depth = q->count;
+            pthread_cond_signal(&q->not_empty);
+        } else if (frame) {
+            dropped = frame;  // Arrêt pendant l'attente (FRAME_BLOCK)
+        }
+        if (dropped) q->stats.dropped++;
+        pthread_mutex_unlock(&q->lock);
+
+        // La frame abandonnée est recyclée tout de suite par le driver
+        if (dropped) capture_release(q->dev, dropped);
+    }
+    return NULL;
+}
+
+int frame_queue_start(FrameQueue *q) {
+    q->running = 1;
+    if (pthread_create(&q->thread, NULL, capture_thread, q) != 0) {
+        perror("Erreur lors de la création du thread de capture");
+        q->running = 0;
+        return -1;
+    }
+    q->started = 1;
+    return 0;
+}
+
+CaptureBuffer *frame_queue_pop(FrameQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    while (q->running && q->count == 0) {
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+    CaptureBuffer *frame = NULL;
+    if (q->count > 0) {
+        frame = take_oldest(q);
+        q->stats.delivered++;
+        double wait_ms = capture_now_ms() - frame->dequeue_ms;
+        q->stats.wait_total_ms += wait_ms;
+        if (wait_ms > q->stats.wait_max_ms) q->stats.wait_max_ms = wait_ms;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return frame;
+}
+
+void frame_queue_sent(FrameQueue *q, double captured_ms) {
+    double latency_ms = capture_now_ms() - captured_ms;
+
+    pthread_mutex_lock(&q->lock);
+    q->stats.sent++;
+    q->stats.glass_to_wire_last_ms = latency_ms;
+    q->stats.glass_to_wire_total_ms += latency_ms;
+    if (latency_ms > q->stats.glass_to_wire_max_ms) q->stats.glass_to_wire_max_ms = latency_ms;
+    pthread_mutex_unlock(&q->lock);
+}
+
+void frame_queue_stop(FrameQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->running = 0;
+    pthread_cond_broadcast(&q->not_full);
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+
+    // Le thread sort au plus tard après CAPTURE_WAIT_MS
+    if (q->started) pthread_join(q->thread, NULL);
+    q->started = 0;
+
+    while (q->count > 0) {
+        capture_release(q->dev, take_oldest(q));
+    }
+}
+
+void frame_queue_print_stats(const FrameQueue *q) {
+    const FrameQueueStats *s = &q->stats;
+    printf("Capture [%s, profondeur %u]: %llu frames, %llu traitées, %llu perdues\n",
+           frame_policy_name(q->policy), q->capacity, (unsigned long long)s->captured,
+           (unsigned long long)s->delivered, (unsigned long long)s->dropped);
+    printf("  File: profondeur max %u, attente moyenne %.2f ms (max %.2f ms), buffers driver min %u\n",
+           s->max_depth, s->delivered ? s->wait_total_ms / s->delivered : 0.0, s->wait_max_ms,
+           s->min_driver_depth);
+    if (s->sent > 0) {
+        printf("  Glass-to-wire: moyenne %.2f ms, max %.2f ms\n",
+               s->glass_to_wire_total_ms / s->sent, s->glass_to_wire_max_ms);
+    }
+}
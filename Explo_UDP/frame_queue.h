@@ -0,0 +1,77 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "capture_v4l2.h"
+
+// File de frames entre le thread de capture et l'étape suivante (encodeur, envoi).
+// Quand l'étape suivante prend du retard, la politique choisit quoi faire :
+//   FRAME_DROP_OLDEST : la frame la plus ancienne est rendue au driver (la plus
+//                       récente gagne, latence minimale)
+//   FRAME_DROP_NEWEST : la nouvelle frame est rendue au driver
+//   FRAME_BLOCK       : la capture attend de la place (aucune perte, latence croissante)
+// Avec une profondeur de 1 et FRAME_DROP_OLDEST, l'aval reçoit toujours la dernière frame.
+
+typedef enum {
+    FRAME_DROP_OLDEST = 0,
+    FRAME_DROP_NEWEST,
+    FRAME_BLOCK,
+} FramePolicy;
+
+typedef struct {
+    uint64_t captured;         // Frames sorties du driver
+    uint64_t delivered;        // Frames données à l'aval
+    uint64_t dropped;          // Frames rendues au driver sans être traitées
+    unsigned int max_depth;    // Profondeur maximale atteinte par la file
+    unsigned int min_driver_depth;  // Buffers minimum restés dans la file du driver
+    double wait_total_ms;      // Temps passé dans la file
+    double wait_max_ms;
+    uint64_t sent;             // Frames signalées envoyées (frame_queue_sent)
+    double glass_to_wire_total_ms;
+    double glass_to_wire_max_ms;
+    double glass_to_wire_last_ms;
+} FrameQueueStats;
+
+typedef struct {
+    CaptureDevice *dev;
+    FramePolicy policy;
+    CaptureBuffer *frames[CAPTURE_MAX_BUFFERS];
+    unsigned int capacity;
+    unsigned int head;
+    unsigned int count;
+    int running;
+    int started;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    FrameQueueStats stats;
+} FrameQueue;
+
+// Convertit "drop-oldest", "drop-newest" ou "block", retourne -1 si inconnu
+int parse_frame_policy(const char *name);
+
+const char *frame_policy_name(FramePolicy policy);
+
+// La profondeur est limitée pour laisser au moins deux buffers au driver
+void frame_queue_init(FrameQueue *q, CaptureDevice *dev, unsigned int depth, FramePolicy policy);
+
+// Lance le thread de capture (la capture doit être démarrée)
+int frame_queue_start(FrameQueue *q);
+
+// Attend la prochaine frame, NULL une fois la file arrêtée et vide.
+// Le buffer retourné doit être rendu avec capture_release().
+CaptureBuffer *frame_queue_pop(FrameQueue *q);
+
+// À appeler quand la frame est partie sur le réseau : mesure glass-to-wire.
+// captured_ms vient de capture_frame_time_ms(), lu avant de rendre le buffer.
+void frame_queue_sent(FrameQueue *q, double captured_ms);
+
+// Arrête le thread de capture (au plus 100 ms d'attente) et rend au driver les frames encore en file
+void frame_queue_stop(FrameQueue *q);
+
+void frame_queue_print_stats(const FrameQueue *q);
+
+#endif // FRAME_QUEUE_H
@@ -0,0 +1,37 @@
+#include "latency.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+void latency_init(LatencyStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+double latency_update(LatencyStats *stats, uint64_t capture_us, uint64_t arrival_us) {
+    // Signé : négatif si les horloges ne sont pas synchronisées
+    double transit_ms = ((int64_t)(arrival_us - capture_us)) / 1000.0;
+
+    if (stats->frames == 0) {
+        stats->min_ms = transit_ms;
+        stats->max_ms = transit_ms;
+    } else {
+        stats->jitter_ms += (fabs(transit_ms - stats->last_ms) - stats->jitter_ms) / 16.0;
+        if (transit_ms < stats->min_ms) stats->min_ms = transit_ms;
+        if (transit_ms > stats->max_ms) stats->max_ms = transit_ms;
+    }
+    stats->frames++;
+    stats->last_ms = transit_ms;
+    stats->total_ms += transit_ms;
+    return transit_ms;
+}
+
+void latency_print(const LatencyStats *stats) {
+    if (stats->frames == 0) {
+        printf("Latence: aucune frame horodatée reçue\n");
+        return;
+    }
+    printf("Latence capture -> réception sur %llu frames: moyenne %.2f ms, min %.2f ms, "
+           "max %.2f ms, gigue %.2f ms\n", (unsigned long long)stats->frames,
+           stats->total_ms / stats->frames, stats->min_ms, stats->max_ms, stats->jitter_ms);
+}
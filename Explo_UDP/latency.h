@@ -0,0 +1,28 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// Mesure côté récepteur de la latence de bout en bout (capture -> réception) à partir
+// de la date de capture transportée dans l'en-tête (FRAG_EXT_CAPTURE_TIME).
+// La gigue est estimée comme dans RTP (RFC 3550) : moyenne glissante des écarts de
+// temps de transit entre deux frames successives. Elle ne dépend pas d'un éventuel
+// décalage constant entre les horloges de l'émetteur et du récepteur.
+
+typedef struct {
+    uint64_t frames;
+    double last_ms;        // Latence de la dernière frame
+    double total_ms;
+    double min_ms;
+    double max_ms;
+    double jitter_ms;
+} LatencyStats;
+
+void latency_init(LatencyStats *stats);
+
+// Ajoute une frame, retourne sa latence en ms
+double latency_update(LatencyStats *stats, uint64_t capture_us, uint64_t arrival_us);
+
+void latency_print(const LatencyStats *stats);
+
+#endif // LATENCY_H
@@ -0,0 +1,137 @@
+#include "resume.h"
+#include "crc32c.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define RESUME_MAGIC 0x50535253  // "PSRS"
+
+uint32_t make_transfer_id(const char *name, uint64_t size, int64_t mtime,
+                          uint32_t chunk_size, uint8_t compression) {
+    uint32_t id = crc32c(name, strlen(name));
+    id = crc32c_update(id, &size, sizeof(size));
+    id = crc32c_update(id, &mtime, sizeof(mtime));
+    id = crc32c_update(id, &chunk_size, sizeof(chunk_size));
+    return crc32c_update(id, &compression, sizeof(compression));
+}
+
+ResumeState *resume_open(const char *path, uint32_t transfer_id, uint32_t total_size,
+                         uint32_t total_frags, const char *filename, int *resumed) {
+    size_t bitmap_size = (total_frags + 7) / 8;
+    ResumeState *state = calloc(1, sizeof(ResumeState));
+    if (!state) return NULL;
+    state->bitmap = calloc(bitmap_size ? bitmap_size : 1, 1);
+    state->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (!state->bitmap || state->fd < 0) {
+        resume_close(state, NULL);
+        return NULL;
+    }
+
+    // Reprise d'un état existant s'il correspond au même transfert
+    *resumed = 0;
+    ResumeInfo info;
+    if (pread(state->fd, &info, sizeof(info), 0) == sizeof(info) &&
+        info.magic == RESUME_MAGIC && info.transfer_id == transfer_id &&
+        info.total_size == total_size && info.total_frags == total_frags &&
+        pread(state->fd, state->bitmap, bitmap_size, sizeof(info)) == (ssize_t)bitmap_size) {
+        state->info = info;
+        state->info.filename[FRAG_MAX_FILENAME_LEN] = '\0';
+        for (uint32_t i = 0; i < total_frags; i++) {
+            state->received_count += RESUME_BIT(state->bitmap, i);
+        }
+        *resumed = 1;
+        return state;
+    }
+
+    // Sinon nouvel état vide
+    memset(&state->info, 0, sizeof(state->info));
+    state->info.magic = RESUME_MAGIC;
+    state->info.transfer_id = transfer_id;
+    state->info.total_size = total_size;
+    state->info.total_frags = total_frags;
+    snprintf(state->info.filename, sizeof(state->info.filename), "%s", filename);
+    if (ftruncate(state->fd, 0) < 0 ||
+        pwrite(state->fd, &state->info, sizeof(state->info), 0) != sizeof(state->info) ||
+        pwrite(state->fd, state->bitmap, bitmap_size, sizeof(state->info)) != (ssize_t)bitmap_size) {
+        resume_close(state, path);
+        return NULL;
+    }
+    return state;
+}
+
+int resume_is_received(const ResumeState *state, uint32_t seq_num) {
+    return seq_num < state->info.total_frags && RESUME_BIT(state->bitmap, seq_num);
+}
+
+void resume_mark_received(ResumeState *state, uint32_t seq_num) {
+    if (seq_num >= state->info.total_frags || resume_is_received(state, seq_num)) return;
+    state->bitmap[seq_num / 8] |= 1 << (seq_num % 8);
+    state->received_count++;
+
+    // Seul l'octet modifié de la carte est réécrit
+    if (pwrite(state->fd, &state->bitmap[seq_num / 8], 1, sizeof(ResumeInfo) + seq_num / 8) != 1) {
+        perror("Erreur lors de l'enregistrement de l'état de reprise");
+    }
+}
+
+void resume_set_final(ResumeState *state, const FragmentHeader *header) {
+    state->info.has_image_crc = header->has_image_crc;
+    state->info.image_crc = header->image_crc;
+    state->info.compression = header->compression;
+    state->info.original_size = header->original_size;
+    if (pwrite(state->fd, &state->info, sizeof(state->info), 0) != sizeof(state->info)) {
+        perror("Erreur lors de l'enregistrement de l'état de reprise");
+    }
+}
+
+int resume_is_complete(const ResumeState *state) {
+    return state->received_count == state->info.total_frags;
+}
+
+void resume_close(ResumeState *state, const char *remove_path) {
+    if (!state) return;
+    if (state->fd >= 0) close(state->fd);
+    if (remove_path) unlink(remove_path);
+    free(state->bitmap);
+    free(state);
+}
+
+void format_ranges(const uint8_t *bitmap, uint32_t total_frags, char *out, size_t out_size) {
+    size_t pos = 0;
+    out[0] = '\0';
+    for (uint32_t i = 0; i < total_frags; i++) {
+        if (!RESUME_BIT(bitmap, i)) continue;
+        uint32_t start = i;
+        while (i + 1 < total_frags && RESUME_BIT(bitmap, i + 1)) i++;
+
+        // Liste tronquée : les fragments non listés seront simplement renvoyés
+        int n = snprintf(out + pos, out_size - pos, "%s%u-%u", pos ? "," : "", start, i);
+        if (n < 0 || (size_t)n >= out_size - pos) {
+            out[pos] = '\0';
+            return;
+        }
+        pos += n;
+    }
+}
+
+int parse_ranges(const char *list, uint8_t *bitmap, uint32_t total_frags) {
+    const char *p = list;
+    while (*p) {
+        char *end;
+        unsigned long start = strtoul(p, &end, 10);
+        if (end == p || *end != '-') return -1;
+        p = end + 1;
+        unsigned long stop = strtoul(p, &end, 10);
+        if (end == p || stop < start || stop >= total_frags) return -1;
+        for (unsigned long i = start; i <= stop; i++) {
+            bitmap[i / 8] |= 1 << (i % 8);
+        }
+        p = end;
+        if (*p == ',') p++;
+        else if (*p != '\0') return -1;
+    }
+    return 0;
+}
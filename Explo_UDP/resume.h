@@ -0,0 +1,75 @@
+#ifndef RESUME_H
+#define RESUME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "com_udp.h"
+
+// Reprise des transferts de fichiers après un redémarrage du client ou du serveur.
+//
+// Le client dérive un identifiant stable du fichier (nom, taille, date de
+// modification) et demande au serveur les fragments déjà reçus :
+//   client -> serveur : RESUME:<id>:<taille>:<fragments>:<nom>
+//   serveur -> client : RANGES:<id>:<debut>-<fin>,<debut>-<fin>,...
+// Les intervalles (bornes incluses) sont des numéros de fragments déjà écrits.
+// Le serveur garde la carte des fragments reçus dans un fichier d'état propre
+// à chaque identifiant, supprimé à la fin du transfert.
+
+#define RESUME_QUERY "RESUME:"
+#define RESUME_REPLY "RANGES:"
+#define RESUME_MAX_MESSAGE 1400  // Tient dans un seul datagramme sans fragmentation IP
+
+// Teste le bit d'un fragment dans une carte de fragments reçus
+#define RESUME_BIT(bitmap, i) (((bitmap)[(i) / 8] >> ((i) % 8)) & 1)
+
+// En-tête du fichier d'état (fichier local au serveur)
+typedef struct {
+    uint32_t magic;
+    uint32_t transfer_id;
+    uint32_t total_size;
+    uint32_t total_frags;
+    char filename[FRAG_MAX_FILENAME_LEN + 1];
+    uint8_t has_image_crc;  // Informations du dernier fragment, conservées s'il a été reçu
+    uint8_t compression;
+    uint32_t image_crc;
+    uint32_t original_size;
+} ResumeInfo;
+
+typedef struct {
+    ResumeInfo info;
+    uint8_t *bitmap;          // Un bit par fragment reçu
+    uint32_t received_count;
+    int fd;
+} ResumeState;
+
+// Identifiant de transfert stable d'un redémarrage à l'autre
+uint32_t make_transfer_id(const char *name, uint64_t size, int64_t mtime,
+                          uint32_t chunk_size, uint8_t compression);
+
+// Ouvre (ou crée) l'état de reprise d'un transfert. *resumed vaut 1 si un état
+// compatible existait déjà ; son nom de fichier enregistré remplace alors filename.
+// Retourne NULL en cas d'erreur.
+ResumeState *resume_open(const char *path, uint32_t transfer_id, uint32_t total_size,
+                         uint32_t total_frags, const char *filename, int *resumed);
+
+int resume_is_received(const ResumeState *state, uint32_t seq_num);
+
+// Marque un fragment comme reçu et l'enregistre sur disque
+void resume_mark_received(ResumeState *state, uint32_t seq_num);
+
+// Enregistre les informations portées par le dernier fragment (CRC, compression)
+void resume_set_final(ResumeState *state, const FragmentHeader *header);
+
+int resume_is_complete(const ResumeState *state);
+
+// Ferme l'état ; le fichier d'état est supprimé si remove_path n'est pas NULL
+void resume_close(ResumeState *state, const char *remove_path);
+
+// Écrit la liste des intervalles de fragments reçus (tronquée si elle dépasse out_size)
+void format_ranges(const uint8_t *bitmap, uint32_t total_frags, char *out, size_t out_size);
+
+// Marque dans bitmap les fragments listés, retourne -1 si la liste est invalide
+int parse_ranges(const char *list, uint8_t *bitmap, uint32_t total_frags);
+
+#endif // RESUME_H
@@ -10,26 +10,254 @@
 #include <fcntl.h>
 #include <errno.h>
 
+#include "../com_udp.h"
+#include "../crc32c.h"
+#include "../compression.h"
+#include "../resume.h"
+
 #define PORT 8080
 #define BUFFER_SIZE 8192  // Taille du buffer pour les fragments d'image
 #define MAX_FILENAME_LEN 256
+#define MAX_FILE_SIZE (64 * 1024 * 1024)  // Taille maximale d'un fichier décompressé (64 Mo)
+#define MAX_TRANSFERS 64      // Transferts reçus simultanément (un par flux client)
+#define MAX_COMPLETED 256     // Transferts terminés mémorisés pour acquitter les doublons
 
-// Structure pour les en-têtes de paquet
+// Transfert en cours de réception, reprenable après un redémarrage
 typedef struct {
-    uint32_t packet_id;    // Identifiant de paquet
-    uint32_t total_size;   // Taille totale de l'image
-    uint32_t chunk_size;   // Taille du fragment actuel
-    uint32_t offset;       // Position du fragment dans l'image
-    uint8_t is_last;       // Indique si c'est le dernier fragment
-    char filename[MAX_FILENAME_LEN]; // Nom du fichier
-} packet_header;
+    char output_filename[MAX_FILENAME_LEN + 10];
+    char state_filename[64];
+    FILE *fp;
+    ResumeState *state;       // NULL si l'emplacement est libre
+    uint32_t last_activity;   // Pour fermer le transfert le plus ancien si la table est pleine
+} Transfer;
+
+// Les fragments sont aiguillés vers leur transfert par transfer_id
+static Transfer transfers[MAX_TRANSFERS];
+static uint32_t activity_clock = 0;
+static uint32_t completed_ids[MAX_COMPLETED];
+static int completed_count = 0;
+
+// Calcule le CRC32C d'un fichier déjà écrit, retourne -1 en cas d'erreur de lecture
+static int64_t file_crc32c(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return -1;
+    
+    uint8_t chunk[BUFFER_SIZE];
+    uint32_t crc = 0;
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        crc = crc32c_update(crc, chunk, n);
+    }
+    int error = ferror(fp);
+    fclose(fp);
+    return error ? -1 : (int64_t)crc;
+}
+
+// Remplace le contenu compressé d'un fichier reçu par les données d'origine
+static int decompress_file(const char *path, CompressionType type, uint32_t original_size) {
+    if (!compression_supported(type)) {
+        printf("Compression %u non supportée par ce serveur\n", type);
+        return -1;
+    }
+    // original_size vient de l'émetteur : borné avant l'allocation
+    if (original_size > MAX_FILE_SIZE) {
+        printf("Taille décompressée annoncée trop grande (%u octets), refusée\n", original_size);
+        return -1;
+    }
+    
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return -1;
+    fseek(fp, 0, SEEK_END);
+    long compressed_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    
+    uint8_t *compressed = malloc(compressed_size);
+    uint8_t *original = malloc(original_size);
+    int ret = -1;
+    CompressionStats stats;
+    if (compressed && original &&
+        fread(compressed, 1, compressed_size, fp) == (size_t)compressed_size &&
+        decompress_buffer(type, compressed, compressed_size, original, original_size, &stats) == 0) {
+        ret = 0;
+    }
+    fclose(fp);
+    
+    if (ret == 0) {
+        print_compression_stats("Décompression", &stats);
+        fp = fopen(path, "wb");
+        if (fp == NULL || fwrite(original, 1, original_size, fp) != original_size) ret = -1;
+        if (fp != NULL) fclose(fp);
+    }
+    
+    free(compressed);
+    free(original);
+    return ret;
+}
+
+// Ferme le transfert en cours en conservant son état pour une reprise ultérieure
+static void close_transfer(Transfer *t) {
+    if (t->fp != NULL) {
+        fclose(t->fp);
+        t->fp = NULL;
+    }
+    resume_close(t->state, NULL);
+    t->state = NULL;
+}
+
+// Ouvre le fichier de sortie et l'état de reprise d'un transfert
+static int open_transfer(Transfer *t, uint32_t transfer_id, const char *filename,
+                         uint32_t total_size, uint32_t total_frags) {
+    close_transfer(t);
+    
+    // L'état est indexé par l'identifiant : il est retrouvé même sans le nom du fichier
+    snprintf(t->state_filename, sizeof(t->state_filename), "received_%08x.resume", transfer_id);
+    int resumed;
+    t->state = resume_open(t->state_filename, transfer_id, total_size, total_frags, filename, &resumed);
+    if (t->state == NULL) {
+        perror("Erreur lors de l'ouverture de l'état de reprise");
+        return -1;
+    }
+    
+    // Ajoute un préfixe "received_" pour éviter d'écraser les fichiers d'origine
+    snprintf(t->output_filename, sizeof(t->output_filename), "received_%s", t->state->info.filename);
+    
+    // Le fichier n'est tronqué que pour un nouveau transfert
+    t->fp = fopen(t->output_filename, resumed ? "r+b" : "w+b");
+    if (t->fp == NULL && resumed) {
+        // Fichier partiel supprimé entre-temps : on repart de zéro
+        resume_close(t->state, t->state_filename);
+        t->state = resume_open(t->state_filename, transfer_id, total_size, total_frags, filename, &resumed);
+        t->fp = t->state ? fopen(t->output_filename, "w+b") : NULL;
+    }
+    if (t->fp == NULL) {
+        perror("Erreur lors de la création du fichier");
+        close_transfer(t);
+        return -1;
+    }
+    
+    if (resumed) {
+        printf("Reprise de la réception de l'image: %s (%u/%u fragments déjà reçus)\n",
+               t->state->info.filename, t->state->received_count, total_frags);
+    } else {
+        printf("Début de réception de l'image: %s (taille: %u octets)\n",
+               t->state->info.filename, total_size);
+    }
+    return 0;
+}
+
+// Vérifie le fichier complet, envoie l'accusé final et supprime l'état de reprise
+static void finish_transfer(Transfer *t, int sockfd, struct sockaddr_in *client_addr, socklen_t addr_len) {
+    ResumeInfo *info = &t->state->info;
+    fclose(t->fp);
+    t->fp = NULL;
+    
+    // Décompression si le client a compressé le fichier
+    int decompress_error = info->compression &&
+        decompress_file(t->output_filename, info->compression, info->original_size) < 0;
+    
+    // Vérification de l'intégrité du fichier complet
+    int64_t crc = info->has_image_crc ? file_crc32c(t->output_filename) : -1;
+    if (decompress_error) {
+        printf("Erreur: Échec de la décompression de %s\n", info->filename);
+    } else if (info->has_image_crc && crc != info->image_crc) {
+        printf("Erreur: Image %s corrompue (CRC invalide)\n", info->filename);
+    } else {
+        printf("Image %s reçue avec succès (%u octets)\n", info->filename, info->total_size);
+    }
+    
+    // Envoi d'un accusé de réception final
+    char final_ack[512];
+    snprintf(final_ack, sizeof(final_ack), "TRANSFER_COMPLETE:%s:%u", info->filename, info->total_size);
+    sendto(sockfd, final_ack, strlen(final_ack), 0, (struct sockaddr *)client_addr, addr_len);
+    
+    completed_ids[completed_count++ % MAX_COMPLETED] = info->transfer_id;
+    resume_close(t->state, t->state_filename);
+    t->state = NULL;
+}
+
+static int is_completed(uint32_t transfer_id) {
+    int n = completed_count < MAX_COMPLETED ? completed_count : MAX_COMPLETED;
+    for (int i = 0; i < n; i++) {
+        if (completed_ids[i] == transfer_id) return 1;
+    }
+    return 0;
+}
+
+static Transfer *find_transfer(uint32_t transfer_id) {
+    for (int i = 0; i < MAX_TRANSFERS; i++) {
+        if (transfers[i].state && transfers[i].state->info.transfer_id == transfer_id) {
+            transfers[i].last_activity = ++activity_clock;
+            return &transfers[i];
+        }
+    }
+    return NULL;
+}
+
+// Ouvre un transfert dans un emplacement libre, ou à la place du moins récemment actif
+// (son état reste sur disque, il sera repris à son prochain fragment)
+static Transfer *start_transfer(uint32_t transfer_id, const char *filename,
+                                uint32_t total_size, uint32_t total_frags) {
+    Transfer *slot = &transfers[0];
+    for (int i = 0; i < MAX_TRANSFERS; i++) {
+        if (transfers[i].state == NULL) {
+            slot = &transfers[i];
+            break;
+        }
+        if (transfers[i].last_activity < slot->last_activity) slot = &transfers[i];
+    }
+    
+    if (open_transfer(slot, transfer_id, filename, total_size, total_frags) < 0) return NULL;
+    slot->last_activity = ++activity_clock;
+    return slot;
+}
+
+// Nom reçu du client : il ne doit désigner qu'un fichier du répertoire courant
+static int is_safe_filename(const char *name) {
+    return name[0] != '\0' && strchr(name, '/') == NULL && strstr(name, "..") == NULL;
+}
+
+// Répond à RESUME:<id>:<taille>:<fragments>:<nom> avec la liste des fragments déjà reçus
+static void handle_resume_query(const char *query, int sockfd,
+                                struct sockaddr_in *client_addr, socklen_t addr_len) {
+    uint32_t transfer_id, total_size, total_frags;
+    int name_pos = 0;
+    if (sscanf(query, RESUME_QUERY "%u:%u:%u:%n", &transfer_id, &total_size, &total_frags, &name_pos) != 3 ||
+        name_pos == 0 || !is_safe_filename(query + name_pos)) {
+        printf("Requête de reprise invalide, ignorée\n");
+        return;
+    }
+    
+    char reply[RESUME_MAX_MESSAGE];
+    int len = snprintf(reply, sizeof(reply), RESUME_REPLY "%u:", transfer_id);
+    
+    Transfer *t = find_transfer(transfer_id);
+    
+    // Transfert déjà terminé : tous les fragments sont annoncés comme reçus
+    if (t == NULL && is_completed(transfer_id)) {
+        if (total_frags > 0) snprintf(reply + len, sizeof(reply) - len, "0-%u", total_frags - 1);
+        sendto(sockfd, reply, strlen(reply), 0, (struct sockaddr *)client_addr, addr_len);
+        return;
+    }
+    
+    if (t == NULL) {
+        t = start_transfer(transfer_id, query + name_pos, total_size, total_frags);
+        if (t == NULL) return;
+    }
+    
+    format_ranges(t->state->bitmap, total_frags, reply + len, sizeof(reply) - len);
+    sendto(sockfd, reply, strlen(reply), 0, (struct sockaddr *)client_addr, addr_len);
+    
+    // Tous les fragments étaient déjà écrits (arrêt du serveur juste avant la fin)
+    if (resume_is_complete(t->state)) {
+        finish_transfer(t, sockfd, client_addr, addr_len);
+    }
+}
 
 int main() {
     int sockfd;
     struct sockaddr_in server_addr, client_addr;
     socklen_t addr_len = sizeof(client_addr);
-    char buffer[BUFFER_SIZE + sizeof(packet_header)];
-    FILE *fp = NULL;
+    uint8_t buffer[BUFFER_SIZE + FRAG_HEADER_MAX_SIZE + 1];  // +1 pour terminer les requêtes texte
     
     // Création du socket UDP
     if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
@@ -52,14 +280,11 @@ int main() {
     
     printf("Serveur UDP démarré sur le port %d...\n", PORT);
     
-    // Variables pour suivre le transfert de l'image
-    uint32_t total_received = 0;
-    uint32_t expected_size = 0;
-    char current_filename[MAX_FILENAME_LEN] = {0};
+    uint32_t corrupted_frags = 0;  // Fragments rejetés (CRC invalide), non acquittés
     
     while (1) {
         // Réception d'un paquet
-        int bytes_received = recvfrom(sockfd, buffer, BUFFER_SIZE + sizeof(packet_header), 
+        int bytes_received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 
                                      0, (struct sockaddr *)&client_addr, &addr_len);
         
         if (bytes_received < 0) {
@@ -67,86 +292,95 @@ int main() {
             continue;
         }
         
+        // Requête de reprise envoyée par le client avant le transfert
+        if (bytes_received > (int)strlen(RESUME_QUERY) &&
+            memcmp(buffer, RESUME_QUERY, strlen(RESUME_QUERY)) == 0) {
+            buffer[bytes_received] = '\0';
+            handle_resume_query((const char *)buffer, sockfd, &client_addr, addr_len);
+            continue;
+        }
+        
         // Extraction de l'en-tête du paquet
-        packet_header *header = (packet_header *)buffer;
-        char *data = buffer + sizeof(packet_header);
-        int data_size = bytes_received - sizeof(packet_header);
+        FragmentHeader header;
+        int header_len = decode_fragment_header(&header, buffer, bytes_received);
+        if (header_len < 0) {
+            printf("En-tête de paquet invalide, ignoré\n");
+            continue;
+        }
+        uint8_t *data = buffer + header_len;
+        int data_size = bytes_received - header_len;
+        
+        // Un fragment corrompu n'est pas acquitté : le client le renverra
+        if (!check_fragment_crc(buffer, bytes_received)) {
+            corrupted_frags++;
+            printf("Fragment %u corrompu (CRC invalide), ignoré (%u au total)\n", 
+                   header.seq_num, corrupted_frags);
+            continue;
+        }
+        
+        char ack[64];
+        snprintf(ack, sizeof(ack), "ACK:%u", header.seq_num);
         
-        // Si c'est le premier paquet d'une nouvelle image
-        if (header->offset == 0) {
-            // Fermer le fichier précédent s'il existe
-            if (fp != NULL) {
-                fclose(fp);
-                fp = NULL;
+        // Fragment renvoyé après la fin du transfert (ACK perdu) : le fichier n'est pas touché
+        Transfer *transfer = find_transfer(header.transfer_id);
+        if (transfer == NULL && is_completed(header.transfer_id)) {
+            sendto(sockfd, ack, strlen(ack), 0, (struct sockaddr *)&client_addr, addr_len);
+            continue;
+        }
+        
+        // Premier fragment reçu d'un transfert : ouverture (ou reprise) de son état
+        if (transfer == NULL) {
+            // Nom transmis en extension du premier fragment, sinon retrouvé dans l'état de reprise
+            char filename[MAX_FILENAME_LEN];
+            if (header.filename) {
+                memcpy(filename, header.filename, header.filename_len);
+                filename[header.filename_len] = '\0';
             }
-            
-            // Créer un nouveau fichier pour l'image
-            strncpy(current_filename, header->filename, MAX_FILENAME_LEN - 1);
-            current_filename[MAX_FILENAME_LEN - 1] = '\0';  // Assure la terminaison
-            
-            // Ajoute un préfixe "received_" pour éviter d'écraser les fichiers d'origine
-            char output_filename[MAX_FILENAME_LEN + 10];
-            snprintf(output_filename, sizeof(output_filename), "received_%s", current_filename);
-            
-            fp = fopen(output_filename, "wb");
-            if (fp == NULL) {
-                perror("Erreur lors de la création du fichier");
-                continue;
+            if (!header.filename || !is_safe_filename(filename)) {
+                if (header.filename) printf("Nom de fichier invalide, remplacé par l'identifiant\n");
+                snprintf(filename, sizeof(filename), "%u.bin", header.transfer_id);
             }
-            
-            expected_size = header->total_size;
-            total_received = 0;
-            
-            printf("Début de réception de l'image: %s (taille: %u octets)\n", 
-                   current_filename, expected_size);
+            transfer = start_transfer(header.transfer_id, filename, header.total_size, header.total_frags);
+            if (transfer == NULL) continue;
         }
         
-        // Vérifier si le fichier est ouvert
-        if (fp == NULL) {
-            printf("Erreur: Aucun fichier ouvert pour écrire les données\n");
+        // Le fragment doit décrire le même objet que l'état enregistré et rester dans ses limites :
+        // sinon il n'est ni écrit ni acquitté
+        const ResumeInfo *info = &transfer->state->info;
+        if (header.total_size != info->total_size || header.total_frags != info->total_frags ||
+            header.seq_num >= info->total_frags || (uint64_t)header.offset + data_size > info->total_size) {
+            printf("Fragment %u du transfert %u incohérent avec le transfert en cours, ignoré\n",
+                   header.seq_num, header.transfer_id);
             continue;
         }
         
-        // Écrire les données dans le fichier
-        fseek(fp, header->offset, SEEK_SET);
-        size_t written = fwrite(data, 1, data_size, fp);
+        // Écrire les données dans le fichier (un doublon est simplement réécrit)
+        fseek(transfer->fp, header.offset, SEEK_SET);
+        size_t written = fwrite(data, 1, data_size, transfer->fp);
         if (written != data_size) {
             perror("Erreur lors de l'écriture des données");
+            continue;
         }
         
-        total_received += data_size;
+        // Les données doivent être écrites avant d'être marquées comme reçues
+        fflush(transfer->fp);
+        resume_mark_received(transfer->state, header.seq_num);
+        if (header.flags & FRAG_FLAG_LAST) {
+            resume_set_final(transfer->state, &header);
+        }
         
         // Accusé de réception
-        char ack[64];
-        snprintf(ack, sizeof(ack), "ACK:%u", header->packet_id);
         sendto(sockfd, ack, strlen(ack), 0, (struct sockaddr *)&client_addr, addr_len);
         
-        // Si c'est le dernier paquet
-        if (header->is_last) {
-            if (fp != NULL) {
-                fclose(fp);
-                fp = NULL;
-            }
-            
-            if (total_received == expected_size) {
-                printf("Image %s reçue avec succès (%u octets)\n", current_filename, total_received);
-            } else {
-                printf("Avertissement: Image %s reçue partiellement (%u/%u octets)\n", 
-                       current_filename, total_received, expected_size);
-            }
-            
-            // Envoi d'un accusé de réception final
-            char final_ack[256];
-            snprintf(final_ack, sizeof(final_ack), "TRANSFER_COMPLETE:%s:%u", 
-                     current_filename, total_received);
-            sendto(sockfd, final_ack, strlen(final_ack), 0, 
-                   (struct sockaddr *)&client_addr, addr_len);
+        // Tous les fragments sont reçus, y compris ceux des sessions précédentes
+        if (resume_is_complete(transfer->state)) {
+            finish_transfer(transfer, sockfd, &client_addr, addr_len);
         }
     }
     
     // Ce code n'est jamais atteint à cause de la boucle infinie
-    if (fp != NULL) {
-        fclose(fp);
+    for (int i = 0; i < MAX_TRANSFERS; i++) {
+        close_transfer(&transfers[i]);
     }
     close(sockfd);
     return 0;
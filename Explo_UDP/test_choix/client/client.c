@@ -6,11 +6,14 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include "../../com_udp.h"
+#include "../../latency.h"
 
 #define PORT_TCP 8080
 #define PORT_UDP 12345
 #define BUFFER_SIZE 1024
 #define OUTPUT_VIDEO "IMG_5362.mp4"
+#define VIDEO_CHUNK_SIZE 1400  // Taille maximale d'un datagramme vidéo envoyé par le serveur
 
 void recevoirUDP();
 void envoyerTCP();
@@ -23,7 +26,7 @@ void (*choixCommunicationClient[])() = {recevoirUDP, envoyerTCP};
 void recevoirUDP() {
     int sockfd;
     struct sockaddr_in serverAddr;
-    char buffer[BUFFER_SIZE];
+    char buffer[VIDEO_CHUNK_SIZE + 1];
     FILE *video;
     socklen_t addr_size = sizeof(serverAddr);
     
@@ -42,7 +45,7 @@ void recevoirUDP() {
     printf("Message 'START_client' envoyé.\n");
     
     // Attente du message START_serveur
-    ssize_t bytesReceived = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, 
+    ssize_t bytesReceived = recvfrom(sockfd, buffer, VIDEO_CHUNK_SIZE, 0, 
                                    (struct sockaddr *)&serverAddr, &addr_size);
     
     if (bytesReceived <= 0) {
@@ -69,9 +72,11 @@ void recevoirUDP() {
     
     size_t totalReceived = 0;
     int timeout_count = 0;
+    LatencyStats latency;
+    latency_init(&latency);
     
     while (1) {
-        bytesReceived = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, 
+        bytesReceived = recvfrom(sockfd, buffer, VIDEO_CHUNK_SIZE, 0, 
                                (struct sockaddr *)&serverAddr, &addr_size);
         
         if (bytesReceived <= 0) {
@@ -97,14 +102,28 @@ void recevoirUDP() {
             break;
         }
         
+        // En-tête commun : position des données et date de capture de la frame
+        FragmentHeader header;
+        int header_len = decode_fragment_header(&header, (uint8_t *)buffer, bytesReceived);
+        if (header_len < 0) {
+            printf("\nDatagramme sans en-tête valide, ignoré\n");
+            continue;
+        }
+
+        // Latence de la frame à la réception de son dernier fragment
+        if ((header.flags & FRAG_FLAG_LAST) && header.has_capture_time) {
+            latency_update(&latency, header.capture_time_us, frag_clock_us());
+        }
+
         // Write data to file
-        fwrite(buffer, 1, bytesReceived, video);
-        totalReceived += bytesReceived;
+        fwrite(buffer + header_len, 1, bytesReceived - header_len, video);
+        totalReceived += bytesReceived - header_len;
         printf("\rReçu: %zu bytes", totalReceived);
         fflush(stdout);
     }
     
     printf("\nVidéo reçue! Total: %zu bytes\n", totalReceived);
+    latency_print(&latency);
     fclose(video);
     close(sockfd);
 }
@@ -1,17 +1,22 @@
 // ====== SERVER.C ======
 
+#define _GNU_SOURCE  // sendmmsg
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <arpa/inet.h>
+#include <sys/socket.h>
 
 // ====== Video4Linux ======
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <linux/videodev2.h>
 #include <errno.h>
-#include <sys/mman.h>  // Ajout de l'en-tête pour mmap
+#include "../../capture_v4l2.h"
+#include "../../frame_queue.h"
+#include "../../com_udp.h"
 // =========================
 
 #define PORT_TCP 8080
@@ -19,6 +24,14 @@
 #define BUFFER_SIZE 1024
 #define VIDEO_FILE "IMG_5362.mp4"
 
+// Envoi du flux de la webcam
+#define VIDEO_CHUNK_SIZE 1400   // Taille d'un datagramme vidéo (pas de fragmentation IP)
+#define VIDEO_HEADER_SIZE (FRAG_HEADER_BASE_MAX_SIZE + 1 + 1 + 8 + 1)  // En-tête avec la date de capture
+#define VIDEO_DATA_SIZE (VIDEO_CHUNK_SIZE - VIDEO_HEADER_SIZE)
+#define SEND_BATCH 32           // Datagrammes envoyés par appel à sendmmsg
+#define VIDEO_FPS 25
+#define PACING_RATIO 0.8        // Part de l'intervalle entre frames utilisée pour envoyer une frame
+
 // Abandon suite aux conseils de Matthias à cause du format vidéo
 
 void communicationUDP();
@@ -166,13 +179,82 @@ void envoyerVideoUDP(FILE* video) {
 
 /*------------------------------------------------------------------------------------------*/
 
+// Ajoute ms millisecondes à une date CLOCK_MONOTONIC
+static void ajouterMs(struct timespec *ts, double ms) {
+    long ns = ts->tv_nsec + (long)(ms * 1e6);
+    ts->tv_sec += ns / 1000000000L;
+    ts->tv_nsec = ns % 1000000000L;
+}
+
+// Envoie une frame par lots de datagrammes répartis sur la durée d'une frame,
+// pour ne pas saturer la file d'émission ni le récepteur.
+// Chaque datagramme porte l'en-tête commun avec la date de capture de la frame.
+static int envoyerFrame(uint32_t frameId, const uint8_t *data, size_t size, uint64_t captureUs,
+                        double intervalleMs) {
+    struct mmsghdr messages[SEND_BATCH];
+    struct iovec iovs[SEND_BATCH][2];
+    uint8_t entetes[SEND_BATCH][VIDEO_HEADER_SIZE];
+    size_t nbDatagrammes = (size + VIDEO_DATA_SIZE - 1) / VIDEO_DATA_SIZE;
+    size_t nbLots = (nbDatagrammes + SEND_BATCH - 1) / SEND_BATCH;
+    double ecartMs = nbLots > 1 ? intervalleMs * PACING_RATIO / nbLots : 0;
+
+    struct timespec prochainLot;
+    clock_gettime(CLOCK_MONOTONIC, &prochainLot);
+
+    size_t offset = 0;
+    while (offset < size) {
+        // Préparation d'un lot de datagrammes pointant directement dans le buffer de capture
+        int n = 0;
+        while (n < SEND_BATCH && offset < size) {
+            size_t chunkSize = (size - offset) > VIDEO_DATA_SIZE ? VIDEO_DATA_SIZE : (size - offset);
+            FragmentHeader header = {
+                .flags = (offset + chunkSize == size) ? FRAG_FLAG_LAST : 0,
+                .transfer_id = frameId,
+                .seq_num = offset / VIDEO_DATA_SIZE,
+                .total_frags = nbDatagrammes,
+                .offset = offset,
+                .total_size = size,
+                .has_capture_time = 1,
+                .capture_time_us = captureUs
+            };
+            int headerLen = encode_fragment_header(&header, entetes[n], VIDEO_HEADER_SIZE);
+            if (headerLen < 0) return -1;
+
+            // En-tête et données en deux morceaux : pas de copie de la frame
+            iovs[n][0].iov_base = entetes[n];
+            iovs[n][0].iov_len = headerLen;
+            iovs[n][1].iov_base = (void *)(data + offset);
+            iovs[n][1].iov_len = chunkSize;
+            memset(&messages[n], 0, sizeof(messages[n]));
+            messages[n].msg_hdr.msg_name = &clientAddr;
+            messages[n].msg_hdr.msg_namelen = addr_size;
+            messages[n].msg_hdr.msg_iov = iovs[n];
+            messages[n].msg_hdr.msg_iovlen = 2;
+            offset += chunkSize;
+            n++;
+        }
+
+        // Attente du créneau du lot (date absolue : pas de dérive)
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &prochainLot, NULL);
+        ajouterMs(&prochainLot, ecartMs);
+
+        int envoyes = 0;
+        while (envoyes < n) {
+            int ret = sendmmsg(sockfd, messages + envoyes, n - envoyes, 0);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                perror("Erreur envoi vidéo");
+                return -1;
+            }
+            envoyes += ret;
+        }
+    }
+    return 0;
+}
+
 // Fonction pour envoyer un flux vidéo via UDP en utilisant la webcam
 void envoyerFluxVideoUDP() {
-    int fd;
-    struct v4l2_format fmt;
-    struct v4l2_requestbuffers req;
-    struct v4l2_buffer buf;
-    void *buffer_start = NULL;  // Pointeur pour la mémoire mappée des buffers vidéo
+    CaptureDevice dev;
 
     // Envoi du message START pour indiquer le début de la vidéo
     ssize_t sent = sendto(sockfd, "START_serveur", strlen("START_serveur"), 0, 
@@ -185,129 +267,70 @@ void envoyerFluxVideoUDP() {
     printf("Message 'START_serveur' envoyé.\n");
 
     printf("Serveur UDP prêt pour la vidéo...\n");
-    
-    // Ouverture de la webcam (/dev/video0)
-    fd = open("/dev/video0", O_RDWR);
-    if (fd == -1) {
-        perror("Erreur d'ouverture de la webcam");
-        exit(EXIT_FAILURE);
-    }
 
-    // Configuration du format de la vidéo (résolution, format de pixel)
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = 640;  // Largeur de l'image
-    fmt.fmt.pix.height = 480; // Hauteur de l'image
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;  // Format de pixel YUYV
-    fmt.fmt.pix.field = V4L2_FIELD_INTERLACED;
-
-    // Envoi de la configuration à la webcam
-    if (ioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
-        perror("Erreur de format de capture");
-        close(fd);
-        exit(EXIT_FAILURE);
+    // File d'émission assez grande pour un lot complet de datagrammes
+    int sndbuf = 4 * 1024 * 1024;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
+        perror("Erreur de configuration du buffer d'émission");
     }
-
-    // Demande de buffers pour la capture vidéo
-    req.count = 4;  // Demande de 4 buffers pour la capture
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    if (ioctl(fd, VIDIOC_REQBUFS, &req) == -1) {
-        perror("Erreur de demande de buffers");
-        close(fd);
+    
+    // Ouverture de la webcam (/dev/video0), format 640x480 YUYV et 4 buffers mappés.
+    // Chaque frame est lue dans le buffer de son propre index (buffers[buf.index]).
+    if (capture_open(&dev, "/dev/video0", 640, 480, V4L2_PIX_FMT_YUYV, 4) == -1) {
         exit(EXIT_FAILURE);
     }
 
-    // Mappage des buffers en mémoire partagée
-    for (int i = 0; i < req.count; i++) {
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-
-        // Vérification des informations sur chaque buffer
-        if (ioctl(fd, VIDIOC_QUERYBUF, &buf) == -1) {
-            perror("Erreur de requête de buffer");
-            close(fd);
-            exit(EXIT_FAILURE);
-        }
-
-        // Mappage du buffer en mémoire pour y accéder plus rapidement
-        buffer_start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
-        if (buffer_start == MAP_FAILED) {
-            perror("Erreur de mappage mémoire");
-            close(fd);
-            exit(EXIT_FAILURE);
-        }
-
-        // Mise en file d'attente du buffer pour la capture vidéo
-        if (ioctl(fd, VIDIOC_QBUF, &buf) == -1) {
-            perror("Erreur de mise en file d'attente du buffer");
-            close(fd);
-            exit(EXIT_FAILURE);
-        }
+    // Démarrage du flux vidéo (streaming)
+    if (capture_start(&dev) == -1) {
+        capture_close(&dev);
+        exit(EXIT_FAILURE);
     }
 
-    // Démarrage du flux vidéo (streaming)
-    if (ioctl(fd, VIDIOC_STREAMON, &buf.type) == -1) {
-        perror("Erreur de démarrage du stream");
-        close(fd);
+    // Thread de capture : si l'envoi prend du retard, seule la frame la plus récente est envoyée
+    FrameQueue queue;
+    frame_queue_init(&queue, &dev, 1, FRAME_DROP_OLDEST);
+    if (frame_queue_start(&queue) == -1) {
+        capture_close(&dev);
         exit(EXIT_FAILURE);
     }
 
     // Envoi continu des frames vidéo capturées
     size_t totalSent = 0;  // Variable pour suivre le nombre total de bytes envoyés
+    double intervalleMs = 1000.0 / VIDEO_FPS;
     while (1) {
-        // Capture une image de la vidéo en mettant à jour le buffer
-        if (ioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
-            perror("Erreur de capture d'image");
+        // Récupère la dernière image de la vidéo
+        CaptureBuffer *frame = frame_queue_pop(&queue);
+        if (frame == NULL) {
             break;
         }
 
-        // Vérification de la taille du paquet et envoi du paquet vidéo
-        size_t packetSize = buf.bytesused;
-        if (packetSize > BUFFER_SIZE) {
-            printf("La taille du paquet excède la capacité du buffer. Découpage en morceaux...\n");
-            size_t bytesSent = 0;
-
-            // Découpe et envoi du paquet en morceaux si sa taille dépasse le buffer
-            while (bytesSent < packetSize) {
-                size_t chunkSize = (packetSize - bytesSent) > BUFFER_SIZE ? BUFFER_SIZE : (packetSize - bytesSent);
-                ssize_t sent = sendto(sockfd, buffer_start + bytesSent, chunkSize, 0, 
-                                      (struct sockaddr *)&clientAddr, addr_size);
-                if (sent < 0) {
-                    perror("Erreur envoi vidéo");
-                    break;
-                }
-                bytesSent += sent;
-                usleep(10000);  // Petite pause entre les envois de chaque morceau (10ms)
-            }
-        } else {
-            // Envoi d'un paquet complet si sa taille est inférieure ou égale à la capacité du buffer
-            ssize_t sent = sendto(sockfd, buffer_start, packetSize, 0, 
-                                  (struct sockaddr *)&clientAddr, addr_size);
-            if (sent < 0) {
-                perror("Erreur envoi vidéo");
-                break;
-            }
+        // Envoi de la frame directement depuis le buffer du driver
+        double capturedMs = capture_frame_time_ms(frame);
+        int ret = envoyerFrame(frame->sequence, frame->start, frame->bytesused,
+                               capture_epoch_us(capturedMs), intervalleMs);
+        if (ret == 0) {
+            totalSent += frame->bytesused;  // Mise à jour du total des bytes envoyés
+            frame_queue_sent(&queue, capturedMs);
         }
-        
-        totalSent += buf.bytesused;  // Mise à jour du total des bytes envoyés
 
-        // Mise en file d'attente du buffer après capture pour permettre la prochaine image
-        if (ioctl(fd, VIDIOC_QBUF, &buf) == -1) {
-            perror("Erreur de mise en file d'attente du buffer après capture");
+        // Remise en file d'attente du buffer pour permettre la prochaine image
+        if (capture_release(&dev, frame) == -1 || ret == -1) {
             break;
         }
     }
 
+    frame_queue_stop(&queue);
+
     // Affichage du nombre total de bytes envoyés
     printf("Total bytes envoyés: %zu\n", totalSent);
+    frame_queue_print_stats(&queue);
 
     // Envoi du message END pour signaler la fin de l'envoi de la vidéo
     sendto(sockfd, "END", 3, 0, (struct sockaddr *)&clientAddr, addr_size);
     printf("Vidéo envoyée et signal de fin envoyé !\n");
 
     // Fermeture de la connexion avec la webcam (libération des ressources)
-    close(fd);  
+    capture_close(&dev);
 }
 
 /*------------------------------------------------------------------------------------------*/